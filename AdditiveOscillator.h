@@ -0,0 +1,303 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "FastRandom.h"
+#include "SnapshotMailbox.h"
+
+//==============================================================================
+// The partials behind each waveform, for rendering it additively instead of
+// reading a table built from them.
+namespace Additive
+{
+    static constexpr int maxHarmonics = 32;
+    static constexpr int maxSubharmonics = 8;
+
+    struct Spectrum
+    {
+        std::array<float, maxHarmonics> ratios {};
+        std::array<float, maxHarmonics> amplitudes {};
+        int numHarmonics = 0;
+    };
+
+    // The partials WaveformGenerator sums for a waveform (0=Sine, 1=Saw, 2=Square,
+    // 3=Triangle), scaled so that they peak at 1 like a normalised table. The saw
+    // uses exact multiples: its table's stretched partials wrap every period, so
+    // they are heard as harmonics of the note anyway.
+    inline Spectrum createSpectrum(int waveformType, int numHarmonics)
+    {
+        constexpr auto pi = juce::MathConstants<float>::pi;
+
+        Spectrum spectrum;
+        spectrum.numHarmonics = juce::jlimit(1, maxHarmonics, numHarmonics);
+
+        for (int n = 1; n <= spectrum.numHarmonics; ++n)
+        {
+            const auto odd = (float)(2 * n - 1);
+            auto& ratio = spectrum.ratios[(size_t)(n - 1)];
+            auto& amplitude = spectrum.amplitudes[(size_t)(n - 1)];
+
+            switch (waveformType)
+            {
+                case 2:
+                    ratio = odd;
+                    amplitude = 4.0f / (pi * odd);
+                    break;
+
+                case 3:
+                    ratio = odd;
+                    amplitude = (n % 2 == 0 ? -8.0f : 8.0f) / (pi * pi * odd * odd);
+                    break;
+
+                default:
+                    ratio = (float)n;
+                    amplitude = 1.0f / (float)n;
+                    break;
+            }
+        }
+
+        // Peak over one period, found the way a table would be normalised
+        constexpr int numPoints = 2048;
+        auto peak = 0.0;
+
+        for (int i = 0; i < numPoints; ++i)
+        {
+            const auto angle = juce::MathConstants<double>::twoPi * i / numPoints;
+            auto sum = 0.0;
+
+            for (int n = 0; n < spectrum.numHarmonics; ++n)
+                sum += spectrum.amplitudes[(size_t)n] * std::sin(angle * spectrum.ratios[(size_t)n]);
+
+            peak = juce::jmax(peak, std::abs(sum));
+        }
+
+        if (peak > 0.0)
+            for (auto& amplitude : spectrum.amplitudes)
+                amplitude = (float)(amplitude / peak);
+
+        return spectrum;
+    }
+}
+
+//==============================================================================
+// One voice's partials, each a complex phasor turned by a fixed rotation every
+// sample, so a partial costs four multiplies and no trig.
+//
+// The partials are lanes of a vector, the subharmonics first and then the
+// harmonics in rising order, so the ones above Nyquist are always at the end
+// and are simply left out of the loop. Amplitudes move linearly from one render
+// call to the next, and each call ends by pulling the phasors back to unit
+// length before rounding can grow or shrink them.
+//
+// A new spectrum is handed over through a SnapshotMailbox, which the renderer
+// looks in at the start of a note or render call. Neither side waits, and the
+// renderer never sees a spectrum half written.
+class AdditiveOscillator
+{
+public:
+    static constexpr int maxPartials = Additive::maxSubharmonics + Additive::maxHarmonics;
+
+    // One writer thread at a time, e.g. the message thread, also while a note is
+    // playing: amplitudes move to the latest spectrum over the next render call
+    void setSpectrum(const Additive::Spectrum& newSpectrum) noexcept
+    {
+        spectra.publish(newSpectrum);
+    }
+
+    // Subharmonic i sounds at 1 / (i + 2) of the note, like the table engines' ones.
+    // Partial amplitudes start at their levels rather than ramping in.
+    void startNote(float frequency, float sampleRate, int numSubharmonicsToUse, FastRandom& random)
+    {
+        baseFrequency = frequency;
+        currentSampleRate = sampleRate;
+        numSubharmonics = juce::jlimit(0, Additive::maxSubharmonics, numSubharmonicsToUse);
+        adoptNewSpectrum();
+
+        const auto& spectrum = getSpectrum();
+
+        // The harmonics keep the waveform's shape, so they share one starting phase;
+        // the subharmonics start independently
+        const auto fundamentalPhase = random.nextFloat() * juce::MathConstants<float>::twoPi;
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            const auto harmonic = (int)lane - numSubharmonics;
+            const auto phase = (int)lane < numSubharmonics
+                                   ? random.nextFloat() * juce::MathConstants<float>::twoPi
+                                   : harmonic < Additive::maxHarmonics ? fundamentalPhase * spectrum.ratios[(size_t)harmonic] : 0.0f;
+
+            reals[lane] = std::cos(phase);
+            imaginaries[lane] = std::sin(phase);
+        }
+
+        updateRotations(1.0f);
+        updateTargets(1.0f, 0.0f, 1.0f);
+
+        amplitudes = targets;
+        numActiveLanes = numTargetLanes;
+    }
+
+    // Overwrites numSamples of output. The pitch ratio applies to the whole call;
+    // the amplitudes ramp to those for the given harmonics morph (0 = the full
+    // spectrum, 1 = the fundamental alone) and subharmonic gain.
+    void render(float* output, int numSamples, float pitchRatio, float morph, float subharmonicGain) noexcept
+    {
+        if (adoptNewSpectrum() || pitchRatio != currentPitchRatio)
+            updateRotations(pitchRatio);
+
+        updateTargets(pitchRatio, morph, subharmonicGain);
+
+        // Lanes fading out still need their ramp down
+        numActiveLanes = juce::jmax(numActiveLanes, numTargetLanes);
+        const auto numRegisters = (numActiveLanes + (int)Register::SIMDNumElements - 1) / (int)Register::SIMDNumElements;
+        const auto inverseNumSamples = 1.0f / (float)numSamples;
+
+        for (int lane = 0; lane < numRegisters * (int)Register::SIMDNumElements; ++lane)
+            steps[(size_t)lane] = (targets[(size_t)lane] - amplitudes[(size_t)lane]) * inverseNumSamples;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            auto sum = Register::expand(0.0f);
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                const auto offset = (size_t)(r * (int)Register::SIMDNumElements);
+
+                const auto re = Register::fromRawArray(reals.data() + offset);
+                const auto im = Register::fromRawArray(imaginaries.data() + offset);
+                const auto cosine = Register::fromRawArray(cosines.data() + offset);
+                const auto sine = Register::fromRawArray(sines.data() + offset);
+                const auto amplitude = Register::fromRawArray(amplitudes.data() + offset);
+
+                sum += im * amplitude;
+
+                (amplitude + Register::fromRawArray(steps.data() + offset)).copyToRawArray(amplitudes.data() + offset);
+                (re * cosine - im * sine).copyToRawArray(reals.data() + offset);
+                (re * sine + im * cosine).copyToRawArray(imaginaries.data() + offset);
+            }
+
+            output[n] = sum.sum();
+        }
+
+        // Land exactly on the targets, and pull every phasor back to unit length with
+        // one Newton step of 1 / sqrt(|z|^2), which is plenty for the tiny drift of a
+        // few dozen rotations
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            const auto offset = (size_t)(r * (int)Register::SIMDNumElements);
+
+            Register::fromRawArray(targets.data() + offset).copyToRawArray(amplitudes.data() + offset);
+
+            const auto re = Register::fromRawArray(reals.data() + offset);
+            const auto im = Register::fromRawArray(imaginaries.data() + offset);
+            const auto gain = Register::expand(1.5f) - Register::expand(0.5f) * (re * re + im * im);
+
+            (re * gain).copyToRawArray(reals.data() + offset);
+            (im * gain).copyToRawArray(imaginaries.data() + offset);
+        }
+
+        numActiveLanes = numTargetLanes;
+    }
+
+private:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr size_t numLanes = ((size_t)maxPartials + Register::SIMDNumElements - 1)
+                                     / Register::SIMDNumElements * Register::SIMDNumElements;
+
+    using LaneArray = std::array<float, numLanes>;
+
+    SnapshotMailbox<Additive::Spectrum> spectra { Additive::createSpectrum(0, 1) };
+
+    float baseFrequency = 0.0f;
+    float currentSampleRate = 44100.0f;
+    float currentPitchRatio = 1.0f;
+    int numSubharmonics = 0;
+
+    // Lanes at or past these carry no signal, now and after the ramp
+    int numActiveLanes = 0;
+    int numTargetLanes = 0;
+
+    // Every lane holds a unit phasor, so a partial can fade in from anywhere
+    alignas(Register::SIMDRegisterSize) LaneArray reals = makeFilled(1.0f);
+    alignas(Register::SIMDRegisterSize) LaneArray imaginaries {};
+    alignas(Register::SIMDRegisterSize) LaneArray cosines = makeFilled(1.0f);
+    alignas(Register::SIMDRegisterSize) LaneArray sines {};
+    alignas(Register::SIMDRegisterSize) LaneArray amplitudes {};
+    alignas(Register::SIMDRegisterSize) LaneArray steps {};
+    alignas(Register::SIMDRegisterSize) LaneArray targets {};
+
+    static LaneArray makeFilled(float value)
+    {
+        LaneArray array;
+        array.fill(value);
+        return array;
+    }
+
+    const Additive::Spectrum& getSpectrum() const noexcept
+    {
+        return spectra.get();
+    }
+
+    // Renderer side: takes the latest spectrum if a new one has been set
+    bool adoptNewSpectrum() noexcept
+    {
+        return spectra.adoptLatest();
+    }
+
+    float getLaneRatio(int lane) const noexcept
+    {
+        return lane < numSubharmonics ? 1.0f / (float)(lane + 2)
+                                      : getSpectrum().ratios[(size_t)(lane - numSubharmonics)];
+    }
+
+    int getNumLanesInUse() const noexcept
+    {
+        return numSubharmonics + getSpectrum().numHarmonics;
+    }
+
+    void updateRotations(float pitchRatio) noexcept
+    {
+        const auto radiansPerHz = juce::MathConstants<float>::twoPi / currentSampleRate;
+
+        for (int lane = 0; lane < getNumLanesInUse(); ++lane)
+        {
+            const auto angle = baseFrequency * pitchRatio * getLaneRatio(lane) * radiansPerHz;
+            cosines[(size_t)lane] = std::cos(angle);
+            sines[(size_t)lane] = std::sin(angle);
+        }
+
+        currentPitchRatio = pitchRatio;
+    }
+
+    void updateTargets(float pitchRatio, float morph, float subharmonicGain) noexcept
+    {
+        const auto nyquist = 0.5f * currentSampleRate;
+        const auto numLanesInUse = getNumLanesInUse();
+        const auto& spectrum = getSpectrum();
+
+        targets.fill(0.0f);
+        numTargetLanes = 0;
+
+        for (int lane = 0; lane < numLanesInUse; ++lane)
+        {
+            if (baseFrequency * pitchRatio * getLaneRatio(lane) >= nyquist)
+                continue;
+
+            if (lane < numSubharmonics)
+            {
+                targets[(size_t)lane] = subharmonicGain * 0.5f / (float)(lane + 2);
+            }
+            else
+            {
+                // Morphing fades the overtones out and the fundamental to full level,
+                // as crossfading towards a single-harmonic table would
+                const auto harmonic = lane - numSubharmonics;
+                targets[(size_t)lane] = spectrum.amplitudes[(size_t)harmonic] * (1.0f - morph)
+                                      + (harmonic == 0 ? morph : 0.0f);
+            }
+
+            numTargetLanes = lane + 1;
+        }
+    }
+};
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include "WavetableSound.h"
+#include "VoiceFilterBank.h"
+#include "ParallelRenderPool.h"
+#include "TraceRecorder.h"
+
+//==============================================================================
+// A Synthesiser whose voices run through per-voice filters.
+//
+// Instead of letting each voice add itself to the output, every voice renders into
+// its own lane of the filter bank, the bank filters all lanes together with cutoffs
+// refreshed every control block, and only then is the sum added to the output.
+//
+// renderNextBlockScheduled() handles MIDI without splitting the block at every
+// event, so dense input costs little more than a held chord.
+//
+// Offline renders work in larger blocks and can spread the voices over the
+// threads of a ParallelRenderPool; each voice's output is the same either way.
+class ArmonioSynthesiser : public juce::Synthesiser
+{
+public:
+    // Realtime renders keep the lanes small enough to stay in L1
+    static constexpr int realtimeBlockSize = 128;
+
+    void setCurrentPlaybackSampleRate(double newRate) override
+    {
+        Synthesiser::setCurrentPlaybackSampleRate(newRate);
+        filterBank.prepare(newRate);
+    }
+
+    // Message thread: makes newSound the one that new notes play, without the lock
+    // the audio thread renders under. The first sound is added directly; after that
+    // the next note-on swaps it in, and notes already playing keep their own. Old
+    // sounds are freed here, once no voice holds them, never on the audio thread.
+    void setSound(juce::SynthesiserSound::Ptr newSound)
+    {
+        releaseRetiredSounds();
+        retainedSounds.add(newSound);
+
+        if (sounds.isEmpty())
+        {
+            addSound(newSound);
+            adoptedSound.store(newSound.get(), std::memory_order_release);
+        }
+        else
+        {
+            pendingSound.store(newSound.get(), std::memory_order_release);
+        }
+    }
+
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        adoptPendingSound();
+        Synthesiser::noteOn(midiChannel, midiNoteNumber, velocity);
+    }
+
+    // Any thread: calls function(WavetableVoice&) for every voice. Voices are only
+    // added before rendering starts, so walking them takes no lock, unlike getVoice().
+    template <typename Function>
+    void forEachVoice(Function&& function) const noexcept
+    {
+        for (auto* voice : voices)
+            function(*static_cast<WavetableVoice*>(voice));
+    }
+
+    // Audio thread: true if any voice is sounding. Only the audio thread starts and
+    // stops notes, so this reads the voices directly rather than through getVoice().
+    bool isAnyVoiceActive() const noexcept
+    {
+        for (auto* voice : voices)
+            if (voice->isVoiceActive())
+                return true;
+
+        return false;
+    }
+
+    void setFilterMode(int mode) noexcept            { filterBank.setMode(mode); }
+    void setFilterResonance(float resonance) noexcept { filterBank.setResonance(resonance); }
+
+    // Message thread, with rendering stopped: the pool that offline renders use, or nullptr
+    void setRenderPool(ParallelRenderPool* poolToUse)
+    {
+        renderPool = poolToUse;
+        voiceBuffers.assign(poolToUse != nullptr ? (size_t)(VoiceFilterBank::maxVoices * 2 * VoiceFilterBank::maxBlockSize) : 0, 0.0f);
+    }
+
+    // Audio thread: switches block size and threading between blocks
+    void setNonRealtime(bool isNonRealtime) noexcept
+    {
+        blockSize = isNonRealtime ? VoiceFilterBank::maxBlockSize : realtimeBlockSize;
+        isRenderingInParallel = isNonRealtime;
+    }
+
+    // Audio thread: new notes steal rather than take a free voice once this many are
+    // sounding. Notes already playing are left to finish, so lowering it never clicks.
+    void setVoiceLimit(int newLimit) noexcept
+    {
+        voiceLimit = juce::jmax(1, newLimit);
+    }
+
+    // Renders numSamples of output, handling each event in midi that falls within them
+    // at its exact sample.
+    // renderNextBlock() would render every voice in pieces between consecutive events;
+    // here each voice renders straight through the block and stops only at the events
+    // that reach it: a note of its own starting, stopping or being stolen. Mod wheel
+    // moves take effect at each voice's next modulation ramp, so they stop no voice.
+    template <typename SampleType>
+    void renderNextBlockScheduled(juce::AudioBuffer<SampleType>& outputAudio, const juce::MidiBuffer& midi,
+                                  int startSample, int numSamples) noexcept
+    {
+        const juce::ScopedLock sl(lock);
+        renderVoicesThroughFilters(outputAudio, midi, startSample, numSamples);
+    }
+
+protected:
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                          int midiNoteNumber, bool stealIfNoneAvailable) const override
+    {
+        if (voiceLimit < voices.size())
+        {
+            // Steals the oldest released voice, or failing that the oldest held one.
+            // findVoiceToSteal() expects every voice to be sounding, which under the
+            // limit they are not.
+            juce::SynthesiserVoice* oldestReleased = nullptr;
+            juce::SynthesiserVoice* oldestHeld = nullptr;
+            auto numActive = 0;
+
+            for (auto* voice : voices)
+            {
+                if (! voice->isVoiceActive())
+                    continue;
+
+                ++numActive;
+                auto*& oldest = voice->isKeyDown() ? oldestHeld : oldestReleased;
+
+                if (oldest == nullptr || voice->wasStartedBefore(*oldest))
+                    oldest = voice;
+            }
+
+            if (numActive >= voiceLimit)
+            {
+                if (! stealIfNoneAvailable)
+                    return nullptr;
+
+                return oldestReleased != nullptr ? oldestReleased : oldestHeld;
+            }
+        }
+
+        return Synthesiser::findFreeVoice(soundToPlay, midiChannel, midiNoteNumber, stealIfNoneAvailable);
+    }
+
+    // renderNextBlock() has already handled the events and calls these in between
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override
+    {
+        renderVoicesThroughFilters(outputAudio, noEvents, startSample, numSamples);
+    }
+
+    // A double bus gets the same float voices and filters, added straight into it
+    // rather than through the float copy the base class would render into
+    void renderVoices(juce::AudioBuffer<double>& outputAudio, int startSample, int numSamples) override
+    {
+        renderVoicesThroughFilters(outputAudio, noEvents, startSample, numSamples);
+    }
+
+private:
+    // Every sound setSound() has published that may still be adopted or playing
+    juce::ReferenceCountedArray<juce::SynthesiserSound> retainedSounds;
+    std::atomic<juce::SynthesiserSound*> pendingSound { nullptr };
+    std::atomic<juce::SynthesiserSound*> adoptedSound { nullptr };
+
+    // Audio thread, under the lock: replacing the one slot never allocates, and
+    // retainedSounds still holds the old sound, so it is not freed here
+    void adoptPendingSound() noexcept
+    {
+        if (auto* sound = pendingSound.exchange(nullptr, std::memory_order_acquire))
+        {
+            sounds.set(0, sound);
+            adoptedSound.store(sound, std::memory_order_release);
+        }
+    }
+
+    // Sounds published before the adopted one can never reach the audio thread again,
+    // so once retainedSounds holds their only reference they can go
+    void releaseRetiredSounds()
+    {
+        const auto adoptedIndex = retainedSounds.indexOf(adoptedSound.load(std::memory_order_acquire));
+
+        for (int i = adoptedIndex; --i >= 0;)
+            if (retainedSounds.getObjectPointerUnchecked(i)->getReferenceCount() == 1)
+                retainedSounds.remove(i);
+    }
+
+    WavetableVoice* getLaneVoice(int lane) const noexcept
+    {
+        return static_cast<WavetableVoice*>(voices.getUnchecked(lane));
+    }
+
+    template <typename SampleType>
+    void renderVoicesThroughFilters(juce::AudioBuffer<SampleType>& outputAudio, const juce::MidiBuffer& midi,
+                                    int startSample, int numSamples) noexcept
+    {
+        // Only ever holds WavetableVoices, one per filter lane
+        jassert(voices.size() <= VoiceFilterBank::maxVoices);
+
+        const auto numVoices = juce::jmin(voices.size(), VoiceFilterBank::maxVoices);
+        auto event = midi.findNextSamplePosition(startSample);
+
+        while (numSamples > 0)
+        {
+            const auto numThisTime = juce::jmin(numSamples, blockSize);
+
+            {
+                ARMONIO_TRACE_SCOPE("renderVoicesToLanes");
+
+                filterBank.clearLanes(numThisTime);
+                schedule.clear();
+
+                for (int i = 0; i < numVoices; ++i)
+                    getLaneVoice(i)->beginBlock(schedule,
+                                                filterBank.getLaneWritePointer(0, i),
+                                                filterBank.getLaneWritePointer(1, i),
+                                                VoiceFilterBank::laneStride);
+
+                // Events in time order; a voice an event reaches renders itself up to it first
+                for (; event != midi.cend() && (*event).samplePosition < startSample + numThisTime; ++event)
+                {
+                    const auto metadata = *event;
+                    const auto message = metadata.getMessage();
+                    schedule.eventPosition = metadata.samplePosition - startSample;
+
+                    if (message.isControllerOfType(1))
+                        schedule.addModWheelEvent(schedule.eventPosition, (float)message.getControllerValue() / 127.0f);
+
+                    handleMidiEvent(message);
+                }
+
+                // Then every sounding voice finishes the block in one go
+                auto numActiveVoices = 0;
+
+                for (int i = 0; i < numVoices; ++i)
+                    if (getLaneVoice(i)->isVoiceActive())
+                        activeVoices[(size_t)numActiveVoices++] = i;
+
+                if (isRenderingInParallel && renderPool != nullptr && numActiveVoices > 1)
+                {
+                    renderVoicesInParallel(numActiveVoices, numThisTime);
+                }
+                else
+                {
+                    for (int index = 0; index < numActiveVoices; ++index)
+                        getLaneVoice(activeVoices[(size_t)index])->renderUpTo(numThisTime);
+                }
+
+                // A voice that finished during the block still left a tail in its lane
+                for (int i = 0; i < numVoices; ++i)
+                {
+                    auto* voice = getLaneVoice(i);
+                    filterBank.setLaneActive(i, voice->isVoiceActive() || voice->hasSoundedInBlock());
+                }
+            }
+
+            {
+                ARMONIO_TRACE_SCOPE("voiceFilterBank");
+
+                for (int offset = 0; offset < numThisTime; offset += VoiceFilterBank::controlBlockSize)
+                {
+                    const auto numControl = juce::jmin(VoiceFilterBank::controlBlockSize, numThisTime - offset);
+
+                    for (int i = 0; i < numVoices; ++i)
+                    {
+                        if (! filterBank.isLaneActive(i))
+                            continue;
+
+                        auto* voice = getLaneVoice(i);
+
+                        if (voice->consumeFilterReset(offset, numControl))
+                            filterBank.resetLane(i);
+
+                        filterBank.setCutoff(i, voice->getFilterCutoff(offset / VoiceFilterBank::controlBlockSize));
+                    }
+
+                    filterBank.process(offset, numControl);
+                }
+
+                filterBank.addTo(outputAudio, startSample, numThisTime);
+            }
+
+            for (int i = 0; i < numVoices; ++i)
+                getLaneVoice(i)->endBlock();
+
+            startSample += numThisTime;
+            numSamples -= numThisTime;
+        }
+    }
+
+    VoiceFilterBank filterBank;
+    std::array<int, VoiceFilterBank::maxVoices> activeVoices {};
+    int blockSize = realtimeBlockSize;
+    int voiceLimit = VoiceFilterBank::maxVoices;
+
+    // Shared with the voices during each block
+    VoiceSchedule schedule;
+    const juce::MidiBuffer noEvents;
+
+    ParallelRenderPool* renderPool = nullptr;
+    bool isRenderingInParallel = false;
+
+    // One contiguous stereo block per active voice, and where in it each one resumes
+    std::vector<float> voiceBuffers;
+    std::array<int, VoiceFilterBank::maxVoices> resumePositions {};
+
+    void renderVoicesInParallel(int numActiveVoices, int numSamples) noexcept
+    {
+        // Events may already have rendered the start of some voices into their lanes
+        for (int index = 0; index < numActiveVoices; ++index)
+            resumePositions[(size_t)index] = getLaneVoice(activeVoices[(size_t)index])->getBlockPosition();
+
+        // Lanes interleave the voices sample by sample, so threads writing them
+        // directly would fight over the same cache lines. Each voice renders the rest
+        // of the block into a buffer of its own instead, and the main thread
+        // interleaves them afterwards.
+        auto renderVoice = [this, numSamples](int index)
+        {
+            const auto from = resumePositions[(size_t)index];
+            auto* left = voiceBuffers.data() + (size_t)(index * 2 * VoiceFilterBank::maxBlockSize);
+            auto* right = left + VoiceFilterBank::maxBlockSize;
+
+            juce::FloatVectorOperations::clear(left + from, numSamples - from);
+            juce::FloatVectorOperations::clear(right + from, numSamples - from);
+
+            getLaneVoice(activeVoices[(size_t)index])->renderUpTo(numSamples, left, right, 1);
+        };
+
+        renderPool->forEach(numActiveVoices, renderVoice);
+
+        for (int index = 0; index < numActiveVoices; ++index)
+        {
+            const auto* left = voiceBuffers.data() + (size_t)(index * 2 * VoiceFilterBank::maxBlockSize);
+            const auto* right = left + VoiceFilterBank::maxBlockSize;
+            auto* laneLeft = filterBank.getLaneWritePointer(0, activeVoices[(size_t)index]);
+            auto* laneRight = filterBank.getLaneWritePointer(1, activeVoices[(size_t)index]);
+
+            // That part of the lanes is still clear, so this matches rendering into them directly
+            for (int n = resumePositions[(size_t)index]; n < numSamples; ++n)
+            {
+                laneLeft[n * VoiceFilterBank::laneStride] = left[n];
+                laneRight[n * VoiceFilterBank::laneStride] = right[n];
+            }
+        }
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+//==============================================================================
+// Carries a decimated mono copy of the output bus from the audio thread to the
+// editor. Single producer, single consumer; pushing never locks or allocates, and
+// is skipped entirely while no editor is listening.
+class AudioScopeFifo
+{
+public:
+    static constexpr int capacity = 8192;
+    static constexpr int decimationFactor = 2;
+
+    AudioScopeFifo()
+    {
+        samples.calloc((size_t)capacity);
+    }
+
+    // Called from the message thread when an editor starts or stops listening
+    void setActive(bool shouldBeActive) noexcept
+    {
+        active.store(shouldBeActive, std::memory_order_release);
+    }
+
+    // Audio thread: appends the decimated block, dropping frames if the reader has fallen behind
+    template <typename SampleType>
+    void push(const juce::AudioBuffer<SampleType>& source, int startSample, int numSamples) noexcept
+    {
+        const auto numChannels = source.getNumChannels();
+
+        if (! active.load(std::memory_order_acquire) || numChannels == 0)
+            return;
+
+        const auto gain = 1.0f / (float)(numChannels * decimationFactor);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples / decimationFactor + 1, start1, size1, start2, size2);
+
+        int numWritten = 0;
+
+        for (int i = startSample; i < startSample + numSamples; ++i)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                accumulator += (float)source.getSample(ch, i);
+
+            if (++numAccumulated < decimationFactor)
+                continue;
+
+            const auto frame = accumulator * gain;
+            accumulator = 0.0f;
+            numAccumulated = 0;
+
+            if (numWritten < size1)
+                samples[start1 + numWritten] = frame;
+            else if (numWritten < size1 + size2)
+                samples[start2 + numWritten - size1] = frame;
+            else
+                continue;
+
+            ++numWritten;
+        }
+
+        fifo.finishedWrite(numWritten);
+    }
+
+    // Message thread: copies up to maxSamples pending frames into dest and returns how many
+    int pull(float* dest, int maxSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            juce::FloatVectorOperations::copy(dest, samples + start1, size1);
+
+        if (size2 > 0)
+            juce::FloatVectorOperations::copy(dest + size1, samples + start2, size2);
+
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    juce::HeapBlock<float> samples;
+    std::atomic<bool> active { false };
+
+    // Audio thread only
+    float accumulator = 0.0f;
+    int numAccumulated = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(AudioScopeFifo)
+};
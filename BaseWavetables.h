@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+//==============================================================================
+// The single-harmonic tables, generated at compile time so that constructing a
+// synth does no trig at all.
+//
+// With one harmonic the sine, square and triangle generators all reduce to a
+// normalised sine, and the saw generator to its slightly detuned sine. The values
+// match WaveformGenerator's output to within float rounding.
+class BaseWavetables
+{
+public:
+    static constexpr std::size_t tableSize = 2048;
+
+    using Table = std::array<float, tableSize + 1>;
+
+    static constexpr double sawDetune = (double)1.05f;
+
+    // constexpr std::sin is not available before C++26
+    static constexpr double sine(double x)
+    {
+        constexpr double twoPi = 6.283185307179586476925286766559;
+
+        // Reduce to [-pi, pi]
+        auto turns = (long long)(x / twoPi + (x >= 0.0 ? 0.5 : -0.5));
+        x -= (double)turns * twoPi;
+
+        // Taylor series; 14 terms are exact to double precision on [-pi, pi]
+        const auto xSquared = x * x;
+        auto term = x;
+        auto sum = x;
+
+        for (int n = 1; n < 14; ++n)
+        {
+            term *= -xSquared / (double)((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    // Mirrors WaveformGenerator: one period spans tableSize steps and the guard
+    // sample repeats the first one
+    static constexpr Table makeTable(double frequencyMultiplier)
+    {
+        constexpr double twoPi = 6.283185307179586476925286766559;
+        const auto angleDelta = twoPi / (double)tableSize;
+
+        Table table {};
+        float maxVal = 0.0f;
+
+        for (std::size_t i = 0; i < tableSize; ++i)
+        {
+            table[i] = (float)sine((double)i * angleDelta * frequencyMultiplier);
+
+            auto absVal = table[i] < 0.0f ? -table[i] : table[i];
+            if (absVal > maxVal)
+                maxVal = absVal;
+        }
+
+        if (maxVal > 0.0f)
+        {
+            const float scale = 1.0f / maxVal;
+            for (std::size_t i = 0; i < tableSize; ++i)
+                table[i] *= scale;
+        }
+
+        table[tableSize] = table[0];
+        return table;
+    }
+
+    // Waveform parameter index: 0=Sine, 1=Saw, 2=Square, 3=Triangle
+    static constexpr const Table& get(int waveformType);
+};
+
+namespace BaseWavetableData
+{
+    inline constexpr BaseWavetables::Table fundamental = BaseWavetables::makeTable(1.0);
+    inline constexpr BaseWavetables::Table detunedFundamental = BaseWavetables::makeTable(BaseWavetables::sawDetune);
+}
+
+constexpr const BaseWavetables::Table& BaseWavetables::get(int waveformType)
+{
+    return waveformType == 1 ? BaseWavetableData::detunedFundamental : BaseWavetableData::fundamental;
+}
@@ -0,0 +1,591 @@
+#include "EffectsBus.h"
+#include "TraceRecorder.h"
+#include <thread>
+
+//==============================================================================
+bool SharedReverbSend::join(const void* member, Lane& lane)
+{
+    const std::lock_guard<std::mutex> sl(membershipLock);
+
+    if (members.contains(member))
+        return true;
+
+    const auto numSlots = numLaneSlots.load();
+    auto slot = 0;
+
+    while (slot < numSlots && lanes[(size_t)slot].load() != nullptr)
+        ++slot;
+
+    if (slot == maxMembers)
+        return false;
+
+    lanes[(size_t)slot].store(&lane);
+    numLaneSlots.store(juce::jmax(numSlots, slot + 1));
+    members.add(member);
+
+    if (owner.load() == nullptr)
+        owner.store(member, std::memory_order_release);
+
+    return true;
+}
+
+void SharedReverbSend::leave(const void* member, Lane& lane)
+{
+    {
+        const std::lock_guard<std::mutex> sl(membershipLock);
+
+        if (! members.contains(member))
+            return;
+
+        members.removeFirstMatchingValue(member);
+
+        if (owner.load() == member)
+            owner.store(members.isEmpty() ? nullptr : members.getFirst(), std::memory_order_release);
+
+        for (auto& slot : lanes)
+            if (slot.load() == &lane)
+                slot.store(nullptr);
+    }
+
+    // A read that started before the lane was removed may still be using it; one
+    // that starts now can't see it
+    const auto sequence = readSequence.load();
+
+    if ((sequence & 1) != 0)
+        while (readSequence.load() == sequence)
+            std::this_thread::yield();
+}
+
+void SharedReverbSend::addSend(Lane& lane, const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    // Anything past half the lane is dropped, so that a member always fits ahead of the owner
+    const auto numToAdd = juce::jmin(numSamples, capacity / 2);
+
+    if (numToAdd <= 0)
+        return;
+
+    const auto position = readPosition.load(std::memory_order_acquire);
+    auto writePosition = lane.writePosition;
+
+    auto writeToRing = [&lane] (const juce::AudioBuffer<float>* source, juce::int64 start, int num)
+    {
+        const auto index = (int)(start % capacity);
+        const auto numBeforeWrap = juce::jmin(num, capacity - index);
+
+        for (int ch = 0; ch < Lane::numChannels; ++ch)
+        {
+            auto* ring = lane.getChannel(ch);
+
+            if (source == nullptr)
+            {
+                juce::FloatVectorOperations::clear(ring + index, numBeforeWrap);
+                juce::FloatVectorOperations::clear(ring, num - numBeforeWrap);
+                continue;
+            }
+
+            const auto* sourceSamples = source->getReadPointer(juce::jmin(ch, source->getNumChannels() - 1));
+            juce::FloatVectorOperations::copy(ring + index, sourceSamples, numBeforeWrap);
+            juce::FloatVectorOperations::copy(ring, sourceSamples + numBeforeWrap, num - numBeforeWrap);
+        }
+    };
+
+    if (writePosition < position)
+    {
+        // Silence up to where the owner will read next; it has already passed the rest
+        const auto resyncPosition = position + lastNumTaken.load(std::memory_order_relaxed);
+        writeToRing(nullptr, position, (int)(resyncPosition - position));
+        writePosition = resyncPosition;
+    }
+    else if (writePosition + numToAdd > position + capacity)
+    {
+        lane.hasOverrun.store(true, std::memory_order_release);
+        return;
+    }
+
+    writeToRing(&buffer, writePosition, numToAdd);
+
+    lane.writePosition = writePosition + numToAdd;
+    lane.writtenUpTo.store(lane.writePosition, std::memory_order_release);
+}
+
+bool SharedReverbSend::takeSends(juce::AudioBuffer<float>& destination, int numSamples) noexcept
+{
+    return consumeSends(&destination, numSamples);
+}
+
+void SharedReverbSend::discardSends(int numSamples) noexcept
+{
+    consumeSends(nullptr, numSamples);
+}
+
+bool SharedReverbSend::consumeSends(juce::AudioBuffer<float>* destination, int numSamples) noexcept
+{
+    const auto numToTake = juce::jlimit(0, capacity / 2, numSamples);
+
+    // Only one reader at a time: while ownership moves, the old owner may still be
+    // in its block, and the new one skips the read rather than wait for it
+    auto sequence = readSequence.load();
+
+    if ((sequence & 1) != 0 || ! readSequence.compare_exchange_strong(sequence, sequence + 1))
+        return false;
+
+    auto position = readPosition.load(std::memory_order_relaxed);
+    const auto numSlots = numLaneSlots.load();
+
+    // A member that got too far ahead while this owner wasn't reading pulls the
+    // read up to its own writes
+    for (int slot = 0; slot < numSlots; ++slot)
+        if (auto* lane = lanes[(size_t)slot].load())
+            if (lane->hasOverrun.exchange(false, std::memory_order_acquire))
+                position = juce::jmax(position, lane->writtenUpTo.load(std::memory_order_acquire));
+
+    auto hasSends = false;
+
+    for (int slot = 0; slot < numSlots; ++slot)
+    {
+        auto* lane = lanes[(size_t)slot].load();
+
+        if (lane == nullptr)
+            continue;
+
+        const auto numWaiting = (int)juce::jlimit((juce::int64)0, (juce::int64)numToTake,
+                                                  lane->writtenUpTo.load(std::memory_order_acquire) - position);
+
+        if (numWaiting == 0)
+            continue;
+
+        hasSends = true;
+
+        if (destination != nullptr)
+        {
+            const auto index = (int)(position % capacity);
+            const auto numBeforeWrap = juce::jmin(numWaiting, capacity - index);
+
+            for (int ch = 0; ch < juce::jmin((int)Lane::numChannels, destination->getNumChannels()); ++ch)
+            {
+                const auto* ring = lane->getChannel(ch);
+                auto* samples = destination->getWritePointer(ch);
+
+                juce::FloatVectorOperations::add(samples, ring + index, numBeforeWrap);
+                juce::FloatVectorOperations::add(samples + numBeforeWrap, ring, numWaiting - numBeforeWrap);
+            }
+        }
+    }
+
+    readPosition.store(position + numToTake, std::memory_order_release);
+
+    if (numToTake > 0)
+        lastNumTaken.store(numToTake, std::memory_order_relaxed);
+
+    readSequence.store(sequence + 2, std::memory_order_release);
+    return hasSends;
+}
+
+//==============================================================================
+// One build on the shared builder thread, tagged with the bus it builds for so
+// that a bus can take back its own jobs without touching anyone else's
+class EffectsBus::BuildJob : public juce::ThreadPoolJob
+{
+public:
+    BuildJob(EffectsBus& busToBuildFor, int buildNumber)
+        : juce::ThreadPoolJob("Reverb build"), bus(busToBuildFor), build(buildNumber),
+          file(bus.impulseFile), seconds(bus.builtSize), sampleRate(bus.currentSampleRate)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        if (! shouldExit())
+            bus.buildReverb(build, file, seconds, sampleRate);
+
+        --bus.numBuildsQueued;
+        return jobHasFinished;
+    }
+
+    struct Selector : public juce::ThreadPool::JobSelector
+    {
+        explicit Selector(const EffectsBus& busToSelect) : bus(busToSelect) {}
+
+        bool isJobSuitable(juce::ThreadPoolJob* job) override
+        {
+            auto* buildJob = dynamic_cast<BuildJob*>(job);
+            return buildJob != nullptr && &buildJob->bus == &bus;
+        }
+
+        const EffectsBus& bus;
+    };
+
+private:
+    EffectsBus& bus;
+    const int build;
+    const juce::File file;
+    const float seconds;
+    const double sampleRate;
+};
+
+EffectsBus::EffectsBus() = default;
+
+EffectsBus::~EffectsBus()
+{
+    if (isSharing.load())
+        sharedSend->leave(this, *sendLane);
+
+    // Takes back this bus's waiting builds and waits for a running one, which
+    // uses the bus; other instances' builds carry on
+    BuildJob::Selector ownJobs(*this);
+    builder->pool.removeAllJobs(true, -1, &ownJobs);
+}
+
+void EffectsBus::prepare(double sampleRate, int maximumBlockSize)
+{
+    // The callback is stopped while the host prepares, so the audio-thread state
+    // can be replaced from here
+    const auto blockSize = juce::jmax(maximumBlockSize, PartitionedConvolver::headSize);
+    sendBuffer.setSize(2, blockSize);
+    wetBuffer.setSize(2, blockSize);
+    tailSamplesRemaining = 0;
+
+    if (sampleRate != currentSampleRate)
+    {
+        currentSampleRate = sampleRate;
+        convolver.reset();
+        rebuildReverb();
+    }
+    else if (convolver != nullptr)
+    {
+        convolver->reset();
+    }
+}
+
+void EffectsBus::setReverbSize(float seconds)
+{
+    reverbSize.store(seconds, std::memory_order_relaxed);
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        applySettings();
+}
+
+void EffectsBus::setSharedReverb(bool shouldShare)
+{
+    wantsSharing.store(shouldShare, std::memory_order_relaxed);
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        applySettings();
+}
+
+void EffectsBus::applySettings()
+{
+    const auto shouldShare = wantsSharing.load(std::memory_order_relaxed);
+
+    if (shouldShare != isSharing.load())
+    {
+        if (shouldShare)
+        {
+            if (sendLane == nullptr)
+                sendLane = std::make_unique<SharedReverbSend::Lane>();
+
+            // With every lane taken the instance keeps its own reverb and tries again next time
+            isSharing.store(sharedSend->join(this, *sendLane), std::memory_order_release);
+        }
+        else
+        {
+            sharedSend->leave(this, *sendLane);
+            isSharing.store(false, std::memory_order_release);
+        }
+    }
+
+    const auto size = reverbSize.load(std::memory_order_relaxed);
+
+    if (size != builtSize)
+    {
+        builtSize = size;
+
+        if (impulseFile == juce::File())
+            rebuildReverb();
+    }
+}
+
+void EffectsBus::loadImpulseResponse(const juce::File& file)
+{
+    if (file == impulseFile)
+        return;
+
+    impulseFile = file;
+    rebuildReverb();
+}
+
+double EffectsBus::getTailLengthSeconds() const noexcept
+{
+    if (sendLevel.load(std::memory_order_relaxed) <= 0.0f || currentSampleRate <= 0.0)
+        return 0.0;
+
+    return impulseLengthSamples.load() / currentSampleRate;
+}
+
+bool EffectsBus::isReverbReady() const
+{
+    const juce::SpinLock::ScopedLockType sl(swapLock);
+    return numBuildsQueued.load() == 0 && pendingConvolver == nullptr;
+}
+
+//==============================================================================
+void EffectsBus::rebuildReverb()
+{
+    if (currentSampleRate <= 0.0)
+        return;
+
+    // Only the latest request is worth building, e.g. while the size is being dragged
+    const auto build = ++latestBuild;
+    ++numBuildsQueued;
+
+    builder->pool.addJob(new BuildJob(*this, build), true);
+}
+
+void EffectsBus::buildReverb(int build, const juce::File& file, float seconds, double sampleRate)
+{
+    if (build != latestBuild.load())
+        return;
+
+    ARMONIO_TRACE_SCOPE("EffectsBus::buildReverb");
+
+    auto fileSampleRate = sampleRate;
+    auto impulse = file.existsAsFile() ? readImpulseResponse(file, fileSampleRate)
+                                       : juce::AudioBuffer<float>();
+
+    if (impulse.getNumSamples() == 0)
+    {
+        impulse = generateImpulseResponse(seconds, sampleRate);
+        fileSampleRate = sampleRate;
+    }
+
+    // Bring the response to the processing rate
+    if (fileSampleRate != sampleRate && impulse.getNumSamples() > 8)
+    {
+        const auto ratio = fileSampleRate / sampleRate;
+        const auto numResampled = (int)((impulse.getNumSamples() - 4) / ratio);
+
+        juce::AudioBuffer<float> resampled(impulse.getNumChannels(), juce::jmax(1, numResampled));
+        resampled.clear();
+
+        for (int ch = 0; ch < impulse.getNumChannels(); ++ch)
+        {
+            juce::LagrangeInterpolator interpolator;
+            interpolator.process(ratio, impulse.getReadPointer(ch), resampled.getWritePointer(ch), numResampled);
+        }
+
+        impulse = std::move(resampled);
+    }
+
+    // Unit energy per channel on average, so the send level alone sets the reverb level
+    double energy = 0.0;
+
+    for (int ch = 0; ch < impulse.getNumChannels(); ++ch)
+        for (int i = 0; i < impulse.getNumSamples(); ++i)
+            energy += (double)impulse.getSample(ch, i) * impulse.getSample(ch, i);
+
+    if (energy > 0.0)
+        impulse.applyGain((float)(1.0 / std::sqrt(energy / impulse.getNumChannels())));
+
+    impulseLengthSamples.store(impulse.getNumSamples());
+
+    if (build == latestBuild.load())
+        publish(std::make_unique<PartitionedConvolver>(impulse, 2));
+}
+
+void EffectsBus::publish(std::unique_ptr<PartitionedConvolver> newConvolver)
+{
+    std::unique_ptr<PartitionedConvolver> retired, superseded;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(swapLock);
+        retired = std::move(retiredConvolver);
+        superseded = std::move(pendingConvolver);
+        pendingConvolver = std::move(newConvolver);
+    }
+
+    // Both are freed here, on the builder thread, once the lock is released
+}
+
+juce::AudioBuffer<float> EffectsBus::readImpulseResponse(const juce::File& file, double& fileSampleRate)
+{
+    // Anything longer than this is almost certainly not meant as a reverb
+    constexpr double maxSeconds = 10.0;
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+        return {};
+
+    const auto numSamples = (int)juce::jmin((juce::int64)(maxSeconds * reader->sampleRate), reader->lengthInSamples);
+    const auto numChannels = (int)juce::jlimit(1u, 2u, reader->numChannels);
+
+    juce::AudioBuffer<float> impulse(numChannels, numSamples);
+    reader->read(&impulse, 0, numSamples, 0, true, numChannels > 1);
+
+    fileSampleRate = reader->sampleRate;
+    return impulse;
+}
+
+juce::AudioBuffer<float> EffectsBus::generateImpulseResponse(float seconds, double sampleRate)
+{
+    // Decorrelated noise on each side that falls by 60 dB over the given time and
+    // loses its highs as it decays
+    const auto numSamples = juce::jmax(PartitionedConvolver::headSize, (int)(seconds * sampleRate));
+    const auto fadeInSamples = (int)(0.002 * sampleRate);
+
+    juce::AudioBuffer<float> impulse(2, numSamples);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        FastRandom random;
+        random.setSeed(0x5eedu + (juce::uint64)ch);
+
+        auto* samples = impulse.getWritePointer(ch);
+        auto lowPassed = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto position = (float)i / (float)numSamples;
+            const auto decay = std::exp(-6.9078f * position);
+            const auto brightness = 0.9f - 0.7f * position;
+
+            lowPassed += brightness * ((2.0f * random.nextFloat() - 1.0f) - lowPassed);
+            samples[i] = lowPassed * decay * juce::jmin(1.0f, (float)i / (float)juce::jmax(1, fadeInSamples));
+        }
+    }
+
+    return impulse;
+}
+
+//==============================================================================
+namespace
+{
+    // Float buffers use the vector routines; a double bus converts sample by sample
+    template <typename Destination, typename Source>
+    void copyWithGain(Destination* destination, const Source* source, int numSamples, float gain) noexcept
+    {
+        if constexpr (std::is_same_v<Destination, Source>)
+            juce::FloatVectorOperations::copyWithMultiply(destination, source, (Source)gain, numSamples);
+        else
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] = (Destination)(source[i] * gain);
+    }
+
+    template <typename Destination, typename Source>
+    void addWithGain(Destination* destination, const Source* source, int numSamples, float gain) noexcept
+    {
+        if constexpr (std::is_same_v<Destination, Source>)
+            juce::FloatVectorOperations::addWithMultiply(destination, source, (Source)gain, numSamples);
+        else
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] += (Destination)(source[i] * gain);
+    }
+}
+
+template <typename SampleType>
+bool EffectsBus::process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, bool inputIsSilent) noexcept
+{
+    ARMONIO_TRACE_SCOPE("EffectsBus::process");
+
+    {
+        // Never waits: if the builder is publishing right now, the swap happens next block
+        const juce::SpinLock::ScopedTryLockType sl(swapLock);
+
+        if (sl.isLocked() && pendingConvolver != nullptr && retiredConvolver == nullptr)
+        {
+            retiredConvolver = std::move(convolver);
+            convolver = std::move(pendingConvolver);
+        }
+    }
+
+    const auto send = sendLevel.load(std::memory_order_relaxed);
+    const auto hasSend = ! inputIsSilent && send > 0.0f;
+    const auto sharing = isSharing.load(std::memory_order_acquire);
+    const auto isOwner = sharing && sharedSend->isOwner(this);
+
+    // Sharing but not the owner: the owner's reverb returns our send in its output
+    const auto isSendOnly = sharing && ! isOwner;
+
+    if (isSendOnly && ! hasSend)
+        return false;
+
+    if (! isSendOnly && convolver == nullptr)
+    {
+        // Nothing to render the sends with, but they are still taken to keep members in step
+        if (isOwner)
+            sharedSend->discardSends(numSamples);
+
+        return false;
+    }
+
+    const auto numOutputChannels = juce::jmin(2, buffer.getNumChannels());
+    auto producedOutput = false;
+
+    while (numSamples > 0)
+    {
+        const auto numThisTime = juce::jmin(numSamples, sendBuffer.getNumSamples());
+        auto hasInput = hasSend;
+
+        if (hasSend)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                copyWithGain(sendBuffer.getWritePointer(ch),
+                             buffer.getReadPointer(juce::jmin(ch, numOutputChannels - 1), startSample),
+                             numThisTime, send);
+        }
+        else
+        {
+            sendBuffer.clear(0, numThisTime);
+        }
+
+        if (isSendOnly)
+        {
+            sharedSend->addSend(*sendLane, sendBuffer, numThisTime);
+        }
+        else
+        {
+            if (isOwner)
+                hasInput = sharedSend->takeSends(sendBuffer, numThisTime) || hasInput;
+
+            // Stop once the last input has rung out and the convolver holds only silence,
+            // so that it can pick up again later as if it had been running all along.
+            // An owner goes on through the block to take the rest of the sends.
+            if (hasInput)
+                tailSamplesRemaining = convolver->getFlushLength();
+            else if (tailSamplesRemaining <= 0 && ! isOwner)
+                break;
+
+            if (tailSamplesRemaining > 0)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                    convolver->process(ch, sendBuffer.getReadPointer(ch), wetBuffer.getWritePointer(ch), numThisTime);
+
+                if (numOutputChannels == 1)
+                {
+                    auto* mono = buffer.getWritePointer(0, startSample);
+                    addWithGain(mono, wetBuffer.getReadPointer(0), numThisTime, 0.5f);
+                    addWithGain(mono, wetBuffer.getReadPointer(1), numThisTime, 0.5f);
+                }
+                else
+                {
+                    for (int ch = 0; ch < numOutputChannels; ++ch)
+                        addWithGain(buffer.getWritePointer(ch, startSample), wetBuffer.getReadPointer(ch), numThisTime, 1.0f);
+                }
+
+                producedOutput = true;
+                tailSamplesRemaining -= numThisTime;
+            }
+        }
+
+        startSample += numThisTime;
+        numSamples -= numThisTime;
+    }
+
+    return producedOutput;
+}
+
+template bool EffectsBus::process(juce::AudioBuffer<float>&, int, int, bool) noexcept;
+template bool EffectsBus::process(juce::AudioBuffer<double>&, int, int, bool) noexcept;
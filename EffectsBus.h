@@ -0,0 +1,187 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_events/juce_events.h>
+#include <array>
+#include <mutex>
+#include "FastRandom.h"
+#include "PartitionedConvolver.h"
+
+//==============================================================================
+// Process-wide send bus for a reverb shared by several synth instances.
+//
+// Every instance that shares the reverb writes its send into a lane of its own.
+// One of them, the owner, takes the next stretch of every lane each block, runs
+// the sum through its own reverb and returns the result in its output, so N
+// instances cost one convolution instead of N. Each lane has one writer and one
+// reader, so no audio thread ever waits for another.
+//
+// Positions in the lanes are running sample counts: the owner reads at its own,
+// and each member writes at one it keeps for itself, so every send is taken
+// exactly once whichever instance the host runs first. A member starts one block
+// ahead of the owner's read and stays there, so its sends come back one block
+// late, or two if the owner ran first in the block the member started in. Hold
+// it through juce::SharedResourcePointer<SharedReverbSend>.
+class SharedReverbSend
+{
+public:
+    static constexpr int capacity = 16384;
+    static constexpr int maxMembers = 64;
+
+    // One member's sends, written only by that member and read only by the owner
+    class Lane
+    {
+    public:
+        Lane() { samples.calloc((size_t)(numChannels * capacity)); }
+
+    private:
+        friend class SharedReverbSend;
+
+        // Raw samples rather than an AudioBuffer, whose clear flag both threads would write
+        static constexpr int numChannels = 2;
+        juce::HeapBlock<float> samples;
+        float* getChannel(int channel) const noexcept { return samples.get() + channel * capacity; }
+
+        juce::int64 writePosition = 0;
+        std::atomic<juce::int64> writtenUpTo { 0 };
+        std::atomic<bool> hasOverrun { false };
+
+        JUCE_DECLARE_NON_COPYABLE(Lane)
+    };
+
+    // Message thread. The first member to join owns the reverb; if the owner leaves,
+    // another member takes over. join() returns false if every lane is taken. The
+    // lane has to outlive the membership: leave() waits for the owner to finish
+    // with it.
+    bool join(const void* member, Lane& lane);
+    void leave(const void* member, Lane& lane);
+
+    // Audio thread
+    bool isOwner(const void* member) const noexcept { return owner.load(std::memory_order_acquire) == member; }
+
+    // Members: writes numSamples from the start of the buffer to the lane. A member
+    // that has fallen behind the owner starts again just past the owner's next read,
+    // taken to be as long as its last; one that got too far ahead, because the owner
+    // stopped taking sends, drops them until the owner catches up with it.
+    void addSend(Lane& lane, const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    // Owner: adds the next numSamples of sends to the destination, or just skips
+    // them. Returns false if none were waiting. The owner has to take every sample
+    // it renders, with or without a reverb, to keep members in step.
+    bool takeSends(juce::AudioBuffer<float>& destination, int numSamples) noexcept;
+    void discardSends(int numSamples) noexcept;
+
+private:
+    std::mutex membershipLock;
+    juce::Array<const void*> members;
+    std::atomic<const void*> owner { nullptr };
+
+    // Set on the message thread; slots past numLaneSlots are always empty
+    std::array<std::atomic<Lane*>, maxMembers> lanes {};
+    std::atomic<int> numLaneSlots { 0 };
+
+    std::atomic<juce::int64> readPosition { 0 };
+    std::atomic<int> lastNumTaken { 0 };
+
+    // Odd while an owner reads, which keeps a second owner out while ownership
+    // moves and tells leave() when a lane is no longer being read
+    std::atomic<juce::uint32> readSequence { 0 };
+
+    bool consumeSends(juce::AudioBuffer<float>* destination, int numSamples) noexcept;
+};
+
+//==============================================================================
+// The one background thread every EffectsBus in the process builds its impulse
+// responses on, so that a session of many instances doesn't hold a thread for
+// each. Hold it through juce::SharedResourcePointer<ReverbBuilderThread>.
+struct ReverbBuilderThread
+{
+    juce::ThreadPool pool { 1 };
+};
+
+//==============================================================================
+// Effects applied to the synth's summed output: a convolution reverb fed from a
+// send, mixed back in after the dry signal.
+//
+// Impulse responses are read, resampled and partitioned on a background thread,
+// then handed to the audio thread, which swaps them in without blocking or
+// freeing anything. Without a file the reverb uses a generated decaying-noise
+// response whose length is the size setting.
+class EffectsBus
+{
+public:
+    EffectsBus();
+    ~EffectsBus();
+
+    // Message thread. Rebuilds the current impulse response for the new rate in the background.
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    void setReverbSend(float newSendLevel) noexcept { sendLevel.store(newSendLevel, std::memory_order_relaxed); }
+
+    // Any thread. Rebuilding the response and joining or leaving the shared reverb
+    // lock and allocate, so they happen at once only on the message thread; a call
+    // from anywhere else, e.g. host automation, waits for applySettings().
+    void setReverbSize(float seconds);
+    void setSharedReverb(bool shouldShare);
+
+    // Message thread: catches up with the size and sharing the setters last asked for
+    void applySettings();
+
+    // Message thread; an empty file goes back to the generated response
+    void loadImpulseResponse(const juce::File& file);
+
+    // Seconds of tail after the input stops, for getTailLengthSeconds()
+    double getTailLengthSeconds() const noexcept;
+
+    // Audio thread: adds the reverb return to the block. inputIsSilent lets an idle
+    // instance skip the send; the tail is still rendered. Returns false if nothing
+    // was added.
+    // Defined for float and double buffers; the reverb itself always runs in float.
+    template <typename SampleType>
+    bool process(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, bool inputIsSilent) noexcept;
+
+    // For tests: true once no impulse response is waiting to be built or swapped in
+    bool isReverbReady() const;
+
+private:
+    // Whether the reverb keeps rendering: the send level, or a tail still ringing
+    std::atomic<float> sendLevel { 0.0f };
+    int tailSamplesRemaining = 0;
+
+    // Audio-thread state, sized in prepare()
+    std::unique_ptr<PartitionedConvolver> convolver;
+    juce::AudioBuffer<float> sendBuffer;
+    juce::AudioBuffer<float> wetBuffer;
+
+    // Built convolvers wait in pending until the audio thread swaps them for the
+    // one it was using, which waits in retired to be freed by the next build
+    juce::SpinLock swapLock;
+    std::unique_ptr<PartitionedConvolver> pendingConvolver;
+    std::unique_ptr<PartitionedConvolver> retiredConvolver;
+
+    // Settings the builder works from, all but the requested size kept on the message thread
+    std::atomic<float> reverbSize { 2.0f };
+    juce::File impulseFile;
+    float builtSize = 2.0f;
+    double currentSampleRate = 0.0;
+    std::atomic<int> numBuildsQueued { 0 };
+    std::atomic<int> latestBuild { 0 };
+    std::atomic<int> impulseLengthSamples { 0 };
+
+    juce::SharedResourcePointer<ReverbBuilderThread> builder;
+    class BuildJob;
+
+    juce::SharedResourcePointer<SharedReverbSend> sharedSend;
+    std::atomic<bool> wantsSharing { false };
+    std::atomic<bool> isSharing { false };
+    std::unique_ptr<SharedReverbSend::Lane> sendLane;
+
+    void rebuildReverb();
+    void buildReverb(int build, const juce::File& file, float seconds, double sampleRate);
+    static juce::AudioBuffer<float> readImpulseResponse(const juce::File& file, double& fileSampleRate);
+    static juce::AudioBuffer<float> generateImpulseResponse(float seconds, double sampleRate);
+    void publish(std::unique_ptr<PartitionedConvolver> newConvolver);
+
+    JUCE_DECLARE_NON_COPYABLE(EffectsBus)
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+// Small PCG32 generator. Each voice owns one, so the audio thread never touches
+// juce::Random::getSystemRandom() and a given seed always gives the same sequence.
+class FastRandom
+{
+public:
+    FastRandom() noexcept { setSeed(0); }
+
+    void setSeed(juce::uint64 seed) noexcept
+    {
+        state = 0;
+        increment = (mix(seed ^ 0xda3e39cb94b95bdbULL) << 1u) | 1u;
+        nextUint32();
+        state += mix(seed);
+        nextUint32();
+    }
+
+    juce::uint32 nextUint32() noexcept
+    {
+        auto oldState = state;
+        state = oldState * 6364136223846793005ULL + increment;
+
+        auto xorShifted = (juce::uint32)(((oldState >> 18u) ^ oldState) >> 27u);
+        auto rotation = (juce::uint32)(oldState >> 59u);
+        return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+    }
+
+    // Uniform in [0, 1)
+    float nextFloat() noexcept
+    {
+        return (float)(nextUint32() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // SplitMix64 finaliser, also handy for combining seeds
+    static constexpr juce::uint64 mix(juce::uint64 x) noexcept
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27u)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31u);
+    }
+
+private:
+    juce::uint64 state = 0;
+    juce::uint64 increment = 1;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+//==============================================================================
+// Carries timestamped note events between the message thread and the audio thread.
+// Single producer, single consumer; pushing and popping never lock or allocate, and
+// events that arrive while the queue is full are dropped.
+class KeyboardEventQueue
+{
+public:
+    static constexpr int capacity = 1024;
+
+    struct Event
+    {
+        juce::uint8 data[3];
+        double timeMs;
+    };
+
+    KeyboardEventQueue()
+    {
+        events.calloc((size_t)capacity);
+    }
+
+    // Producer: queues a short MIDI message stamped with Time::getMillisecondCounterHiRes()
+    bool push(const juce::uint8* data, int numBytes, double timeMs) noexcept
+    {
+        jassert(numBytes > 0 && numBytes <= 3);
+
+        const auto scope = fifo.write(1);
+
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return false;
+
+        auto& event = events[scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2];
+        std::fill(std::begin(event.data), std::end(event.data), (juce::uint8)0);
+        std::copy_n(data, juce::jmin(3, numBytes), event.data);
+        event.timeMs = timeMs;
+        return true;
+    }
+
+    bool push(const juce::MidiMessage& message, double timeMs) noexcept
+    {
+        return push(message.getRawData(), message.getRawDataSize(), timeMs);
+    }
+
+    // Consumer: throws away anything pending
+    void clear() noexcept
+    {
+        fifo.read(fifo.getNumReady());
+    }
+
+    bool isEmpty() const noexcept { return fifo.getNumReady() == 0; }
+
+    // Consumer: hands pending events to callback(const Event&) in arrival order, at
+    // most maxEvents of them; any more stay queued
+    template <typename Callback>
+    void popAll(Callback&& callback, int maxEvents = capacity)
+    {
+        const auto scope = fifo.read(juce::jmin(fifo.getNumReady(), juce::jmax(0, maxEvents)));
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            callback(events[scope.startIndex1 + i]);
+
+        for (int i = 0; i < scope.blockSize2; ++i)
+            callback(events[scope.startIndex2 + i]);
+    }
+
+    // Audio thread: adds the pending events to dest and returns how many were added.
+    // Events are spread across the block in proportion to when they arrived since the
+    // previous call, so quick runs on the on-screen keys keep their timing; call this
+    // every block, even when the queue is empty, to keep that reference current.
+    // Only the first maxEvents are added, so a caller with a preallocated dest can
+    // keep it from growing; the rest stay queued for the next call, which puts them
+    // at the start of its block, so a note-off is late rather than lost.
+    int mergeInto(juce::MidiBuffer& dest, int startSample, int numSamples, double nowMs,
+                  int maxEvents = capacity) noexcept
+    {
+        const auto elapsedMs = nowMs - lastMergeMs;
+        const auto previousMergeMs = lastMergeMs;
+        lastMergeMs = nowMs;
+
+        int numMerged = 0;
+
+        popAll([&](const Event& event)
+        {
+            auto offset = 0;
+
+            if (elapsedMs > 0.0 && previousMergeMs > 0.0)
+                offset = juce::jlimit(0, numSamples - 1,
+                                      (int)((event.timeMs - previousMergeMs) / elapsedMs * numSamples));
+
+            dest.addEvent(event.data, juce::MidiMessage::getMessageLengthFromFirstByte(event.data[0]),
+                          startSample + offset);
+            ++numMerged;
+        }, maxEvents);
+
+        return numMerged;
+    }
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    juce::HeapBlock<Event> events;
+
+    // Consumer only
+    double lastMergeMs = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE(KeyboardEventQueue)
+};
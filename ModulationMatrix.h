@@ -0,0 +1,245 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "FastRandom.h"
+#include "SnapshotMailbox.h"
+
+//==============================================================================
+// Per-voice modulation: two LFOs and an envelope routed through a few slots.
+//
+// Sources are only evaluated at control rate, once per controlInterval samples.
+// Each destination keeps the value it had at the start of the interval and the one
+// it should reach at the end, so the voice can ramp linearly between them rather
+// than stepping.
+namespace Modulation
+{
+    static constexpr int controlInterval = 32;
+    static constexpr int numSlots = 4;
+
+    enum Source
+    {
+        none = 0,
+        lfo1,
+        lfo2,
+        envelope,
+        velocity,
+        modWheel,
+        numSources
+    };
+
+    enum Destination
+    {
+        pitch = 0,          // +/- 24 semitones at full depth
+        harmonicsMorph,     // fades the upper harmonics out towards the bare fundamental
+        subharmonicMix,     // scales the subharmonic level, 0 to 2x
+        level,              // scales the voice level, 0 to 2x
+        filterCutoff,       // +/- 48 semitones at full depth
+        numDestinations
+    };
+
+    enum LfoShape
+    {
+        sine = 0,
+        triangle,
+        saw,
+        square,
+        sampleAndHold
+    };
+
+    inline const juce::StringArray& getSourceNames()
+    {
+        static const juce::StringArray names { "None", "LFO 1", "LFO 2", "Mod Env", "Velocity", "Mod Wheel" };
+        return names;
+    }
+
+    inline const juce::StringArray& getDestinationNames()
+    {
+        static const juce::StringArray names { "Pitch", "Harmonics Morph", "Sub Mix", "Level", "Filter Cutoff" };
+        return names;
+    }
+
+    inline const juce::StringArray& getLfoShapeNames()
+    {
+        static const juce::StringArray names { "Sine", "Triangle", "Saw", "Square", "S&H" };
+        return names;
+    }
+
+    struct Slot
+    {
+        int source = none;
+        int destination = pitch;
+        float amount = 0.0f;     // -1 to 1
+    };
+
+    // Shared by every voice; handed to each whenever a parameter changes
+    struct Settings
+    {
+        std::array<float, 2> lfoRates { 2.0f, 0.5f };
+        std::array<int, 2> lfoShapes { sine, triangle };
+        juce::ADSR::Parameters envelopeParameters { 0.01f, 0.5f, 0.0f, 0.3f };
+        std::array<Slot, numSlots> slots {};
+    };
+
+    //==============================================================================
+    // A low-frequency oscillator sampled at control rate
+    class Lfo
+    {
+    public:
+        void reset() noexcept
+        {
+            phase = 0.0f;
+            heldValue = 0.0f;
+        }
+
+        void advance(float rateHz, double sampleRate, int numSamples, FastRandom& random) noexcept
+        {
+            phase += rateHz * (float)numSamples / (float)sampleRate;
+
+            if (phase >= 1.0f)
+            {
+                phase -= std::floor(phase);
+                heldValue = 2.0f * random.nextFloat() - 1.0f;
+            }
+        }
+
+        // -1 to 1 at the current phase
+        float getValue(int shape) const noexcept
+        {
+            switch (shape)
+            {
+                case triangle:      return 1.0f - 4.0f * std::abs(phase - 0.5f);
+                case saw:           return 2.0f * phase - 1.0f;
+                case square:        return phase < 0.5f ? 1.0f : -1.0f;
+                case sampleAndHold: return heldValue;
+                default:            return std::sin(juce::MathConstants<float>::twoPi * phase);
+            }
+        }
+
+    private:
+        float phase = 0.0f;
+        float heldValue = 0.0f;
+    };
+
+    //==============================================================================
+    class Matrix
+    {
+    public:
+        void setSampleRate(double newSampleRate)
+        {
+            sampleRate = newSampleRate;
+            modEnvelope.setSampleRate(newSampleRate);
+        }
+
+        // One thread at a time, also while a note plays: the settings take effect at
+        // the next adoptNewSettings() or noteOn() on the audio thread
+        void setSettings(const Settings& newSettings) noexcept
+        {
+            settingsMailbox.publish(newSettings);
+        }
+
+        // Audio thread, at the start of a control interval: picks up the settings set
+        // last, if they are new, and says whether they were
+        bool adoptNewSettings() noexcept
+        {
+            if (! settingsMailbox.adoptLatest())
+                return false;
+
+            const auto& settings = getSettings();
+            modEnvelope.setParameters(settings.envelopeParameters);
+
+            isActive = false;
+
+            for (const auto& slot : settings.slots)
+                isActive = isActive || (slot.source != none && slot.amount != 0.0f);
+
+            return true;
+        }
+
+        // True if any slot does something; voices skip all modulation work otherwise
+        bool hasActiveSlots() const noexcept { return isActive; }
+
+        void noteOn(float noteVelocity) noexcept
+        {
+            adoptNewSettings();
+            velocityValue = noteVelocity;
+
+            for (auto& lfo : lfos)
+                lfo.reset();
+
+            modEnvelope.noteOn();
+            envelopeValue = 0.0f;
+
+            // Start the first interval from where the sources begin, not from zero
+            evaluate(0);
+            startValues = endValues;
+        }
+
+        void noteOff() noexcept { modEnvelope.noteOff(); }
+
+        // 0 to 1; like the other sources, it is picked up at the next control interval
+        void setModWheel(float value) noexcept { modWheelValue = value; }
+
+        void reset() noexcept
+        {
+            modEnvelope.reset();
+            envelopeValue = 0.0f;
+            startValues.fill(0.0f);
+            endValues.fill(0.0f);
+        }
+
+        // Control rate: evaluates the sources for the next numSamples. Afterwards each
+        // destination should ramp from getStart() to getEnd() across those samples.
+        void advance(int numSamples, FastRandom& random) noexcept
+        {
+            startValues = endValues;
+            evaluate(numSamples, &random);
+        }
+
+        float getStart(int destination) const noexcept { return startValues[(size_t)destination]; }
+        float getEnd(int destination) const noexcept   { return endValues[(size_t)destination]; }
+
+    private:
+        SnapshotMailbox<Settings> settingsMailbox;
+        double sampleRate = 44100.0;
+        bool isActive = false;
+
+        std::array<Lfo, 2> lfos;
+        juce::ADSR modEnvelope;
+        float envelopeValue = 0.0f;
+        float velocityValue = 0.0f;
+        float modWheelValue = 0.0f;
+
+        std::array<float, numDestinations> startValues {};
+        std::array<float, numDestinations> endValues {};
+
+        const Settings& getSettings() const noexcept { return settingsMailbox.get(); }
+
+        void evaluate(int numSamples, FastRandom* random = nullptr) noexcept
+        {
+            const auto& settings = getSettings();
+
+            if (random != nullptr)
+            {
+                for (size_t i = 0; i < lfos.size(); ++i)
+                    lfos[i].advance(settings.lfoRates[i], sampleRate, numSamples, *random);
+
+                // The envelope still runs per sample, but only its latest value is used
+                for (int i = 0; i < numSamples; ++i)
+                    envelopeValue = modEnvelope.getNextSample();
+            }
+
+            std::array<float, numSources> sources {};
+            sources[lfo1] = lfos[0].getValue(settings.lfoShapes[0]);
+            sources[lfo2] = lfos[1].getValue(settings.lfoShapes[1]);
+            sources[envelope] = envelopeValue;
+            sources[velocity] = velocityValue;
+            sources[modWheel] = modWheelValue;
+
+            endValues.fill(0.0f);
+
+            for (const auto& slot : settings.slots)
+                if (slot.source != none)
+                    endValues[(size_t)slot.destination] += sources[(size_t)slot.source] * slot.amount;
+        }
+    };
+}
@@ -0,0 +1,147 @@
+#include "ParallelRenderPool.h"
+#include "RealtimeSafety.h"
+#include "TraceRecorder.h"
+
+//==============================================================================
+class ParallelRenderPool::Worker : public juce::Thread
+{
+public:
+    explicit Worker(ParallelRenderPool& ownerPool)
+        : juce::Thread("Armonio render worker"),
+          pool(ownerPool)
+    {
+    }
+
+    void run() override
+    {
+        ARMONIO_TRACE_THREAD_NAME("Render worker");
+
+        // The audio thread's own setting does not carry over to workers
+        const juce::ScopedNoDenormals noDenormals;
+
+        while (! threadShouldExit())
+        {
+            wait(-1);
+
+            if (threadShouldExit())
+                break;
+
+            pool.runTasks();
+
+            // Read before finishing: once the last worker has, the next run may change it
+            const auto numWorkersInRun = pool.numWorkersInRun;
+
+            if (pool.numWorkersFinished.fetch_add(1, std::memory_order_acq_rel) + 1 == numWorkersInRun)
+                pool.allWorkersFinished.signal();
+        }
+    }
+
+private:
+    ParallelRenderPool& pool;
+};
+
+//==============================================================================
+ParallelRenderPool::ParallelRenderPool() = default;
+
+ParallelRenderPool::~ParallelRenderPool()
+{
+    setNumWorkers(0);
+}
+
+void ParallelRenderPool::setNumWorkers(int newNumWorkers)
+{
+    const auto numWanted = juce::jmax(0, newNumWorkers);
+    const std::lock_guard<std::mutex> sl(runLock);
+
+    while (workers.size() > numWanted)
+    {
+        auto* worker = workers.getLast();
+        worker->signalThreadShouldExit();
+        worker->notify();
+        worker->stopThread(2000);
+        workers.removeLast();
+    }
+
+    while (workers.size() < numWanted)
+    {
+        auto* worker = workers.add(new Worker(*this));
+        worker->startThread();
+    }
+
+    numWorkers.store(workers.size(), std::memory_order_relaxed);
+}
+
+void ParallelRenderPool::run(int numTasks, TaskCallback callback, void* context)
+{
+    auto runOnCallingThread = [&]
+    {
+        for (int i = 0; i < numTasks; ++i)
+            callback(context, i);
+    };
+
+    if (getNumWorkers() == 0 || numTasks < 2)
+    {
+        runOnCallingThread();
+        return;
+    }
+
+   #if ARMONIO_RT_SAFETY_CHECKS
+    // Offline only, where waking a thread and waiting for it are allowed to block
+    const RealtimeSafetyChecker::ScopedNonRealtimeContext nonRealtime;
+   #endif
+
+    // Another caller has the workers, or they are being started or stopped
+    std::unique_lock<std::mutex> sl(runLock, std::try_to_lock);
+
+    if (! sl.owns_lock() || workers.isEmpty())
+    {
+        runOnCallingThread();
+        return;
+    }
+
+    ARMONIO_TRACE_SCOPE("ParallelRenderPool::run");
+
+    taskCallback = callback;
+    taskContext = context;
+    numTasksTotal = numTasks;
+    numWorkersInRun = workers.size();
+    numWorkersFinished.store(0, std::memory_order_relaxed);
+    nextTask.store(0, std::memory_order_release);
+
+    for (auto* worker : workers)
+        worker->notify();
+
+    runTasks();
+
+    // Every worker has to be done, not just every task, before the next run may
+    // change the task state underneath one that woke late
+    allWorkersFinished.wait(-1);
+}
+
+void ParallelRenderPool::runTasks() noexcept
+{
+    for (auto index = nextTask.fetch_add(1, std::memory_order_acq_rel); index < numTasksTotal;
+         index = nextTask.fetch_add(1, std::memory_order_acq_rel))
+    {
+        taskCallback(taskContext, index);
+    }
+}
+
+//==============================================================================
+void SharedRenderPool::setNumWorkersFor(const void* instance, int numWorkers)
+{
+    const std::lock_guard<std::mutex> sl(requestLock);
+
+    if (numWorkers > 0)
+        requests[instance] = numWorkers;
+    else
+        requests.erase(instance);
+
+    auto numWanted = 0;
+
+    for (const auto& request : requests)
+        numWanted = juce::jmax(numWanted, request.second);
+
+    if (numWanted != pool.getNumWorkers())
+        pool.setNumWorkers(numWanted);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+
+//==============================================================================
+// Fork-join helper for offline renders: forEach() hands out task indices to a set
+// of worker threads and the calling thread alike, and returns once every task and
+// every worker has finished, so the caller can read the results right away.
+//
+// Waking the workers takes a lock and the caller sleeps until they are done, so
+// this is only meant for non-realtime rendering. Several threads may call
+// forEach() at once: one has the workers, and the others run their tasks on their
+// own thread rather than wait for it. Workers may be started and stopped on the
+// message thread at any time; a run in progress holds that off until it ends.
+class ParallelRenderPool
+{
+public:
+    ParallelRenderPool();
+    ~ParallelRenderPool();
+
+    // 0 stops every worker, after which forEach() runs everything on the calling thread
+    void setNumWorkers(int numWorkers);
+    int getNumWorkers() const noexcept { return numWorkers.load(std::memory_order_relaxed); }
+
+    // Calls function(i) once for every i below numTasks
+    template <typename Function>
+    void forEach(int numTasks, Function& function)
+    {
+        run(numTasks, [](void* context, int index) { (*static_cast<Function*>(context))(index); }, &function);
+    }
+
+private:
+    using TaskCallback = void (*)(void* context, int index);
+
+    class Worker;
+    juce::OwnedArray<Worker> workers;
+    std::atomic<int> numWorkers { 0 };
+
+    // Held through a run, and to start or stop workers
+    std::mutex runLock;
+
+    // The current run; written only while every worker is idle
+    TaskCallback taskCallback = nullptr;
+    void* taskContext = nullptr;
+    int numTasksTotal = 0;
+    int numWorkersInRun = 0;
+
+    std::atomic<int> nextTask { 0 };
+    std::atomic<int> numWorkersFinished { 0 };
+    juce::WaitableEvent allWorkersFinished;
+
+    void run(int numTasks, TaskCallback callback, void* context);
+    void runTasks() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE(ParallelRenderPool)
+};
+
+//==============================================================================
+// The one set of render workers for every instance in the process, so that an
+// offline bounce of a session with many instances starts one worker per spare
+// core rather than that many for each. Each instance asks for the workers it
+// wants and the pool runs the most any of them asked for. Hold it through
+// juce::SharedResourcePointer<SharedRenderPool>.
+class SharedRenderPool
+{
+public:
+    // Message thread; 0 withdraws the instance's request
+    void setNumWorkersFor(const void* instance, int numWorkers);
+
+    ParallelRenderPool& getPool() noexcept { return pool; }
+
+private:
+    std::mutex requestLock;
+    std::map<const void*, int> requests;
+    ParallelRenderPool pool;
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+//==============================================================================
+// Zero-latency, non-uniformly partitioned FFT convolution.
+//
+// The first headSize taps of the impulse response are applied directly in the
+// time domain, so every output sample already contains the input sample at the
+// same index. The rest is split into segments of FFT partitions that grow by a
+// factor of eight: a segment of partition size P covers taps P to 8P, which means
+// each segment's FFT block has completed by the time its taps are due and none
+// of them adds latency. Each segment runs a frequency-domain delay line
+// (uniformly partitioned overlap-save), so a long tail costs a few large FFTs and
+// a complex multiply-add per partition rather than one tap per sample.
+//
+// Every partition but a segment's first only meets input spectra that are
+// already known while the block before it is still filling, so that share of the
+// multiply-adds is spread over the callbacks of that block. Only the two FFTs and
+// the first partition are left for the callback that completes it.
+//
+// Construction allocates everything; process() does not.
+class PartitionedConvolver
+{
+public:
+    static constexpr int headSize = 128;
+
+    // Kept small enough that juce::dsp::FFT's fallback engine works on the stack
+    static constexpr int maxPartitionSize = 8192;
+
+    // Allocates, so never construct one on the audio thread. With a mono impulse
+    // response every channel is convolved with it; otherwise channel n uses channel n.
+    PartitionedConvolver(const juce::AudioBuffer<float>& impulseResponse, int numChannelsToProcess)
+        : impulseLength(impulseResponse.getNumSamples())
+    {
+        jassert(impulseResponse.getNumChannels() > 0);
+
+        for (int ch = 0; ch < numChannelsToProcess; ++ch)
+        {
+            const auto irChannel = juce::jmin(ch, impulseResponse.getNumChannels() - 1);
+            channels.push_back(std::make_unique<Channel>(impulseResponse.getReadPointer(irChannel), impulseLength, ffts));
+        }
+
+        flushLength = channels.empty() ? 0 : channels.front()->getFlushLength();
+    }
+
+    int getNumChannels() const noexcept         { return (int)channels.size(); }
+    int getImpulseLength() const noexcept       { return impulseLength; }
+
+    // Samples of silent input after which every delay line holds only silence again
+    int getFlushLength() const noexcept         { return flushLength; }
+
+    void reset() noexcept
+    {
+        for (auto& channel : channels)
+            channel->reset();
+    }
+
+    // Writes the convolution of numSamples of input to output; the two may not alias
+    void process(int channel, const float* input, float* output, int numSamples) noexcept
+    {
+        channels[(size_t)channel]->process(input, output, numSamples);
+    }
+
+private:
+    //==============================================================================
+    // One segment of equally sized partitions, with its own FFT block clock
+    class Segment
+    {
+    public:
+        Segment(const float* taps, int numTaps, int newPartitionSize, const juce::dsp::FFT& fftToUse)
+            : partitionSize(newPartitionSize),
+              numBins(newPartitionSize + 1),
+              numPartitions((numTaps + newPartitionSize - 1) / newPartitionSize),
+              fft(fftToUse),
+              filterSpectra((size_t)(numPartitions * numBins)),
+              inputSpectra((size_t)(numPartitions * numBins)),
+              accumulator((size_t)numBins),
+              inputBlocks((size_t)(2 * partitionSize), 0.0f),
+              output((size_t)partitionSize, 0.0f),
+              scratch((size_t)(4 * partitionSize), 0.0f)
+        {
+            // Each partition zero-padded to the FFT size, as overlap-save needs
+            for (int p = 0; p < numPartitions; ++p)
+            {
+                std::fill(scratch.begin(), scratch.end(), 0.0f);
+
+                const auto numPartitionTaps = juce::jmin(partitionSize, numTaps - p * partitionSize);
+                std::copy(taps + p * partitionSize, taps + p * partitionSize + numPartitionTaps, scratch.begin());
+
+                fft.performRealOnlyForwardTransform(scratch.data(), true);
+                std::copy(scratch.begin(), scratch.begin() + 2 * numBins,
+                          reinterpret_cast<float*>(filterSpectra.data() + p * numBins));
+            }
+
+            reset();
+        }
+
+        void reset() noexcept
+        {
+            std::fill(inputSpectra.begin(), inputSpectra.end(), Complex {});
+            std::fill(inputBlocks.begin(), inputBlocks.end(), 0.0f);
+            std::fill(output.begin(), output.end(), 0.0f);
+            std::fill(accumulator.begin(), accumulator.end(), Complex {});
+            position = 0;
+            newestSpectrum = 0;
+            numPartitionsAccumulated = 0;
+        }
+
+        // Enough silent input to push every stored spectrum out of the ring, however
+        // far into a block it starts
+        int getFlushLength() const noexcept { return (numPartitions + 2) * partitionSize; }
+
+        // Never called across one of this segment's block boundaries
+        void process(const float* input, float* outputToAddTo, int numSamples) noexcept
+        {
+            jassert(position + numSamples <= partitionSize);
+
+            std::copy(input, input + numSamples, inputBlocks.begin() + partitionSize + position);
+            juce::FloatVectorOperations::add(outputToAddTo, output.data() + position, numSamples);
+
+            position += numSamples;
+
+            // Keeps the older partitions' share in step with how full the block is
+            accumulateOlderPartitions((numPartitions - 1) * position / partitionSize);
+
+            if (position == partitionSize)
+                completeBlock();
+        }
+
+    private:
+        using Complex = std::complex<float>;
+
+        const int partitionSize, numBins, numPartitions;
+        const juce::dsp::FFT& fft;
+
+        std::vector<Complex> filterSpectra;
+        std::vector<Complex> inputSpectra;   // ring of the latest input block spectra
+        std::vector<Complex> accumulator;    // the next block's spectrum, built up as this one fills
+
+        std::vector<float> inputBlocks;      // previous block, then the one being filled
+        std::vector<float> output;           // this segment's share of the current block
+        std::vector<float> scratch;
+
+        int position = 0;
+        int newestSpectrum = 0;
+        int numPartitionsAccumulated = 0;    // of partitions 1 onwards, for the next block
+
+        // Adds one partition times the input spectrum spectrumAge blocks before the newest
+        void multiplyAdd(int partition, int spectrumAge) noexcept
+        {
+            const auto spectrum = (newestSpectrum - spectrumAge + numPartitions) % numPartitions;
+            const auto* x = inputSpectra.data() + spectrum * numBins;
+            const auto* h = filterSpectra.data() + partition * numBins;
+
+            for (int bin = 0; bin < numBins; ++bin)
+                accumulator[(size_t)bin] += x[bin] * h[bin];
+        }
+
+        // Partition p of the next block meets the spectrum that is p - 1 blocks old now
+        void accumulateOlderPartitions(int numToHaveDone) noexcept
+        {
+            for (; numPartitionsAccumulated < numToHaveDone; ++numPartitionsAccumulated)
+                multiplyAdd(numPartitionsAccumulated + 1, numPartitionsAccumulated);
+        }
+
+        void completeBlock() noexcept
+        {
+            position = 0;
+
+            // Spectrum of the last two input blocks
+            std::copy(inputBlocks.begin(), inputBlocks.end(), scratch.begin());
+            std::fill(scratch.begin() + 2 * partitionSize, scratch.end(), 0.0f);
+            std::copy(inputBlocks.begin() + partitionSize, inputBlocks.end(), inputBlocks.begin());
+
+            fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+            newestSpectrum = (newestSpectrum + 1) % numPartitions;
+            std::copy(reinterpret_cast<const Complex*>(scratch.data()),
+                      reinterpret_cast<const Complex*>(scratch.data()) + numBins,
+                      inputSpectra.begin() + newestSpectrum * numBins);
+
+            // The older partitions were added while the block filled
+            jassert(numPartitionsAccumulated == numPartitions - 1);
+            multiplyAdd(0, 0);
+
+            std::copy(accumulator.begin(), accumulator.end(), reinterpret_cast<Complex*>(scratch.data()));
+            std::fill(accumulator.begin(), accumulator.end(), Complex {});
+            numPartitionsAccumulated = 0;
+
+            fft.performRealOnlyInverseTransform(scratch.data());
+
+            // Overlap-save: only the second half is free of wrap-around
+            std::copy(scratch.begin() + partitionSize, scratch.begin() + 2 * partitionSize, output.begin());
+        }
+    };
+
+    //==============================================================================
+    class Channel
+    {
+    public:
+        Channel(const float* taps, int numTaps, std::vector<std::unique_ptr<juce::dsp::FFT>>& ffts)
+        {
+            std::copy(taps, taps + juce::jmin(numTaps, headSize), headTaps.begin());
+
+            // Partition sizes grow eightfold, each segment covering taps P to 8P
+            auto partitionSize = headSize;
+
+            for (auto offset = headSize; offset < numTaps; partitionSize *= 8)
+            {
+                const auto segmentEnd = partitionSize < maxPartitionSize ? juce::jmin(numTaps, 8 * partitionSize) : numTaps;
+                const auto order = juce::roundToInt(std::log2(2 * partitionSize));
+
+                if ((size_t)order >= ffts.size())
+                    ffts.resize((size_t)order + 1);
+
+                if (ffts[(size_t)order] == nullptr)
+                    ffts[(size_t)order] = std::make_unique<juce::dsp::FFT>(order);
+
+                segments.push_back(std::make_unique<Segment>(taps + offset, segmentEnd - offset,
+                                                             partitionSize, *ffts[(size_t)order]));
+                offset = segmentEnd;
+            }
+        }
+
+        int getFlushLength() const noexcept
+        {
+            auto length = 2 * headSize;
+
+            for (auto& segment : segments)
+                length = juce::jmax(length, segment->getFlushLength());
+
+            return length;
+        }
+
+        void reset() noexcept
+        {
+            history.fill(0.0f);
+            headPosition = 0;
+
+            for (auto& segment : segments)
+                segment->reset();
+        }
+
+        void process(const float* input, float* output, int numSamples) noexcept
+        {
+            while (numSamples > 0)
+            {
+                // Runs never cross a head block boundary, and so never a segment's either
+                const auto numThisTime = juce::jmin(numSamples, headSize - headPosition);
+
+                // Direct-form head: one vectorised multiply-add per tap across the run
+                auto* current = history.data() + headSize + headPosition;
+                std::copy(input, input + numThisTime, current);
+                juce::FloatVectorOperations::clear(output, numThisTime);
+
+                for (int tap = 0; tap < headSize; ++tap)
+                    if (headTaps[(size_t)tap] != 0.0f)
+                        juce::FloatVectorOperations::addWithMultiply(output, current - tap, headTaps[(size_t)tap], numThisTime);
+
+                for (auto& segment : segments)
+                    segment->process(input, output, numThisTime);
+
+                headPosition += numThisTime;
+
+                if (headPosition == headSize)
+                {
+                    std::copy(history.begin() + headSize, history.end(), history.begin());
+                    headPosition = 0;
+                }
+
+                input += numThisTime;
+                output += numThisTime;
+                numSamples -= numThisTime;
+            }
+        }
+
+    private:
+        std::array<float, headSize> headTaps {};
+
+        // The previous head block, then the one being filled
+        std::array<float, 2 * headSize> history {};
+        int headPosition = 0;
+
+        std::vector<std::unique_ptr<Segment>> segments;
+    };
+
+    //==============================================================================
+    const int impulseLength;
+    int flushLength = 0;
+
+    // One FFT engine per size, shared by every channel's segments
+    std::vector<std::unique_ptr<juce::dsp::FFT>> ffts;
+    std::vector<std::unique_ptr<Channel>> channels;
+
+    JUCE_DECLARE_NON_COPYABLE(PartitionedConvolver)
+};
@@ -5,7 +5,8 @@
 AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudioProcessor& p)
     : AudioProcessorEditor(&p),
       processorRef(p),
-      keyboardComponent(p.keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard)
+      keyboardComponent(p.keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard),
+      scopeComponent(p)
 {
     // ==================== WAVEFORM SELECTOR ====================
     waveformLabel.setText("Waveform", juce::dontSendNotification);
@@ -23,6 +24,8 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
         "waveform",
         waveformSlider);
 
+    addChoiceControl(oscEngineBox, SynthAudioSource::getOscillatorEngineNames(), "oscEngine", oscEngineAttachment);
+
     // Harmonics
     harmonicsLabel.setText("Harmonics", juce::dontSendNotification);
     harmonicsLabel.setJustificationType(juce::Justification::centredRight);
@@ -55,6 +58,50 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
         "subharmonics",
         subharmonicsSlider);
 
+    // Unison
+    unisonLabel.setText("Unison", juce::dontSendNotification);
+    unisonLabel.setJustificationType(juce::Justification::centredRight);
+    unisonLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(unisonLabel);
+
+    unisonSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    unisonSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 40, 20);
+    addAndMakeVisible(unisonSlider);
+
+    unisonAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.getValueTreeState(),
+        "unison",
+        unisonSlider);
+
+    unisonDetuneLabel.setText("Detune", juce::dontSendNotification);
+    unisonDetuneLabel.setJustificationType(juce::Justification::centredRight);
+    unisonDetuneLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(unisonDetuneLabel);
+
+    unisonDetuneSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    unisonDetuneSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 60, 20);
+    unisonDetuneSlider.setTextValueSuffix(" ct");
+    addAndMakeVisible(unisonDetuneSlider);
+
+    unisonDetuneAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.getValueTreeState(),
+        "unisonDetune",
+        unisonDetuneSlider);
+
+    unisonSpreadLabel.setText("Spread", juce::dontSendNotification);
+    unisonSpreadLabel.setJustificationType(juce::Justification::centredRight);
+    unisonSpreadLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(unisonSpreadLabel);
+
+    unisonSpreadSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    unisonSpreadSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 50, 20);
+    addAndMakeVisible(unisonSpreadSlider);
+
+    unisonSpreadAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.getValueTreeState(),
+        "unisonSpread",
+        unisonSpreadSlider);
+
     // ADSR
     adsrTitleLabel.setText("ENVELOPE (ADSR)", juce::dontSendNotification);
     adsrTitleLabel.setJustificationType(juce::Justification::centred);
@@ -121,40 +168,252 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor(AudioPluginAudi
         "release",
         releaseSlider);
 
+    // FILTER
+    filterTitleLabel.setText("FILTER", juce::dontSendNotification);
+    filterTitleLabel.setJustificationType(juce::Justification::centred);
+    filterTitleLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    filterTitleLabel.setFont(juce::Font(16.0f, juce::Font::bold));
+    addAndMakeVisible(filterTitleLabel);
+
+    addHorizontalControl(filterModeSlider, filterModeLabel, "Mode", "filterMode", filterModeAttachment);
+    addHorizontalControl(filterCutoffSlider, filterCutoffLabel, "Cutoff", "filterCutoff", filterCutoffAttachment);
+    addHorizontalControl(filterResonanceSlider, filterResonanceLabel, "Reso", "filterResonance", filterResonanceAttachment);
+    addHorizontalControl(filterEnvAmountSlider, filterEnvAmountLabel, "Env Amt", "filterEnvAmount", filterEnvAmountAttachment);
+    addHorizontalControl(filterKeyTrackSlider, filterKeyTrackLabel, "Key Trk", "filterKeyTrack", filterKeyTrackAttachment);
+    addHorizontalControl(filterAttackSlider, filterAttackLabel, "A", "filterAttack", filterAttackAttachment);
+    addHorizontalControl(filterDecaySlider, filterDecayLabel, "D", "filterDecay", filterDecayAttachment);
+    addHorizontalControl(filterSustainSlider, filterSustainLabel, "S", "filterSustain", filterSustainAttachment);
+    addHorizontalControl(filterReleaseSlider, filterReleaseLabel, "R", "filterRelease", filterReleaseAttachment);
+
+    filterCutoffSlider.setTextValueSuffix(" Hz");
+    filterEnvAmountSlider.setTextValueSuffix(" st");
+
+    // MODULATION
+    modulationTitleLabel.setText("MODULATION", juce::dontSendNotification);
+    modulationTitleLabel.setJustificationType(juce::Justification::centred);
+    modulationTitleLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    modulationTitleLabel.setFont(juce::Font(16.0f, juce::Font::bold));
+    addAndMakeVisible(modulationTitleLabel);
+
+    for (size_t lfo = 0; lfo < lfoRateSliders.size(); ++lfo)
+    {
+        const auto prefix = "lfo" + juce::String((int)lfo + 1);
+
+        addHorizontalControl(lfoRateSliders[lfo], lfoRateLabels[lfo], "LFO " + juce::String((int)lfo + 1),
+                             prefix + "Rate", lfoRateAttachments[lfo]);
+        lfoRateSliders[lfo].setTextValueSuffix(" Hz");
+
+        addChoiceControl(lfoShapeBoxes[lfo], Modulation::getLfoShapeNames(), prefix + "Shape", lfoShapeAttachments[lfo]);
+    }
+
+    addHorizontalControl(modAttackSlider, modAttackLabel, "A", "modAttack", modAttackAttachment);
+    addHorizontalControl(modDecaySlider, modDecayLabel, "D", "modDecay", modDecayAttachment);
+    addHorizontalControl(modSustainSlider, modSustainLabel, "S", "modSustain", modSustainAttachment);
+    addHorizontalControl(modReleaseSlider, modReleaseLabel, "R", "modRelease", modReleaseAttachment);
+
+    for (size_t slot = 0; slot < (size_t)Modulation::numSlots; ++slot)
+    {
+        const auto prefix = "mod" + juce::String((int)slot + 1);
+
+        modSlotLabels[slot].setText(juce::String((int)slot + 1), juce::dontSendNotification);
+        modSlotLabels[slot].setJustificationType(juce::Justification::centredRight);
+        modSlotLabels[slot].setColour(juce::Label::textColourId, juce::Colours::white);
+        addAndMakeVisible(modSlotLabels[slot]);
+
+        addChoiceControl(modSourceBoxes[slot], Modulation::getSourceNames(), prefix + "Source", modSourceAttachments[slot]);
+        addChoiceControl(modDestinationBoxes[slot], Modulation::getDestinationNames(), prefix + "Destination", modDestinationAttachments[slot]);
+        addHorizontalControl(modAmountSliders[slot], modAmountLabels[slot], "Amt", prefix + "Amount", modAmountAttachments[slot]);
+    }
+
+    // REVERB
+    reverbTitleLabel.setText("REVERB", juce::dontSendNotification);
+    reverbTitleLabel.setJustificationType(juce::Justification::centred);
+    reverbTitleLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    reverbTitleLabel.setFont(juce::Font(16.0f, juce::Font::bold));
+    addAndMakeVisible(reverbTitleLabel);
+
+    addHorizontalControl(reverbSendSlider, reverbSendLabel, "Send", "reverbSend", reverbSendAttachment);
+    addHorizontalControl(reverbSizeSlider, reverbSizeLabel, "Size", "reverbSize", reverbSizeAttachment);
+    reverbSizeSlider.setTextValueSuffix(" s");
+
+    addAndMakeVisible(reverbSharedButton);
+    reverbSharedAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.getValueTreeState(),
+        "reverbShared",
+        reverbSharedButton);
+
+    reverbLoadButton.onClick = [this] { chooseReverbImpulseResponse(); };
+    reverbLoadButton.setTooltip(processorRef.getReverbImpulseResponse().getFullPathName());
+    addAndMakeVisible(reverbLoadButton);
+
+    // QUALITY
+    addAndMakeVisible(adaptiveQualityButton);
+    adaptiveQualityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.getValueTreeState(),
+        "adaptiveQuality",
+        adaptiveQualityButton);
+
+    qualityLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(qualityLabel);
+    updateQualityIndicator();
+
+   #if ARMONIO_ENABLE_TRACING
+    saveTraceButton.onClick = [this] { saveTrace(); };
+    addAndMakeVisible(saveTraceButton);
+   #endif
+
+    // Scope
+    addAndMakeVisible(scopeComponent);
+
     // keyboard
     addAndMakeVisible(keyboardComponent);
 
-    setSize(800, 500);
+    // Host notes reach the on-screen keyboard through a queue polled here
+    processorRef.setKeyboardDisplayActive(true);
+    startTimerHz(30);
+
+    setSize(800 + modulationWidth, 820);
 }
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 {
+    stopTimer();
+    processorRef.setKeyboardDisplayActive(false);
+
     // Attachments are automatically cleaned up by unique_ptr
 }
 
+void AudioPluginAudioProcessorEditor::addHorizontalControl(
+    juce::Slider& slider, juce::Label& label, const juce::String& text, const juce::String& parameterID,
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>& attachment)
+{
+    label.setText(text, juce::dontSendNotification);
+    label.setJustificationType(juce::Justification::centredRight);
+    label.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(label);
+
+    slider.setSliderStyle(juce::Slider::LinearHorizontal);
+    slider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 60, 20);
+    addAndMakeVisible(slider);
+
+    attachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.getValueTreeState(),
+        parameterID,
+        slider);
+}
+
+void AudioPluginAudioProcessorEditor::addChoiceControl(
+    juce::ComboBox& comboBox, const juce::StringArray& items, const juce::String& parameterID,
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment)
+{
+    // The items have to be in place before the attachment selects one
+    comboBox.addItemList(items, 1);
+    addAndMakeVisible(comboBox);
+
+    attachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.getValueTreeState(),
+        parameterID,
+        comboBox);
+}
+
+void AudioPluginAudioProcessorEditor::chooseReverbImpulseResponse()
+{
+    reverbFileChooser = std::make_unique<juce::FileChooser>("Choose an impulse response",
+                                                            processorRef.getReverbImpulseResponse(),
+                                                            "*.wav;*.aif;*.aiff;*.flac");
+
+    // Cancelling goes back to the generated response
+    reverbFileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                   [this](const juce::FileChooser& chooser)
+                                   {
+                                       const auto file = chooser.getResult();
+                                       processorRef.loadReverbImpulseResponse(file);
+                                       reverbLoadButton.setTooltip(file.getFullPathName());
+                                   });
+}
+
+void AudioPluginAudioProcessorEditor::updateQualityIndicator()
+{
+    const auto stage = processorRef.getQualityStage();
+    const auto loadPercent = juce::roundToInt(processorRef.getCallbackLoad() * 100.0f);
+
+    qualityLabel.setText(QualityGovernor::getStageNames()[stage] + " (" + juce::String(loadPercent) + "%)",
+                         juce::dontSendNotification);
+
+    // Only recoloured when the stage changes; amber for anything below full quality
+    if (stage != displayedQualityStage)
+    {
+        displayedQualityStage = stage;
+        qualityLabel.setColour(juce::Label::textColourId, stage == QualityGovernor::fullQuality
+                                                              ? juce::Colours::lightgrey
+                                                              : juce::Colours::orange);
+        qualityLabel.setTooltip(stage == QualityGovernor::fullQuality
+                                    ? "Callbacks are within their deadline"
+                                    : "Quality was reduced to keep up with the audio deadline");
+    }
+}
+
+void AudioPluginAudioProcessorEditor::timerCallback()
+{
+    processorRef.updateKeyboardDisplay();
+    updateQualityIndicator();
+}
+
+#if ARMONIO_ENABLE_TRACING
+void AudioPluginAudioProcessorEditor::saveTrace()
+{
+    auto file = juce::File::getSpecialLocation(juce::File::userDesktopDirectory)
+                    .getNonexistentChildFile("Armonio-trace", ".json");
+
+    if (TraceRecorder::writeChromeTrace(file))
+        saveTraceButton.setTooltip("Saved " + file.getFullPathName());
+}
+#endif
+
 //==============================================================================
 void AudioPluginAudioProcessorEditor::paint(juce::Graphics& g)
 {
     // Background
     g.fillAll(juce::Colour(0xff2a2a2a));
 
+    const auto mainWidth = getWidth() - modulationWidth;
+
     g.setColour(juce::Colour(0xff1a1a1a));
-    g.fillRect(10, 170, getWidth() - 20, 240);
+    g.fillRect(10, 220, mainWidth - 20, 240);
 
     g.setColour(juce::Colour(0xff3a3a3a));
-    g.drawRect(10, 170, getWidth() - 20, 240, 2);
+    g.drawRect(10, 220, mainWidth - 20, 240, 2);
+
+    // Filter box
+    g.setColour(juce::Colour(0xff1a1a1a));
+    g.fillRect(10, 465, mainWidth - 20, 120);
+
+    g.setColour(juce::Colour(0xff3a3a3a));
+    g.drawRect(10, 465, mainWidth - 20, 120, 2);
+
+    // Modulation column
+    g.setColour(juce::Colour(0xff1a1a1a));
+    g.fillRect(mainWidth, 10, modulationWidth - 10, getHeight() - keyboardHeight - 20);
+
+    g.setColour(juce::Colour(0xff3a3a3a));
+    g.drawRect(mainWidth, 10, modulationWidth - 10, getHeight() - keyboardHeight - 20, 2);
 }
 
 void AudioPluginAudioProcessorEditor::resized()
 {
     auto bounds = getLocalBounds();
 
+    // The modulation column runs down the right-hand side, above the keyboard
+    auto modulationArea = bounds.withTrimmedBottom(keyboardHeight).removeFromRight(modulationWidth);
+    bounds.removeFromRight(modulationWidth);
+
     // WAVEFORM
     auto waveformArea = bounds.removeFromTop(60);
     waveformArea.removeFromTop(10);
 
     auto waveformRow = waveformArea.removeFromTop(30);
     waveformLabel.setBounds(waveformRow.removeFromLeft(100).reduced(5));
+    oscEngineBox.setBounds(waveformRow.removeFromRight(130).reduced(5));
     waveformSlider.setBounds(waveformRow.reduced(5));
 
     // HARMONICS
@@ -173,6 +432,24 @@ void AudioPluginAudioProcessorEditor::resized()
     subharmonicsLabel.setBounds(subharmonicsRow.removeFromLeft(100).reduced(5));
     subharmonicsSlider.setBounds(subharmonicsRow.reduced(5));
 
+    // UNISON
+    auto unisonArea = bounds.removeFromTop(50);
+    unisonArea.removeFromTop(5);
+
+    auto unisonRow = unisonArea.removeFromTop(30);
+    auto unisonColumnWidth = unisonRow.getWidth() / 3;
+
+    auto unisonColumn = unisonRow.removeFromLeft(unisonColumnWidth);
+    unisonLabel.setBounds(unisonColumn.removeFromLeft(100).reduced(5));
+    unisonSlider.setBounds(unisonColumn.reduced(5));
+
+    auto detuneColumn = unisonRow.removeFromLeft(unisonColumnWidth);
+    unisonDetuneLabel.setBounds(detuneColumn.removeFromLeft(60).reduced(5));
+    unisonDetuneSlider.setBounds(detuneColumn.reduced(5));
+
+    unisonSpreadLabel.setBounds(unisonRow.removeFromLeft(60).reduced(5));
+    unisonSpreadSlider.setBounds(unisonRow.reduced(5));
+
     // ADSR
     auto adsrArea = bounds.removeFromTop(250);
     adsrArea.reduce(20, 10);
@@ -204,6 +481,101 @@ void AudioPluginAudioProcessorEditor::resized()
     releaseLabel.setBounds(releaseArea.removeFromTop(20));
     releaseSlider.setBounds(releaseArea.reduced(5));
 
+    // FILTER
+    auto filterArea = bounds.removeFromTop(130);
+    filterArea.reduce(20, 8);
+
+    filterTitleLabel.setBounds(filterArea.removeFromTop(22));
+
+    auto layoutRow = [](juce::Rectangle<int> row, std::initializer_list<std::pair<juce::Label*, juce::Slider*>> controls)
+    {
+        auto columnWidth = row.getWidth() / (int)controls.size();
+
+        for (auto [label, slider] : controls)
+        {
+            auto column = row.removeFromLeft(columnWidth);
+            label->setBounds(column.removeFromLeft(60).reduced(5));
+            slider->setBounds(column.reduced(5));
+        }
+    };
+
+    layoutRow(filterArea.removeFromTop(30), { { &filterModeLabel, &filterModeSlider },
+                                              { &filterCutoffLabel, &filterCutoffSlider },
+                                              { &filterResonanceLabel, &filterResonanceSlider } });
+    layoutRow(filterArea.removeFromTop(30), { { &filterEnvAmountLabel, &filterEnvAmountSlider },
+                                              { &filterKeyTrackLabel, &filterKeyTrackSlider } });
+    layoutRow(filterArea.removeFromTop(30), { { &filterAttackLabel, &filterAttackSlider },
+                                              { &filterDecayLabel, &filterDecaySlider },
+                                              { &filterSustainLabel, &filterSustainSlider },
+                                              { &filterReleaseLabel, &filterReleaseSlider } });
+
+    // MODULATION
+    modulationArea.removeFromRight(10);
+    modulationArea.reduce(10, 15);
+
+    modulationTitleLabel.setBounds(modulationArea.removeFromTop(25));
+
+    for (size_t lfo = 0; lfo < lfoRateSliders.size(); ++lfo)
+    {
+        auto row = modulationArea.removeFromTop(30);
+        lfoShapeBoxes[lfo].setBounds(row.removeFromRight(90).reduced(5));
+        lfoRateLabels[lfo].setBounds(row.removeFromLeft(60).reduced(5));
+        lfoRateSliders[lfo].setBounds(row.reduced(5));
+    }
+
+    modulationArea.removeFromTop(10);
+
+    layoutRow(modulationArea.removeFromTop(30), { { &modAttackLabel, &modAttackSlider },
+                                                  { &modDecayLabel, &modDecaySlider } });
+    layoutRow(modulationArea.removeFromTop(30), { { &modSustainLabel, &modSustainSlider },
+                                                  { &modReleaseLabel, &modReleaseSlider } });
+
+    for (size_t slot = 0; slot < (size_t)Modulation::numSlots; ++slot)
+    {
+        modulationArea.removeFromTop(10);
+
+        auto routingRow = modulationArea.removeFromTop(30);
+        modSlotLabels[slot].setBounds(routingRow.removeFromLeft(25).reduced(2, 5));
+        modSourceBoxes[slot].setBounds(routingRow.removeFromLeft(routingRow.getWidth() / 2).reduced(3));
+        modDestinationBoxes[slot].setBounds(routingRow.reduced(3));
+
+        auto amountRow = modulationArea.removeFromTop(30);
+        amountRow.removeFromLeft(25);
+        modAmountLabels[slot].setBounds(amountRow.removeFromLeft(40).reduced(2, 5));
+        modAmountSliders[slot].setBounds(amountRow.reduced(3));
+    }
+
+    // REVERB
+    modulationArea.removeFromTop(15);
+    reverbTitleLabel.setBounds(modulationArea.removeFromTop(25));
+
+    auto reverbSendRow = modulationArea.removeFromTop(30);
+    reverbSendLabel.setBounds(reverbSendRow.removeFromLeft(60).reduced(5));
+    reverbSendSlider.setBounds(reverbSendRow.reduced(5));
+
+    auto reverbSizeRow = modulationArea.removeFromTop(30);
+    reverbSizeLabel.setBounds(reverbSizeRow.removeFromLeft(60).reduced(5));
+    reverbSizeSlider.setBounds(reverbSizeRow.reduced(5));
+
+    auto reverbButtonRow = modulationArea.removeFromTop(30);
+    reverbSharedButton.setBounds(reverbButtonRow.removeFromLeft(reverbButtonRow.getWidth() / 2).reduced(5));
+    reverbLoadButton.setBounds(reverbButtonRow.reduced(5));
+
+    // QUALITY
+    modulationArea.removeFromTop(15);
+
+    auto qualityRow = modulationArea.removeFromTop(30);
+    adaptiveQualityButton.setBounds(qualityRow.removeFromLeft(130).reduced(5));
+    qualityLabel.setBounds(qualityRow.reduced(5));
+
+    // SCOPE
+    auto scopeArea = bounds.withTrimmedBottom(keyboardHeight).reduced(10, 5);
+    scopeComponent.setBounds(scopeArea);
+
+   #if ARMONIO_ENABLE_TRACING
+    saveTraceButton.setBounds(bounds.getRight() - 110, 10, 100, 24);
+   #endif
+
     // KEYS
     keyboardComponent.setBounds(
         0,
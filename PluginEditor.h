@@ -1,10 +1,12 @@
 #pragma once
 
 #include "PluginProcessor.h"
+#include "ScopeComponent.h"
 #include <juce_audio_utils/juce_audio_utils.h>
 
 //==============================================================================
-class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor
+class AudioPluginAudioProcessorEditor final : public juce::AudioProcessorEditor,
+                                              private juce::Timer
 {
 public:
     explicit AudioPluginAudioProcessorEditor(AudioPluginAudioProcessor& p);
@@ -15,6 +17,8 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+
     AudioPluginAudioProcessor& processorRef;
 
     // Keyboard
@@ -24,6 +28,7 @@ private:
     // Waveform selector
     juce::Slider waveformSlider;
     juce::Label waveformLabel;
+    juce::ComboBox oscEngineBox;
 
     // Harmonics control
     juce::Slider harmonicsSlider;
@@ -33,6 +38,14 @@ private:
     juce::Slider subharmonicsSlider;
     juce::Label subharmonicsLabel;
 
+    // Unison controls
+    juce::Slider unisonSlider;
+    juce::Slider unisonDetuneSlider;
+    juce::Slider unisonSpreadSlider;
+    juce::Label unisonLabel;
+    juce::Label unisonDetuneLabel;
+    juce::Label unisonSpreadLabel;
+
     // ADSR controls
     juce::Slider attackSlider;
     juce::Slider decaySlider;
@@ -46,14 +59,123 @@ private:
 
     juce::Label adsrTitleLabel;
 
+    // Filter controls
+    juce::Label filterTitleLabel;
+
+    juce::Slider filterModeSlider;
+    juce::Slider filterCutoffSlider;
+    juce::Slider filterResonanceSlider;
+    juce::Slider filterEnvAmountSlider;
+    juce::Slider filterKeyTrackSlider;
+    juce::Slider filterAttackSlider;
+    juce::Slider filterDecaySlider;
+    juce::Slider filterSustainSlider;
+    juce::Slider filterReleaseSlider;
+
+    juce::Label filterModeLabel;
+    juce::Label filterCutoffLabel;
+    juce::Label filterResonanceLabel;
+    juce::Label filterEnvAmountLabel;
+    juce::Label filterKeyTrackLabel;
+    juce::Label filterAttackLabel;
+    juce::Label filterDecayLabel;
+    juce::Label filterSustainLabel;
+    juce::Label filterReleaseLabel;
+
+    // Modulation controls, in a column on the right
+    static constexpr int modulationWidth = 300;
+
+    juce::Label modulationTitleLabel;
+
+    std::array<juce::Slider, 2> lfoRateSliders;
+    std::array<juce::Label, 2> lfoRateLabels;
+    std::array<juce::ComboBox, 2> lfoShapeBoxes;
+
+    juce::Slider modAttackSlider;
+    juce::Slider modDecaySlider;
+    juce::Slider modSustainSlider;
+    juce::Slider modReleaseSlider;
+
+    juce::Label modAttackLabel;
+    juce::Label modDecayLabel;
+    juce::Label modSustainLabel;
+    juce::Label modReleaseLabel;
+
+    std::array<juce::Label, Modulation::numSlots> modSlotLabels;
+    std::array<juce::ComboBox, Modulation::numSlots> modSourceBoxes;
+    std::array<juce::ComboBox, Modulation::numSlots> modDestinationBoxes;
+    std::array<juce::Slider, Modulation::numSlots> modAmountSliders;
+    std::array<juce::Label, Modulation::numSlots> modAmountLabels;
+
+    // Reverb controls, below the modulation ones
+    juce::Label reverbTitleLabel;
+    juce::Slider reverbSendSlider;
+    juce::Slider reverbSizeSlider;
+    juce::Label reverbSendLabel;
+    juce::Label reverbSizeLabel;
+    juce::ToggleButton reverbSharedButton { "Shared" };
+    juce::TextButton reverbLoadButton { "Load IR..." };
+    std::unique_ptr<juce::FileChooser> reverbFileChooser;
+    void chooseReverbImpulseResponse();
+
+    // Whether the quality governor may step in, and what it has had to give up
+    juce::ToggleButton adaptiveQualityButton { "Adaptive quality" };
+    juce::Label qualityLabel;
+    int displayedQualityStage = -1;
+    void updateQualityIndicator();
+
+    // Wavetable, oscilloscope and spectrum display
+    ScopeComponent scopeComponent;
+
+   #if ARMONIO_ENABLE_TRACING
+    // Writes the recorded audio callback spans to a Chrome/Perfetto trace file
+    juce::TextButton saveTraceButton { "Save Trace" };
+    void saveTrace();
+   #endif
+
     // APVTS Attachments
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> waveformAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> oscEngineAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> harmonicsAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> subharmonicsAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> unisonAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> unisonDetuneAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> unisonSpreadAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> attackAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> decayAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> sustainAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> releaseAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterCutoffAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterResonanceAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterEnvAmountAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterKeyTrackAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterAttackAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterDecayAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterSustainAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> filterReleaseAttachment;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, 2> lfoRateAttachments;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>, 2> lfoShapeAttachments;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> modAttackAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> modDecayAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> modSustainAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> modReleaseAttachment;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>, Modulation::numSlots> modSourceAttachments;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>, Modulation::numSlots> modDestinationAttachments;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, Modulation::numSlots> modAmountAttachments;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> reverbSendAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> reverbSizeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> reverbSharedAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> adaptiveQualityAttachment;
+
+    // Sets up a labelled horizontal slider attached to a parameter
+    void addHorizontalControl(juce::Slider& slider, juce::Label& label, const juce::String& text,
+                              const juce::String& parameterID,
+                              std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>& attachment);
+
+    // Sets up a combo box listing a choice parameter's options
+    void addChoiceControl(juce::ComboBox& comboBox, const juce::StringArray& items, const juce::String& parameterID,
+                          std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioPluginAudioProcessorEditor)
 };
\ No newline at end of file
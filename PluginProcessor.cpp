@@ -7,26 +7,144 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor()
       synthAudioSource(keyboardState),
       apvts(*this, nullptr, "Parameters", createParameterLayout())
 {
+    auto value = [this](const juce::String& parameterID) { return apvts.getRawParameterValue(parameterID); };
+    auto& values = parameterValues;
+
+    values.waveform = value("waveform");
+    values.oscEngine = value("oscEngine");
+    values.harmonics = value("harmonics");
+    values.unison = value("unison");
+    values.unisonDetune = value("unisonDetune");
+    values.unisonSpread = value("unisonSpread");
+    values.seed = value("seed");
+    values.deterministic = value("deterministic");
+    values.attack = value("attack");
+    values.decay = value("decay");
+    values.sustain = value("sustain");
+    values.release = value("release");
+    values.filterMode = value("filterMode");
+    values.filterCutoff = value("filterCutoff");
+    values.filterResonance = value("filterResonance");
+    values.filterEnvAmount = value("filterEnvAmount");
+    values.filterKeyTrack = value("filterKeyTrack");
+    values.filterAttack = value("filterAttack");
+    values.filterDecay = value("filterDecay");
+    values.filterSustain = value("filterSustain");
+    values.filterRelease = value("filterRelease");
+
+    for (size_t lfo = 0; lfo < values.lfoRates.size(); ++lfo)
+    {
+        const auto prefix = "lfo" + juce::String((int)lfo + 1);
+        values.lfoRates[lfo] = value(prefix + "Rate");
+        values.lfoShapes[lfo] = value(prefix + "Shape");
+    }
+
+    values.modAttack = value("modAttack");
+    values.modDecay = value("modDecay");
+    values.modSustain = value("modSustain");
+    values.modRelease = value("modRelease");
+
+    for (size_t slot = 0; slot < values.modSources.size(); ++slot)
+    {
+        const auto prefix = "mod" + juce::String((int)slot + 1);
+        values.modSources[slot] = value(prefix + "Source");
+        values.modDestinations[slot] = value(prefix + "Destination");
+        values.modAmounts[slot] = value(prefix + "Amount");
+    }
+
+    values.reverbSend = value("reverbSend");
+    values.reverbSize = value("reverbSize");
+    values.reverbShared = value("reverbShared");
+    values.adaptiveQuality = value("adaptiveQuality");
+
     // Listen for parameter changes
     apvts.addParameterListener("waveform", this);
+    apvts.addParameterListener("oscEngine", this);
     apvts.addParameterListener("harmonics", this);
     apvts.addParameterListener("subharmonics", this);  // NEW: Listen for subharmonic changes
+    apvts.addParameterListener("unison", this);
+    apvts.addParameterListener("unisonDetune", this);
+    apvts.addParameterListener("unisonSpread", this);
+    apvts.addParameterListener("seed", this);
+    apvts.addParameterListener("deterministic", this);
     apvts.addParameterListener("attack", this);
     apvts.addParameterListener("decay", this);
     apvts.addParameterListener("sustain", this);
     apvts.addParameterListener("release", this);
+    apvts.addParameterListener("filterMode", this);
+    apvts.addParameterListener("filterCutoff", this);
+    apvts.addParameterListener("filterResonance", this);
+    apvts.addParameterListener("filterEnvAmount", this);
+    apvts.addParameterListener("filterKeyTrack", this);
+    apvts.addParameterListener("filterAttack", this);
+    apvts.addParameterListener("filterDecay", this);
+    apvts.addParameterListener("filterSustain", this);
+    apvts.addParameterListener("filterRelease", this);
+
+    for (const auto& parameterID : getModulationParameterIDs())
+        apvts.addParameterListener(parameterID, this);
+
+    apvts.addParameterListener("reverbSend", this);
+    apvts.addParameterListener("reverbSize", this);
+    apvts.addParameterListener("reverbShared", this);
+    apvts.addParameterListener("adaptiveQuality", this);
+
+    startTimerHz(30);
 }
 
 AudioPluginAudioProcessor::~AudioPluginAudioProcessor()
 {
+    stopTimer();
+
     // Clean up listeners
     apvts.removeParameterListener("waveform", this);
+    apvts.removeParameterListener("oscEngine", this);
     apvts.removeParameterListener("harmonics", this);
     apvts.removeParameterListener("subharmonics", this);  // NEW
+    apvts.removeParameterListener("unison", this);
+    apvts.removeParameterListener("unisonDetune", this);
+    apvts.removeParameterListener("unisonSpread", this);
+    apvts.removeParameterListener("seed", this);
+    apvts.removeParameterListener("deterministic", this);
     apvts.removeParameterListener("attack", this);
     apvts.removeParameterListener("decay", this);
     apvts.removeParameterListener("sustain", this);
     apvts.removeParameterListener("release", this);
+    apvts.removeParameterListener("filterMode", this);
+    apvts.removeParameterListener("filterCutoff", this);
+    apvts.removeParameterListener("filterResonance", this);
+    apvts.removeParameterListener("filterEnvAmount", this);
+    apvts.removeParameterListener("filterKeyTrack", this);
+    apvts.removeParameterListener("filterAttack", this);
+    apvts.removeParameterListener("filterDecay", this);
+    apvts.removeParameterListener("filterSustain", this);
+    apvts.removeParameterListener("filterRelease", this);
+
+    for (const auto& parameterID : getModulationParameterIDs())
+        apvts.removeParameterListener(parameterID, this);
+
+    apvts.removeParameterListener("reverbSend", this);
+    apvts.removeParameterListener("reverbSize", this);
+    apvts.removeParameterListener("reverbShared", this);
+    apvts.removeParameterListener("adaptiveQuality", this);
+}
+
+// The LFO, modulation envelope and matrix slot parameters, all handled by updateModulationParameters()
+const juce::StringArray& AudioPluginAudioProcessor::getModulationParameterIDs()
+{
+    static const juce::StringArray ids = []
+    {
+        juce::StringArray result { "lfo1Rate", "lfo1Shape", "lfo2Rate", "lfo2Shape",
+                                   "modAttack", "modDecay", "modSustain", "modRelease" };
+
+        for (int slot = 1; slot <= Modulation::numSlots; ++slot)
+            for (auto suffix : { "Source", "Destination", "Amount" })
+                result.add("mod" + juce::String(slot) + suffix);
+
+        return result;
+    }();
+
+    return ids;
 }
 
 //==============================================================================
@@ -40,6 +158,14 @@ juce::AudioProcessorValueTreeState::ParameterLayout AudioPluginAudioProcessor::c
         "Waveform",
         0, 3, 0));
 
+    // Oscillator engine: wavetables, table-free polyBLEP saw, square and triangle, or
+    // per-note additive partials
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "oscEngine",
+        "Oscillator Engine",
+        SynthAudioSource::getOscillatorEngineNames(),
+        0));
+
     // Harmonics
     layout.add(std::make_unique<juce::AudioParameterInt>(
         "harmonics",
@@ -54,6 +180,38 @@ juce::AudioProcessorValueTreeState::ParameterLayout AudioPluginAudioProcessor::c
         8,                             // Max: 8 subharmonics
         0));                           // Default: 0 (no subharmonics)
 
+    // Unison voices stacked on each note
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "unison",
+        "Unison",
+        1, 16, 1));
+
+    // Unison detune of the outermost voices (+/- cents)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "unisonDetune",
+        "Unison Detune",
+        juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f),
+        15.0f));
+
+    // Unison stereo spread (0 = mono, 1 = full width)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "unisonSpread",
+        "Unison Spread",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.5f));
+
+    // Seed for the per-voice phase generators
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "seed",
+        "Seed",
+        0, 65535, 1));
+
+    // Deterministic mode: identical MIDI and state always render bit-identical output
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "deterministic",
+        "Deterministic",
+        false));
+
     // Attack time (1ms to 2 seconds)
     layout.add(std::make_unique<juce::AudioParameterFloat>(
         "attack",
@@ -82,24 +240,197 @@ juce::AudioProcessorValueTreeState::ParameterLayout AudioPluginAudioProcessor::c
         juce::NormalisableRange<float>(0.001f, 5.0f, 0.001f),
         0.3f));
 
+    // Per-voice filter response (0=Low Pass, 1=Band Pass, 2=High Pass)
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "filterMode",
+        "Filter Mode",
+        0, 2, 0));
+
+    // Filter cutoff (20 Hz to 20 kHz, skewed towards the low end)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterCutoff",
+        "Filter Cutoff",
+        juce::NormalisableRange<float>(20.0f, 20000.0f, 0.1f, 0.25f),
+        20000.0f));
+
+    // Filter resonance (0 = Q of 0.5, 1 = close to self-oscillation)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterResonance",
+        "Filter Resonance",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.3f));
+
+    // Filter envelope depth (+/- 48 semitones at full envelope)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterEnvAmount",
+        "Filter Env Amount",
+        juce::NormalisableRange<float>(-48.0f, 48.0f, 0.1f),
+        0.0f));
+
+    // Filter key tracking (0 = fixed cutoff, 1 = follows the keyboard)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterKeyTrack",
+        "Filter Key Track",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.0f));
+
+    // Filter envelope attack (1ms to 2 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterAttack",
+        "Filter Attack",
+        juce::NormalisableRange<float>(0.001f, 2.0f, 0.001f),
+        0.01f));
+
+    // Filter envelope decay (1ms to 2 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterDecay",
+        "Filter Decay",
+        juce::NormalisableRange<float>(0.001f, 2.0f, 0.001f),
+        0.3f));
+
+    // Filter envelope sustain (0 to 1)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterSustain",
+        "Filter Sustain",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.5f));
+
+    // Filter envelope release (1ms to 5 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "filterRelease",
+        "Filter Release",
+        juce::NormalisableRange<float>(0.001f, 5.0f, 0.001f),
+        0.3f));
+
+    // LFO rates (0.01 Hz to 20 Hz, skewed towards slow) and shapes
+    for (int lfo = 1; lfo <= 2; ++lfo)
+    {
+        const auto prefix = "lfo" + juce::String(lfo);
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            prefix + "Rate",
+            "LFO " + juce::String(lfo) + " Rate",
+            juce::NormalisableRange<float>(0.01f, 20.0f, 0.01f, 0.3f),
+            lfo == 1 ? 2.0f : 0.5f));
+
+        layout.add(std::make_unique<juce::AudioParameterChoice>(
+            prefix + "Shape",
+            "LFO " + juce::String(lfo) + " Shape",
+            Modulation::getLfoShapeNames(),
+            lfo == 1 ? Modulation::sine : Modulation::triangle));
+    }
+
+    // Modulation envelope attack (1ms to 2 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "modAttack",
+        "Mod Attack",
+        juce::NormalisableRange<float>(0.001f, 2.0f, 0.001f),
+        0.01f));
+
+    // Modulation envelope decay (1ms to 2 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "modDecay",
+        "Mod Decay",
+        juce::NormalisableRange<float>(0.001f, 2.0f, 0.001f),
+        0.5f));
+
+    // Modulation envelope sustain (0 to 1)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "modSustain",
+        "Mod Sustain",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.0f));
+
+    // Modulation envelope release (1ms to 5 seconds)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "modRelease",
+        "Mod Release",
+        juce::NormalisableRange<float>(0.001f, 5.0f, 0.001f),
+        0.3f));
+
+    // Matrix slots: source, destination and bipolar depth (-1 to 1 of the destination's range)
+    for (int slot = 1; slot <= Modulation::numSlots; ++slot)
+    {
+        const auto prefix = "mod" + juce::String(slot);
+        const auto name = "Mod " + juce::String(slot);
+
+        layout.add(std::make_unique<juce::AudioParameterChoice>(
+            prefix + "Source",
+            name + " Source",
+            Modulation::getSourceNames(),
+            Modulation::none));
+
+        layout.add(std::make_unique<juce::AudioParameterChoice>(
+            prefix + "Destination",
+            name + " Destination",
+            Modulation::getDestinationNames(),
+            Modulation::pitch));
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            prefix + "Amount",
+            name + " Amount",
+            juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f),
+            0.0f));
+    }
+
+    // Reverb send level (0 = off, 1 = unity send into a unit-energy response)
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "reverbSend",
+        "Reverb Send",
+        juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f),
+        0.0f));
+
+    // Length of the generated impulse response (0.3 to 6 seconds); unused with a loaded file
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "reverbSize",
+        "Reverb Size",
+        juce::NormalisableRange<float>(0.3f, 6.0f, 0.01f, 0.5f),
+        2.0f));
+
+    // Send into one reverb shared by every instance that has this on
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "reverbShared",
+        "Reverb Shared",
+        false));
+
+    // Step quality down when callbacks get close to their deadline, and back up once they don't
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "adaptiveQuality",
+        "Adaptive Quality",
+        true));
+
     return layout;
 }
 
 //==============================================================================
 void AudioPluginAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
 {
-    if (parameterID == "waveform")
-    {
-        synthAudioSource.setWaveform((int)newValue);
-    }
-    else if (parameterID == "harmonics")
+    if (parameterID == "waveform" ||
+        parameterID == "oscEngine" ||
+        parameterID == "harmonics")
     {
-        synthAudioSource.setNumHarmonics((int)newValue);
+        // New sounds fetch tables from the process-wide bank, which locks and may
+        // build them, so host automation on the audio thread waits for the timer
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            updateOscillatorParameters();
+        else
+            oscillatorChangePending.store(true, std::memory_order_release);
     }
     else if (parameterID == "subharmonics")
     {
         synthAudioSource.setNumSubharmonics((int)newValue);
     }
+    else if (parameterID == "unison" ||
+             parameterID == "unisonDetune" ||
+             parameterID == "unisonSpread")
+    {
+        updateUnisonParameters();
+    }
+    else if (parameterID == "seed" ||
+             parameterID == "deterministic")
+    {
+        updateRandomSeed();
+    }
     else if (parameterID == "attack" ||
              parameterID == "decay" ||
              parameterID == "sustain" ||
@@ -107,18 +438,139 @@ void AudioPluginAudioProcessor::parameterChanged(const juce::String& parameterID
     {
         updateSynthParameters();
     }
+    else if (parameterID.startsWith("filter"))
+    {
+        filterChangePending.store(true, std::memory_order_release);
+    }
+    else if (parameterID.startsWith("lfo") || parameterID.startsWith("mod"))
+    {
+        modulationChangePending.store(true, std::memory_order_release);
+    }
+    else if (parameterID.startsWith("reverb"))
+    {
+        updateReverbParameters();
+    }
+    else if (parameterID == "adaptiveQuality")
+    {
+        qualityGovernor.setEnabled(newValue >= 0.5f);
+    }
+}
+
+void AudioPluginAudioProcessor::timerCallback()
+{
+    if (oscillatorChangePending.exchange(false, std::memory_order_acquire))
+        updateOscillatorParameters();
+
+    if (reverbChangePending.exchange(false, std::memory_order_acquire))
+        synthAudioSource.applyReverbSettings();
+}
+
+void AudioPluginAudioProcessor::updateOscillatorParameters()
+{
+    int engine = (int)parameterValues.oscEngine->load();
+    int waveform = (int)parameterValues.waveform->load();
+    int harmonics = (int)parameterValues.harmonics->load();
+
+    synthAudioSource.setOscillator(engine, waveform, harmonics);
 }
 
 void AudioPluginAudioProcessor::updateSynthParameters()
 {
-    float attack = apvts.getRawParameterValue("attack")->load();
-    float decay = apvts.getRawParameterValue("decay")->load();
-    float sustain = apvts.getRawParameterValue("sustain")->load();
-    float release = apvts.getRawParameterValue("release")->load();
+    float attack = parameterValues.attack->load();
+    float decay = parameterValues.decay->load();
+    float sustain = parameterValues.sustain->load();
+    float release = parameterValues.release->load();
 
     synthAudioSource.setADSRParameters(attack, decay, sustain, release);
 }
 
+void AudioPluginAudioProcessor::updateFilterParameters()
+{
+    int mode = (int)parameterValues.filterMode->load();
+    float cutoff = parameterValues.filterCutoff->load();
+    float resonance = parameterValues.filterResonance->load();
+    float envAmount = parameterValues.filterEnvAmount->load();
+    float keyTrack = parameterValues.filterKeyTrack->load();
+
+    synthAudioSource.setFilterParameters(mode, cutoff, resonance, envAmount, keyTrack);
+
+    float attack = parameterValues.filterAttack->load();
+    float decay = parameterValues.filterDecay->load();
+    float sustain = parameterValues.filterSustain->load();
+    float release = parameterValues.filterRelease->load();
+
+    synthAudioSource.setFilterEnvelopeParameters(attack, decay, sustain, release);
+}
+
+void AudioPluginAudioProcessor::updateModulationParameters()
+{
+    Modulation::Settings settings;
+
+    for (size_t lfo = 0; lfo < settings.lfoRates.size(); ++lfo)
+    {
+        settings.lfoRates[lfo] = parameterValues.lfoRates[lfo]->load();
+        settings.lfoShapes[lfo] = (int)parameterValues.lfoShapes[lfo]->load();
+    }
+
+    settings.envelopeParameters.attack = parameterValues.modAttack->load();
+    settings.envelopeParameters.decay = parameterValues.modDecay->load();
+    settings.envelopeParameters.sustain = parameterValues.modSustain->load();
+    settings.envelopeParameters.release = parameterValues.modRelease->load();
+
+    for (size_t slot = 0; slot < settings.slots.size(); ++slot)
+    {
+        settings.slots[slot].source = (int)parameterValues.modSources[slot]->load();
+        settings.slots[slot].destination = (int)parameterValues.modDestinations[slot]->load();
+        settings.slots[slot].amount = parameterValues.modAmounts[slot]->load();
+    }
+
+    synthAudioSource.setModulationSettings(settings);
+}
+
+void AudioPluginAudioProcessor::updateReverbParameters()
+{
+    float send = parameterValues.reverbSend->load();
+    float size = parameterValues.reverbSize->load();
+    bool shared = parameterValues.reverbShared->load() >= 0.5f;
+
+    synthAudioSource.setReverbParameters(send, size, shared);
+
+    // A new size rebuilds the response and sharing joins a process-wide list, so
+    // off the message thread only the values are stored until the timer runs
+    if (! juce::MessageManager::existsAndIsCurrentThread())
+        reverbChangePending.store(true, std::memory_order_release);
+}
+
+void AudioPluginAudioProcessor::loadReverbImpulseResponse(const juce::File& file)
+{
+    // Kept in the state so that the session reloads the same response
+    apvts.state.setProperty(reverbImpulseProperty, file.getFullPathName(), nullptr);
+    synthAudioSource.loadReverbImpulseResponse(file);
+}
+
+juce::File AudioPluginAudioProcessor::getReverbImpulseResponse() const
+{
+    const auto path = apvts.state.getProperty(reverbImpulseProperty).toString();
+    return path.isEmpty() ? juce::File() : juce::File(path);
+}
+
+void AudioPluginAudioProcessor::updateRandomSeed()
+{
+    int seed = (int)parameterValues.seed->load();
+    bool deterministic = parameterValues.deterministic->load() >= 0.5f;
+
+    synthAudioSource.setRandomSeed(seed, deterministic);
+}
+
+void AudioPluginAudioProcessor::updateUnisonParameters()
+{
+    int voices = (int)parameterValues.unison->load();
+    float detune = parameterValues.unisonDetune->load();
+    float spread = parameterValues.unisonSpread->load();
+
+    synthAudioSource.setUnison(voices, detune, spread);
+}
+
 //==============================================================================
 const juce::String AudioPluginAudioProcessor::getName() const
 {
@@ -154,7 +606,8 @@ bool AudioPluginAudioProcessor::isMidiEffect() const
 
 double AudioPluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Voices keep sounding for the release time after their note-off, then the reverb rings out
+    return (double)parameterValues.release->load() + synthAudioSource.getReverbTailLengthSeconds();
 }
 
 int AudioPluginAudioProcessor::getNumPrograms()
@@ -186,9 +639,20 @@ void AudioPluginAudioProcessor::changeProgramName(int index, const juce::String&
 //==============================================================================
 void AudioPluginAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    // Hosts switch to offline rendering before preparing for an export, so this is
+    // where the worker threads for it can start; one core is left for the caller.
+    // Every instance shares the same workers, so a session starts no more than this.
+    synthAudioSource.setNumOfflineRenderThreads(isNonRealtime() ? juce::SystemStats::getNumCpus() - 1 : 0);
     synthAudioSource.prepareToPlay(samplesPerBlock, sampleRate);
+    qualityGovernor.prepare(sampleRate);
+    qualityGovernor.setEnabled(parameterValues.adaptiveQuality->load() >= 0.5f);
 
     updateSynthParameters();
+    updateUnisonParameters();
+    updateFilterParameters();
+    updateModulationParameters();
+    updateReverbParameters();
+    updateRandomSeed();
 }
 
 void AudioPluginAudioProcessor::releaseResources()
@@ -217,10 +681,58 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
 
 void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    processSamples(buffer, midiMessages);
+}
+
+void AudioPluginAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
+{
+    ARMONIO_REALTIME_SCOPE();
+    ARMONIO_TRACE_THREAD_NAME("Audio");
+    ARMONIO_TRACE_SCOPE("processBlock");
+
     juce::ScopedNoDenormals noDenormals;
-    juce::AudioSourceChannelInfo channelInfo(buffer);
-    synthAudioSource.getNextAudioBlock(channelInfo, midiMessages);
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // A host may also switch without preparing again; without worker threads the
+    // offline settings still apply, just on this thread alone
+    synthAudioSource.setNonRealtime(isNonRealtime());
+
+    // Offline renders have no deadline, so they always get full quality
+    if (isNonRealtime())
+        qualityGovernor.reset();
+
+    synthAudioSource.setQualityStage(qualityGovernor.getStage());
+
+    if (filterChangePending.exchange(false, std::memory_order_acquire))
+        updateFilterParameters();
+
+    if (modulationChangePending.exchange(false, std::memory_order_acquire))
+        updateModulationParameters();
+
+    if constexpr (std::is_same_v<SampleType, float>)
+    {
+        juce::AudioSourceChannelInfo channelInfo(buffer);
+        synthAudioSource.getNextAudioBlock(channelInfo, midiMessages);
+    }
+    else
+    {
+        synthAudioSource.getNextAudioBlock(buffer, midiMessages);
+    }
+
     midiMessages.clear();
+
+    scopeFifo.push(buffer, 0, buffer.getNumSamples());
+
+    if (! isNonRealtime())
+        qualityGovernor.update(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks),
+                               buffer.getNumSamples());
 }
 
 //==============================================================================
@@ -253,6 +765,7 @@ void AudioPluginAudioProcessor::setStateInformation(const void* data, int sizeIn
         if (xmlState->hasTagName(apvts.state.getType()))
         {
             apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
+            synthAudioSource.loadReverbImpulseResponse(getReverbImpulseResponse());
         }
     }
 }
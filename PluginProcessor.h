@@ -2,10 +2,14 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "SynthAudioSource.h"
+#include "RealtimeSafety.h"
+#include "AudioScopeFifo.h"
+#include "QualityGovernor.h"
 
 //==============================================================================
 class AudioPluginAudioProcessor final : public juce::AudioProcessor,
-                                       public juce::AudioProcessorValueTreeState::Listener
+                                       public juce::AudioProcessorValueTreeState::Listener,
+                                       private juce::Timer
 {
 public:
     //==============================================================================
@@ -19,7 +23,10 @@ public:
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-    using AudioProcessor::processBlock;
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    // Hosts with a 64-bit mix bus get the voices summed straight into it
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -51,19 +58,87 @@ public:
     // Accessor for APVTS (used by Editor to attach sliders)
     juce::AudioProcessorValueTreeState& getValueTreeState() { return apvts; }
 
+    // Any thread: true if the last processed block was silent because no voice was sounding
+    bool isOutputSilent() const noexcept { return synthAudioSource.isOutputSilent(); }
+
+    // Message thread: mirrors host notes onto the on-screen keyboard while an editor is open
+    void setKeyboardDisplayActive(bool shouldBeActive) { synthAudioSource.setKeyboardDisplayActive(shouldBeActive); }
+    void updateKeyboardDisplay() { synthAudioSource.updateKeyboardDisplay(); }
+
+    // Message thread: an empty file goes back to the generated reverb response
+    void loadReverbImpulseResponse(const juce::File& file);
+    juce::File getReverbImpulseResponse() const;
+
+    // Any thread: the QualityGovernor::Stage realtime callbacks render at, and their
+    // smoothed load as a fraction of the deadline
+    int getQualityStage() const noexcept { return qualityGovernor.getStage(); }
+    float getCallbackLoad() const noexcept { return qualityGovernor.getLoad(); }
+
+    // Decimated copy of the output bus for the editor's scope and spectrum
+    AudioScopeFifo& getScopeFifo() { return scopeFifo; }
+
     juce::MidiKeyboardState keyboardState;
 
 private:
     SynthAudioSource synthAudioSource;
+    AudioScopeFifo scopeFifo;
+    QualityGovernor qualityGovernor;
 
     // The parameter state manager
     juce::AudioProcessorValueTreeState apvts;
 
+    // Every parameter the update helpers read, looked up once in the constructor:
+    // getRawParameterValue() builds a String and searches for it, which changes
+    // arriving on the audio thread must not do
+    struct ParameterValues
+    {
+        using Value = std::atomic<float>*;
+
+        Value waveform, oscEngine, harmonics;
+        Value unison, unisonDetune, unisonSpread;
+        Value seed, deterministic;
+        Value attack, decay, sustain, release;
+        Value filterMode, filterCutoff, filterResonance, filterEnvAmount, filterKeyTrack;
+        Value filterAttack, filterDecay, filterSustain, filterRelease;
+        std::array<Value, 2> lfoRates, lfoShapes;
+        Value modAttack, modDecay, modSustain, modRelease;
+        std::array<Value, Modulation::numSlots> modSources, modDestinations, modAmounts;
+        Value reverbSend, reverbSize, reverbShared;
+        Value adaptiveQuality;
+    };
+
+    ParameterValues parameterValues;
+
+    // State property holding the loaded impulse response's path
+    static inline const juce::Identifier reverbImpulseProperty { "reverbImpulse" };
+
     // Helper to create all parameters
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+    // Changes that must not run on the audio thread: automation arriving there sets
+    // a flag and timerCallback() applies it on the message thread
+    std::atomic<bool> oscillatorChangePending { false };
+    std::atomic<bool> reverbChangePending { false };
+    void timerCallback() override;
+
+    // Settings the voices take through lock-free mailboxes, which allow one writer:
+    // a change on any thread sets a flag and the audio thread hands them over
+    std::atomic<bool> filterChangePending { false };
+    std::atomic<bool> modulationChangePending { false };
+
     // Helper to update synth when parameters change
+    void updateOscillatorParameters();
     void updateSynthParameters();
+    void updateUnisonParameters();
+    void updateFilterParameters();
+    void updateModulationParameters();
+    void updateReverbParameters();
+    void updateRandomSeed();
+
+    static const juce::StringArray& getModulationParameterIDs();
+
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioPluginAudioProcessor)
 };
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "FastRandom.h"
+
+//==============================================================================
+// Band-limited saw, square and triangle computed directly from the phase, with no
+// table at all.
+//
+// The naive waveforms alias because of their corners: a saw or square jumps once
+// or twice per cycle and a triangle's slope flips twice. Polynomial corrections
+// around each corner (polyBLEP for jumps, its integral polyBLAMP for slope
+// changes) smooth them over the two samples nearest the discontinuity.
+//
+// Phases t run from 0 to 1 and dt is the phase increment per sample. The
+// functions are branch-light so a loop over many phases auto-vectorises.
+namespace PolyBlep
+{
+    enum Shape
+    {
+        none = -1,      // read the wavetable instead
+        saw,
+        square,
+        triangle,
+        numShapes
+    };
+
+    // Residual of a unit step at t = 0, relative to the naive step
+    inline float blep(float t, float dt) noexcept
+    {
+        const auto before = (t - 1.0f) / dt;
+        const auto after = t / dt;
+
+        return t < dt       ? after + after - after * after - 1.0f
+             : t > 1.0f - dt ? before * before + before + before + 1.0f
+                             : 0.0f;
+    }
+
+    // Residual of a unit slope change at t = 0: the integral of blep()
+    inline float blamp(float t, float dt) noexcept
+    {
+        const auto before = (t - 1.0f) / dt + 1.0f;
+        const auto after = t / dt - 1.0f;
+
+        return t < dt       ? -(after * after * after) / 3.0f
+             : t > 1.0f - dt ? before * before * before / 3.0f
+                             : 0.0f;
+    }
+
+    inline float wrap(float t) noexcept
+    {
+        return t >= 1.0f ? t - 1.0f : t;
+    }
+
+    // One sample of a shape at phase t, peaking at +/-1. The shape is a template
+    // argument so the loops calling this carry no switch.
+    template <int shape>
+    inline float sample(float t, float dt) noexcept
+    {
+        if constexpr (shape == saw)
+        {
+            return 2.0f * t - 1.0f - blep(t, dt);
+        }
+        else if constexpr (shape == square)
+        {
+            const auto half = wrap(t + 0.5f);
+            return (t < 0.5f ? 1.0f : -1.0f) + blep(t, dt) - blep(half, dt);
+        }
+        else
+        {
+            // The slope is -4 on the way down from t = 0 and +4 on the way back
+            // up from t = 0.5, so each corner changes it by 8 per cycle
+            const auto half = wrap(t + 0.5f);
+            return 2.0f * std::abs(2.0f * t - 1.0f) - 1.0f - 4.0f * dt * (blamp(t, dt) - blamp(half, dt));
+        }
+    }
+
+    // Keeps the corrections well defined: polyBLEP assumes at most one corner per
+    // sample, and a still phase would divide by zero
+    inline float clampIncrement(float dt) noexcept
+    {
+        return juce::jlimit(1.0e-6f, 0.5f, dt);
+    }
+
+    // Amplitude of each shape's fundamental, 4 / pi for a square swinging +/-1
+    inline double fundamentalAmplitude(int shape) noexcept
+    {
+        constexpr auto pi = juce::MathConstants<double>::pi;
+
+        switch (shape)
+        {
+            case saw:    return 2.0 / pi;
+            case square: return 4.0 / pi;
+            default:     return 8.0 / (pi * pi);
+        }
+    }
+
+    inline float sample(int shape, float t, float dt) noexcept
+    {
+        switch (shape)
+        {
+            case saw:    return sample<saw>(t, dt);
+            case square: return sample<square>(t, dt);
+            default:     return sample<triangle>(t, dt);
+        }
+    }
+}
+
+//==============================================================================
+// A single analytic oscillator, the table-free counterpart of WavetableOscillator
+class PolyBlepOscillator
+{
+public:
+    // The gain lets the shape match the level of a table it stands in for
+    void setShape(int newShape, float newGain = 1.0f) noexcept
+    {
+        shape = juce::jlimit(0, PolyBlep::numShapes - 1, newShape);
+        gain = newGain;
+    }
+
+    void setFrequency(float frequency, float sampleRate) noexcept
+    {
+        delta = PolyBlep::clampIncrement(frequency / sampleRate);
+    }
+
+    void setRandomPhase(FastRandom& random)
+    {
+        phase = random.nextFloat();
+    }
+
+    forcedinline float getNextSample() noexcept
+    {
+        const auto value = gain * PolyBlep::sample(shape, phase, delta);
+
+        phase += delta;
+        if (phase >= 1.0f)
+            phase -= 1.0f;
+
+        return value;
+    }
+
+    void reset()
+    {
+        phase = 0.0f;
+    }
+
+private:
+    int shape = PolyBlep::saw;
+    float gain = 1.0f;
+    float phase = 0.0f;
+    float delta = 0.0f;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cmath>
+
+//==============================================================================
+// Times each realtime callback against its deadline, numSamples / sampleRate, and
+// steps quality down when the load gets close to it.
+//
+// The load is smoothed, rising quickly and falling slowly. Above degradeLoad the
+// governor drops a stage at most once per holdSeconds; it only climbs back a stage
+// once the load has stayed under restoreLoad for restoreSeconds, so a patch that
+// just about fits at a stage does not flap between two.
+class QualityGovernor
+{
+public:
+    enum Stage
+    {
+        fullQuality,
+        thinQuietVoices,   // soft and releasing notes drop their subharmonics
+        noSubharmonics,    // every note drops them
+        fewerVoices,       // and new notes steal beyond reducedVoiceLimit
+        numStages
+    };
+
+    static juce::StringArray getStageNames()
+    {
+        return { "Full quality", "Quiet voices thinned", "No subharmonics", "Fewer voices" };
+    }
+
+    static constexpr int reducedVoiceLimit = 8;
+
+    static constexpr double degradeLoad = 0.8;
+    static constexpr double restoreLoad = 0.5;
+    static constexpr double holdSeconds = 0.05;
+    static constexpr double restoreSeconds = 2.0;
+
+    // Time constants of the smoothed load
+    static constexpr double riseSeconds = 0.01;
+    static constexpr double fallSeconds = 0.2;
+
+    void prepare(double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    // Back to full quality, e.g. for an offline render or after a stall
+    void reset() noexcept
+    {
+        smoothedLoad = 0.0;
+        stage = fullQuality;
+        secondsSinceChange = holdSeconds;
+        secondsUnderRestore = 0.0;
+        publish();
+    }
+
+    // Any thread; while disabled the governor stays at full quality
+    void setEnabled(bool shouldBeEnabled) noexcept { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+
+    // Audio thread, after each realtime callback: how long numSamples took to
+    // process. Returns the stage the next callback should render at.
+    int update(double elapsedSeconds, int numSamples) noexcept
+    {
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return stage;
+
+        if (! enabled.load(std::memory_order_relaxed))
+        {
+            if (stage != fullQuality || smoothedLoad != 0.0)
+                reset();
+
+            return stage;
+        }
+
+        const auto deadline = numSamples / sampleRate;
+        const auto load = elapsedSeconds / deadline;
+        const auto timeConstant = load > smoothedLoad ? riseSeconds : fallSeconds;
+
+        smoothedLoad += (load - smoothedLoad) * (1.0 - std::exp(-deadline / timeConstant));
+        secondsSinceChange += deadline;
+
+        if (smoothedLoad > degradeLoad)
+        {
+            secondsUnderRestore = 0.0;
+
+            if (stage < numStages - 1 && secondsSinceChange >= holdSeconds)
+                changeStage(stage + 1);
+        }
+        else if (smoothedLoad < restoreLoad)
+        {
+            secondsUnderRestore += deadline;
+
+            if (stage > fullQuality && secondsUnderRestore >= restoreSeconds)
+            {
+                changeStage(stage - 1);
+                secondsUnderRestore = 0.0;
+            }
+        }
+        else
+        {
+            secondsUnderRestore = 0.0;
+        }
+
+        publish();
+        return stage;
+    }
+
+    // Any thread, e.g. for the editor's indicator
+    int getStage() const noexcept  { return publishedStage.load(std::memory_order_relaxed); }
+    float getLoad() const noexcept { return publishedLoad.load(std::memory_order_relaxed); }
+
+private:
+    double sampleRate = 0.0;
+    double smoothedLoad = 0.0;
+    int stage = fullQuality;
+    double secondsSinceChange = holdSeconds;
+    double secondsUnderRestore = 0.0;
+
+    std::atomic<bool> enabled { true };
+    std::atomic<int> publishedStage { fullQuality };
+    std::atomic<float> publishedLoad { 0.0f };
+
+    void changeStage(int newStage) noexcept
+    {
+        stage = newStage;
+        secondsSinceChange = 0.0;
+    }
+
+    void publish() noexcept
+    {
+        publishedStage.store(stage, std::memory_order_relaxed);
+        publishedLoad.store((float)smoothedLoad, std::memory_order_relaxed);
+    }
+};
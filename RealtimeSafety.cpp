@@ -0,0 +1,268 @@
+#include "RealtimeSafety.h"
+
+#if ARMONIO_RT_SAFETY_CHECKS
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX && defined(__GLIBC__)
+ #define ARMONIO_RT_SAFETY_HOOK_LIBC 1
+ #include <dlfcn.h>
+ #include <pthread.h>
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+}
+#else
+ #define ARMONIO_RT_SAFETY_HOOK_LIBC 0
+#endif
+
+namespace
+{
+    thread_local int realtimeDepth = 0;
+    thread_local int reportDepth = 0;
+
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> reportUncontendedLocks { false };
+
+    void* rawAllocate(std::size_t size) noexcept
+    {
+       #if ARMONIO_RT_SAFETY_HOOK_LIBC
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+
+    void rawFree(void* ptr) noexcept
+    {
+       #if ARMONIO_RT_SAFETY_HOOK_LIBC
+        __libc_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+
+    void* rawAllocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        const auto align = juce::jmax((std::size_t)alignment, sizeof(void*));
+
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+       #else
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, align, size == 0 ? 1 : size) == 0 ? ptr : nullptr;
+       #endif
+    }
+
+    void rawFreeAligned(void* ptr) noexcept
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(ptr);
+       #else
+        std::free(ptr);
+       #endif
+    }
+}
+
+//==============================================================================
+RealtimeSafetyChecker::ScopedRealtimeContext::ScopedRealtimeContext() noexcept   { ++realtimeDepth; }
+RealtimeSafetyChecker::ScopedRealtimeContext::~ScopedRealtimeContext() noexcept  { --realtimeDepth; }
+
+RealtimeSafetyChecker::ScopedNonRealtimeContext::ScopedNonRealtimeContext() noexcept
+    : savedDepth(realtimeDepth)
+{
+    realtimeDepth = 0;
+}
+
+RealtimeSafetyChecker::ScopedNonRealtimeContext::~ScopedNonRealtimeContext() noexcept
+{
+    realtimeDepth = savedDepth;
+}
+
+bool RealtimeSafetyChecker::isInRealtimeContext() noexcept
+{
+    return realtimeDepth > 0;
+}
+
+void RealtimeSafetyChecker::checkOperation(const char* operation) noexcept
+{
+    if (realtimeDepth <= 0 || reportDepth > 0)
+        return;
+
+    // Building the backtrace allocates, so violations are not reported recursively
+    ++reportDepth;
+    numViolations.fetch_add(1);
+
+    auto backtrace = juce::SystemStats::getStackBacktrace();
+    std::fprintf(stderr, "*** Realtime safety violation: %s\n%s\n", operation, backtrace.toRawUTF8());
+    std::fflush(stderr);
+
+    --reportDepth;
+}
+
+int RealtimeSafetyChecker::getNumViolations() noexcept            { return numViolations.load(); }
+void RealtimeSafetyChecker::resetViolations() noexcept            { numViolations.store(0); }
+void RealtimeSafetyChecker::setReportUncontendedLocks(bool b) noexcept { reportUncontendedLocks.store(b); }
+bool RealtimeSafetyChecker::shouldReportUncontendedLocks() noexcept    { return reportUncontendedLocks.load(); }
+
+//==============================================================================
+void* operator new(std::size_t size)
+{
+    RealtimeSafetyChecker::checkOperation("operator new");
+
+    if (auto* ptr = rawAllocate(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    RealtimeSafetyChecker::checkOperation("operator new[]");
+
+    if (auto* ptr = rawAllocate(size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafetyChecker::checkOperation("operator new");
+    return rawAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeSafetyChecker::checkOperation("operator new[]");
+    return rawAllocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    RealtimeSafetyChecker::checkOperation("operator new");
+
+    if (auto* ptr = rawAllocateAligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    RealtimeSafetyChecker::checkOperation("operator new[]");
+
+    if (auto* ptr = rawAllocateAligned(size, alignment))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafetyChecker::checkOperation("operator delete");
+
+    rawFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafetyChecker::checkOperation("operator delete[]");
+
+    rawFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept    { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept  { operator delete[](ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafetyChecker::checkOperation("operator delete");
+
+    rawFreeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeSafetyChecker::checkOperation("operator delete[]");
+
+    rawFreeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept    { operator delete(ptr, alignment); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept  { operator delete[](ptr, alignment); }
+
+//==============================================================================
+#if ARMONIO_RT_SAFETY_HOOK_LIBC
+
+extern "C"
+{
+    void* malloc(size_t size)
+    {
+        RealtimeSafetyChecker::checkOperation("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        RealtimeSafetyChecker::checkOperation("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        RealtimeSafetyChecker::checkOperation("realloc");
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr != nullptr)
+            RealtimeSafetyChecker::checkOperation("free");
+
+        __libc_free(ptr);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        using MutexLockFunction = int (*)(pthread_mutex_t*);
+        static std::atomic<MutexLockFunction> realMutexLock { nullptr };
+
+        auto lockFunction = realMutexLock.load(std::memory_order_acquire);
+
+        if (lockFunction == nullptr)
+        {
+            lockFunction = reinterpret_cast<MutexLockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            realMutexLock.store(lockFunction, std::memory_order_release);
+        }
+
+        if (RealtimeSafetyChecker::isInRealtimeContext())
+        {
+            if (pthread_mutex_trylock(mutex) == 0)
+            {
+                if (RealtimeSafetyChecker::shouldReportUncontendedLocks())
+                    RealtimeSafetyChecker::checkOperation("pthread_mutex_lock (uncontended)");
+
+                return 0;
+            }
+
+            RealtimeSafetyChecker::checkOperation("pthread_mutex_lock (contended)");
+        }
+
+        return lockFunction(mutex);
+    }
+}
+
+#endif
+
+#endif
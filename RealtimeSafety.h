@@ -0,0 +1,63 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#ifndef ARMONIO_RT_SAFETY_CHECKS
+ #define ARMONIO_RT_SAFETY_CHECKS 0
+#endif
+
+#if ARMONIO_RT_SAFETY_CHECKS
+
+//==============================================================================
+// Debug aid that reports heap allocations and blocking lock acquisitions made
+// while a thread is inside a realtime scope (normally the audio callback).
+//
+// operator new/delete are intercepted on every platform. malloc/calloc/realloc/free
+// and pthread_mutex_lock are intercepted on Linux; those hooks only take effect for
+// code linked into an executable (the Standalone app and the test runner), since a
+// dlopen'ed plugin binds to the host's libc first.
+class RealtimeSafetyChecker
+{
+public:
+    class ScopedRealtimeContext
+    {
+    public:
+        ScopedRealtimeContext() noexcept;
+        ~ScopedRealtimeContext() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeContext)
+    };
+
+    // Temporarily permits non-realtime operations inside a realtime scope
+    class ScopedNonRealtimeContext
+    {
+    public:
+        ScopedNonRealtimeContext() noexcept;
+        ~ScopedNonRealtimeContext() noexcept;
+
+    private:
+        int savedDepth;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedNonRealtimeContext)
+    };
+
+    static bool isInRealtimeContext() noexcept;
+
+    // Reports a violation with a stack trace if the calling thread is in a realtime scope
+    static void checkOperation(const char* operation) noexcept;
+
+    static int getNumViolations() noexcept;
+    static void resetViolations() noexcept;
+
+    // Uncontended locks never block, so by default only contended acquisitions are reported
+    static void setReportUncontendedLocks(bool shouldReport) noexcept;
+    static bool shouldReportUncontendedLocks() noexcept;
+};
+
+ #define ARMONIO_REALTIME_SCOPE()  const RealtimeSafetyChecker::ScopedRealtimeContext JUCE_JOIN_MACRO(armonioRealtimeScope_, __LINE__)
+
+#else
+
+ #define ARMONIO_REALTIME_SCOPE()
+
+#endif
@@ -0,0 +1,250 @@
+#include "ScopeComponent.h"
+
+//==============================================================================
+ScopeComponent::ScopeComponent(AudioPluginAudioProcessor& p)
+    : processorRef(p)
+{
+    setOpaque(true);
+    spectrumDb.fill(-100.0f);
+
+    processorRef.getScopeFifo().setActive(true);
+    startTimerHz(refreshRateHz);
+}
+
+ScopeComponent::~ScopeComponent()
+{
+    stopTimer();
+    processorRef.getScopeFifo().setActive(false);
+}
+
+//==============================================================================
+void ScopeComponent::paint(juce::Graphics& g)
+{
+    if (cachedImage.isValid())
+        g.drawImageAt(cachedImage, 0, 0);
+    else
+        g.fillAll(juce::Colour(0xff1a1a1a));
+}
+
+void ScopeComponent::resized()
+{
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        cachedImage = {};
+        return;
+    }
+
+    cachedImage = juce::Image(juce::Image::RGB, getWidth(), getHeight(), true);
+    renderImage();
+}
+
+void ScopeComponent::timerCallback()
+{
+    // Hidden editors (minimised or behind other windows' tabs) do no work at all
+    if (! isShowing())
+        return;
+
+    auto needsRedraw = updateWavetablePreview();
+
+    if (pullOutputSamples())
+    {
+        updateSpectrum();
+        needsRedraw = true;
+    }
+
+    if (needsRedraw)
+    {
+        renderImage();
+        repaint();
+    }
+}
+
+//==============================================================================
+bool ScopeComponent::updateWavetablePreview()
+{
+    auto& state = processorRef.getValueTreeState();
+    auto waveform = (int)state.getRawParameterValue("waveform")->load();
+    auto harmonics = (int)state.getRawParameterValue("harmonics")->load();
+
+    if (waveform == previewWaveform && harmonics == previewHarmonics)
+        return false;
+
+    previewWaveform = waveform;
+    previewHarmonics = harmonics;
+
+    // Same key as the synth's own table, so this is normally a lookup rather than a build
+    wavetablePreview = wavetableBank->getTable(waveform, harmonics,
+                                               SynthAudioSource::wavetableSize,
+                                               getProcessorSampleRate());
+    return true;
+}
+
+bool ScopeComponent::pullOutputSamples()
+{
+    const auto numPulled = processorRef.getScopeFifo().pull(incoming.data(), (int)incoming.size());
+
+    if (numPulled == 0)
+        return false;
+
+    // Keep the most recent fftSize frames, oldest first
+    const auto numNew = juce::jmin(numPulled, fftSize);
+    const auto* newest = incoming.data() + numPulled - numNew;
+
+    std::memmove(history.data(), history.data() + numNew, (size_t)(fftSize - numNew) * sizeof(float));
+    std::memcpy(history.data() + fftSize - numNew, newest, (size_t)numNew * sizeof(float));
+
+    // A silent instance only redraws once, when it falls silent
+    auto range = juce::FloatVectorOperations::findMinAndMax(newest, numNew);
+    auto isSilent = range.getStart() == 0.0f && range.getEnd() == 0.0f;
+    auto wasSilent = std::exchange(isOutputSilent, isSilent);
+
+    return ! (isSilent && wasSilent);
+}
+
+void ScopeComponent::updateSpectrum()
+{
+    std::fill(fftData.begin(), fftData.end(), 0.0f);
+    std::copy(history.begin(), history.end(), fftData.begin());
+
+    window.multiplyWithWindowingTable(fftData.data(), (size_t)fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // Peak-hold with a gentle fall-off so the display does not flicker
+    constexpr float fallOffDb = 3.0f;
+    const auto scale = 2.0f / (float)fftSize;
+
+    for (size_t bin = 0; bin < spectrumDb.size(); ++bin)
+    {
+        auto level = juce::Decibels::gainToDecibels(fftData[bin] * scale, -100.0f);
+        spectrumDb[bin] = juce::jmax(level, spectrumDb[bin] - fallOffDb);
+    }
+}
+
+//==============================================================================
+void ScopeComponent::renderImage()
+{
+    if (! cachedImage.isValid())
+        return;
+
+    juce::Graphics g(cachedImage);
+    g.fillAll(juce::Colour(0xff1a1a1a));
+
+    auto bounds = getLocalBounds().toFloat();
+    auto panelWidth = bounds.getWidth() / 3.0f;
+
+    auto wavetableArea = bounds.removeFromLeft(panelWidth).reduced(4.0f);
+    auto scopeArea = bounds.removeFromLeft(panelWidth).reduced(4.0f);
+    auto spectrumArea = bounds.reduced(4.0f);
+
+    for (auto area : { wavetableArea, scopeArea, spectrumArea })
+    {
+        g.setColour(juce::Colour(0xff3a3a3a));
+        g.drawRect(area, 1.0f);
+    }
+
+    drawWavetable(g, wavetableArea.reduced(2.0f));
+    drawOscilloscope(g, scopeArea.reduced(2.0f));
+    drawSpectrum(g, spectrumArea.reduced(2.0f));
+}
+
+void ScopeComponent::drawWavetable(juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    if (wavetablePreview == nullptr || wavetablePreview->getNumSamples() < 2)
+        return;
+
+    const auto numSamples = wavetablePreview->getNumSamples();
+    const auto* samples = wavetablePreview->getReadPointer(0);
+    const auto numPoints = juce::jmax(2, (int)area.getWidth());
+
+    juce::Path path;
+
+    for (int x = 0; x < numPoints; ++x)
+    {
+        auto index = (x * (numSamples - 1)) / (numPoints - 1);
+        auto y = juce::jmap(samples[index], -1.0f, 1.0f, area.getBottom(), area.getY());
+        auto px = area.getX() + (float)x * area.getWidth() / (float)(numPoints - 1);
+
+        if (x == 0)
+            path.startNewSubPath(px, y);
+        else
+            path.lineTo(px, y);
+    }
+
+    g.setColour(juce::Colours::orange);
+    g.strokePath(path, juce::PathStrokeType(1.5f));
+}
+
+void ScopeComponent::drawOscilloscope(juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    constexpr int displayLength = fftSize / 2;
+
+    // Trigger on a rising zero crossing so that periodic signals stand still
+    int trigger = 0;
+
+    for (int i = 1; i < fftSize - displayLength; ++i)
+    {
+        if (history[(size_t)(i - 1)] <= 0.0f && history[(size_t)i] > 0.0f)
+        {
+            trigger = i;
+            break;
+        }
+    }
+
+    const auto numPoints = juce::jmax(2, (int)area.getWidth());
+
+    juce::Path path;
+
+    for (int x = 0; x < numPoints; ++x)
+    {
+        auto index = trigger + (x * (displayLength - 1)) / (numPoints - 1);
+        auto value = juce::jlimit(-1.0f, 1.0f, history[(size_t)index] * 2.0f);
+        auto y = juce::jmap(value, -1.0f, 1.0f, area.getBottom(), area.getY());
+        auto px = area.getX() + (float)x * area.getWidth() / (float)(numPoints - 1);
+
+        if (x == 0)
+            path.startNewSubPath(px, y);
+        else
+            path.lineTo(px, y);
+    }
+
+    g.setColour(juce::Colours::lightgreen);
+    g.strokePath(path, juce::PathStrokeType(1.0f));
+}
+
+void ScopeComponent::drawSpectrum(juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    constexpr float minDb = -90.0f;
+    constexpr float minFreq = 20.0f;
+
+    const auto nyquist = (float)getProcessorSampleRate() / (2.0f * AudioScopeFifo::decimationFactor);
+    const auto binWidth = nyquist / (float)spectrumDb.size();
+    const auto numPoints = juce::jmax(2, (int)area.getWidth());
+
+    juce::Path path;
+
+    for (int x = 0; x < numPoints; ++x)
+    {
+        // Logarithmic frequency axis
+        auto proportion = (float)x / (float)(numPoints - 1);
+        auto freq = minFreq * std::pow(nyquist / minFreq, proportion);
+        auto bin = juce::jlimit(0, (int)spectrumDb.size() - 1, (int)(freq / binWidth));
+
+        auto level = juce::jlimit(minDb, 0.0f, spectrumDb[(size_t)bin]);
+        auto y = juce::jmap(level, minDb, 0.0f, area.getBottom(), area.getY());
+        auto px = area.getX() + proportion * area.getWidth();
+
+        if (x == 0)
+            path.startNewSubPath(px, y);
+        else
+            path.lineTo(px, y);
+    }
+
+    g.setColour(juce::Colours::skyblue);
+    g.strokePath(path, juce::PathStrokeType(1.0f));
+}
+
+double ScopeComponent::getProcessorSampleRate() const
+{
+    auto sampleRate = processorRef.getSampleRate();
+    return sampleRate > 0.0 ? sampleRate : 44100.0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PluginProcessor.h"
+#include <juce_dsp/juce_dsp.h>
+#include <juce_gui_basics/juce_gui_basics.h>
+
+//==============================================================================
+// Shows the selected wavetable, an oscilloscope and a spectrum of the output bus.
+// All analysis runs on the message thread at a capped rate and is drawn into a
+// cached image, so paint() only blits it.
+class ScopeComponent final : public juce::Component,
+                             private juce::Timer
+{
+public:
+    explicit ScopeComponent(AudioPluginAudioProcessor& p);
+    ~ScopeComponent() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int refreshRateHz = 30;
+
+    AudioPluginAudioProcessor& processorRef;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t)fftSize, juce::dsp::WindowingFunction<float>::hann };
+
+    std::array<float, AudioScopeFifo::capacity> incoming {};
+    std::array<float, fftSize> history {};
+    std::array<float, fftSize * 2> fftData {};
+    std::array<float, fftSize / 2> spectrumDb {};
+
+    juce::SharedResourcePointer<WavetableBank> wavetableBank;
+    WavetableBank::TablePtr wavetablePreview;
+    int previewWaveform = -1;
+    int previewHarmonics = -1;
+
+    juce::Image cachedImage;
+    bool isOutputSilent = true;
+
+    void timerCallback() override;
+
+    bool updateWavetablePreview();
+    bool pullOutputSamples();
+    void updateSpectrum();
+    void renderImage();
+
+    void drawWavetable(juce::Graphics&, juce::Rectangle<float> area) const;
+    void drawOscilloscope(juce::Graphics&, juce::Rectangle<float> area) const;
+    void drawSpectrum(juce::Graphics&, juce::Rectangle<float> area) const;
+
+    double getProcessorSampleRate() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScopeComponent)
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+//==============================================================================
+// Hands the latest copy of a value from one writer thread to one reader, e.g.
+// settings from wherever a parameter changed to the audio thread.
+//
+// The value goes through three slots: the writer fills its own, then swaps it
+// with the one in between in a single exchange, and the reader swaps that into
+// its own when it next looks. Neither side waits, and the reader never sees a
+// value half written. Only the latest value is kept.
+template <typename ValueType>
+class SnapshotMailbox
+{
+public:
+    SnapshotMailbox() = default;
+    explicit SnapshotMailbox(const ValueType& initialValue) { values.fill(initialValue); }
+
+    // Writer side, one thread at a time
+    void publish(const ValueType& newValue) noexcept
+    {
+        values[(size_t)writeSlot] = newValue;
+        writeSlot = sharedSlot.exchange(writeSlot | newValueFlag, std::memory_order_acq_rel) & ~newValueFlag;
+    }
+
+    // Reader side: takes the latest value if one has been published since it last
+    // looked, and says whether it did
+    bool adoptLatest() noexcept
+    {
+        if ((sharedSlot.load(std::memory_order_relaxed) & newValueFlag) == 0)
+            return false;
+
+        readSlot = sharedSlot.exchange(readSlot, std::memory_order_acq_rel) & ~newValueFlag;
+        return true;
+    }
+
+    // Reader side: the value it adopted last
+    const ValueType& get() const noexcept { return values[(size_t)readSlot]; }
+
+private:
+    // Set on sharedSlot while it holds a value the reader has not taken yet
+    static constexpr int newValueFlag = 4;
+
+    std::array<ValueType, 3> values {};
+    int writeSlot = 0;                  // publish()'s
+    std::atomic<int> sharedSlot { 1 };  // the one in between
+    int readSlot = 2;                   // the reader's
+};
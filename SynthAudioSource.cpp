@@ -3,45 +3,45 @@
 SynthAudioSource::SynthAudioSource(juce::MidiKeyboardState& keyState)
     : keyboardState(keyState)
 {
-    initializeWavetables();
+    ARMONIO_TRACE_SCOPE("SynthAudioSource::SynthAudioSource");
+
+    keyboardState.addListener(this);
 
     // Add voices
     for (auto i = 0; i < 16; ++i)
         synth.addVoice(new WavetableVoice());
 
-    synth.addSound(new WavetableSound(sineWavetable));
+    setRandomSeed(1, false);
+
+    // Only the selected table is fetched, and with one harmonic every instance in the
+    // process shares the same copy of compile-time data
+    setWaveform(currentWaveform);
+}
+
+SynthAudioSource::~SynthAudioSource()
+{
+    keyboardState.removeListener(this);
+    setNumOfflineRenderThreads(0);
 }
 
-void SynthAudioSource::initializeWavetables()
+const WavetableBank::TablePtr& SynthAudioSource::getWavetable(int waveformType)
 {
-    const unsigned int tableSize = 2048;
+    auto index = (size_t)juce::jlimit(0, numWaveforms - 1, waveformType);
 
-    float referenceFreq = 261.63f;
+    if (wavetables[index] == nullptr)
+        wavetables[index] = wavetableBank->getTable((int)index, currentNumHarmonics, wavetableSize, currentSampleRate);
 
-    sineWavetable = WaveformGenerator::createSineWave(
-        tableSize, 1, referenceFreq, (float)currentSampleRate);
-    sawWavetable = WaveformGenerator::createSawWave(
-        tableSize, 1, referenceFreq, (float)currentSampleRate);
-    squareWavetable = WaveformGenerator::createSquareWave(
-        tableSize, 1, referenceFreq, (float)currentSampleRate);
-    triangleWavetable = WaveformGenerator::createTriangleWave(
-        tableSize, 1, referenceFreq, (float)currentSampleRate);
+    return wavetables[index];
 }
 
 void SynthAudioSource::regenerateWavetables()
 {
-    const unsigned int tableSize = 2048;
-    float referenceFreq = 261.63f; // Middle C
+    ARMONIO_TRACE_SCOPE("regenerateWavetables");
 
-    // Regenerate with current harmonic count and band-limiting
-    sineWavetable = WaveformGenerator::createSineWave(
-        tableSize, currentNumHarmonics, referenceFreq, (float)currentSampleRate);
-    sawWavetable = WaveformGenerator::createSawWave(
-        tableSize, currentNumHarmonics, referenceFreq, (float)currentSampleRate);
-    squareWavetable = WaveformGenerator::createSquareWave(
-        tableSize, currentNumHarmonics, referenceFreq, (float)currentSampleRate);
-    triangleWavetable = WaveformGenerator::createTriangleWave(
-        tableSize, currentNumHarmonics, referenceFreq, (float)currentSampleRate);
+    // Dropping our handles lets the bank free tables no other instance still uses;
+    // the others are fetched again the next time their waveform is selected
+    for (auto& table : wavetables)
+        table.reset();
 
     setWaveform(currentWaveform);
 }
@@ -49,32 +49,86 @@ void SynthAudioSource::regenerateWavetables()
 void SynthAudioSource::setWaveform(int waveformType)
 {
     currentWaveform = waveformType;
-    synth.clearSounds();
-
-    switch (waveformType)
-    {
-        case 0:
-            synth.addSound(new WavetableSound(sineWavetable));
-            break;
-        case 1:
-            synth.addSound(new WavetableSound(sawWavetable));
-            break;
-        case 2:
-            synth.addSound(new WavetableSound(squareWavetable));
-            break;
-        case 3:
-            synth.addSound(new WavetableSound(triangleWavetable));
-            break;
-        default:
-            synth.addSound(new WavetableSound(sineWavetable));
-            break;
+
+    const auto index = juce::jlimit(0, numWaveforms - 1, waveformType);
+
+    if (oscillatorEngine == additiveEngine)
+    {
+        // The sound still carries a table, the compile-time fundamental, but additive
+        // voices never read it
+        updateAdditiveSpectrum();
+        fundamentalWavetable = nullptr;
+
+        synth.setSound(new WavetableSound(wavetableBank->getTable(index, 1, wavetableSize, currentSampleRate),
+                                          nullptr, PolyBlep::none, 1, true));
+        return;
+    }
+
+    // The bare fundamental that harmonics morph modulation fades towards; with only
+    // one harmonic the main table already is that
+    fundamentalWavetable = currentNumHarmonics > 1
+                               ? wavetableBank->getTable(index, 1, wavetableSize, currentSampleRate)
+                               : nullptr;
+
+    // Analytic notes still fall back to the table below the pitch where its
+    // harmonics fill the band, so the table is built either way. Saw, square and
+    // triangle follow the same order in PolyBlep::Shape.
+    if (oscillatorEngine == analyticEngine && index != 0 && fundamentalWavetable != nullptr)
+        synth.setSound(new WavetableSound(getWavetable(waveformType), fundamentalWavetable, index - 1, currentNumHarmonics));
+    else
+        synth.setSound(new WavetableSound(getWavetable(waveformType), fundamentalWavetable));
+}
+
+void SynthAudioSource::setOscillatorEngine(int engine)
+{
+    oscillatorEngine = juce::jlimit((int)wavetableEngine, (int)additiveEngine, engine);
+    regenerateWavetables();
+}
+
+void SynthAudioSource::updateAdditiveSpectrum()
+{
+    const auto spectrum = Additive::createSpectrum(juce::jlimit(0, numWaveforms - 1, currentWaveform), currentNumHarmonics);
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->setAdditiveSpectrum(spectrum);
+        }
     }
 }
 
 void SynthAudioSource::setNumHarmonics(int numHarmonics)
 {
     currentNumHarmonics = juce::jlimit(1, 16, numHarmonics);
-    regenerateWavetables();
+
+    // Additive notes, playing ones included, just take the new partials
+    if (oscillatorEngine == additiveEngine)
+        updateAdditiveSpectrum();
+    else
+        regenerateWavetables();
+}
+
+void SynthAudioSource::setOscillator(int engine, int waveformType, int numHarmonics)
+{
+    engine = juce::jlimit((int)wavetableEngine, (int)additiveEngine, engine);
+    numHarmonics = juce::jlimit(1, 16, numHarmonics);
+
+    if (engine != oscillatorEngine)
+    {
+        currentWaveform = waveformType;
+        currentNumHarmonics = numHarmonics;
+        setOscillatorEngine(engine);
+    }
+    else if (numHarmonics != currentNumHarmonics)
+    {
+        currentWaveform = waveformType;
+        setNumHarmonics(numHarmonics);
+    }
+    else if (waveformType != currentWaveform)
+    {
+        setWaveform(waveformType);
+    }
 }
 
 void SynthAudioSource::setNumSubharmonics(int numSubharmonics)
@@ -90,6 +144,28 @@ void SynthAudioSource::setNumSubharmonics(int numSubharmonics)
     }
 }
 
+void SynthAudioSource::setUnison(int numVoices, float detuneCents, float spread)
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->setUnison(numVoices, detuneCents, spread);
+        }
+    }
+}
+
+void SynthAudioSource::setRandomSeed(int seed, bool deterministic)
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->setRandomSeed((juce::uint64)seed, i, deterministic);
+        }
+    }
+}
+
 void SynthAudioSource::setADSRParameters(float attack, float decay, float sustain, float release)
 {
     juce::ADSR::Parameters params;
@@ -107,17 +183,158 @@ void SynthAudioSource::setADSRParameters(float attack, float decay, float sustai
     }
 }
 
+void SynthAudioSource::setFilterParameters(int mode, float cutoffHz, float resonance,
+                                           float envelopeAmount, float keyTracking) noexcept
+{
+    synth.setFilterMode(mode);
+    synth.setFilterResonance(resonance);
+    synth.forEachVoice([&](WavetableVoice& voice) { voice.setFilterParameters(cutoffHz, envelopeAmount, keyTracking); });
+}
+
+void SynthAudioSource::setFilterEnvelopeParameters(float attack, float decay, float sustain, float release) noexcept
+{
+    juce::ADSR::Parameters params;
+    params.attack = attack;
+    params.decay = decay;
+    params.sustain = sustain;
+    params.release = release;
+
+    synth.forEachVoice([&params](WavetableVoice& voice) { voice.setFilterEnvelopeParameters(params); });
+}
+
+void SynthAudioSource::setModulationSettings(const Modulation::Settings& settings) noexcept
+{
+    synth.forEachVoice([&settings](WavetableVoice& voice) { voice.setModulationSettings(settings); });
+}
+
+void SynthAudioSource::setReverbParameters(float sendLevel, float sizeSeconds, bool shareWithOtherInstances)
+{
+    effectsBus.setReverbSend(sendLevel);
+    effectsBus.setReverbSize(sizeSeconds);
+    effectsBus.setSharedReverb(shareWithOtherInstances);
+}
+
+void SynthAudioSource::setNumOfflineRenderThreads(int numThreads)
+{
+    renderPool->setNumWorkersFor(this, numThreads);
+    synth.setRenderPool(numThreads > 0 ? &renderPool->getPool() : nullptr);
+}
+
+void SynthAudioSource::setNonRealtime(bool isNonRealtime) noexcept
+{
+    if (isNonRealtime == nonRealtime)
+        return;
+
+    nonRealtime = isNonRealtime;
+    synth.setNonRealtime(isNonRealtime);
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->setHighQualityInterpolation(isNonRealtime);
+        }
+    }
+}
+
+void SynthAudioSource::setQualityStage(int stage) noexcept
+{
+    if (stage == qualityStage)
+        return;
+
+    qualityStage = stage;
+    synth.setVoiceLimit(stage >= QualityGovernor::fewerVoices ? QualityGovernor::reducedVoiceLimit
+                                                              : synth.getNumVoices());
+
+    const auto thinning = stage >= QualityGovernor::noSubharmonics    ? WavetableVoice::dropSubharmonics
+                        : stage >= QualityGovernor::thinQuietVoices   ? WavetableVoice::thinQuietSubharmonics
+                                                                      : WavetableVoice::keepSubharmonics;
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->setSubharmonicThinning(thinning);
+        }
+    }
+}
+
 void SynthAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    currentSampleRate = sampleRate;
+    ARMONIO_TRACE_SCOPE("SynthAudioSource::prepareToPlay");
+
     synth.setCurrentPlaybackSampleRate(sampleRate);
+    effectsBus.prepare(sampleRate, juce::jmax(samplesPerBlockExpected, internalBlockSize));
 
-    // Regenerate wavetables with correct sample rate for band-limiting
-    regenerateWavetables();
+    // The worst case planned for is a host event on every sample of the largest
+    // block plus the capped on-screen events; renderBlock() drops on-screen events
+    // rather than let the buffer grow past that
+    mergedMidiCapacity = (juce::jmax(samplesPerBlockExpected, offlineBlockSize) + maxKeyboardEventsPerBlock)
+                           * bytesPerShortMidiEvent;
+    mergedMidi.ensureSize((size_t)mergedMidiCapacity);
+
+    // Start from silence so that identical input renders identically
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<WavetableVoice*>(synth.getVoice(i)))
+        {
+            voice->resetVoice();
+        }
+    }
+
+    // Only harmonic-rich tables are band-limited against the sample rate, so a
+    // host that prepares at the rate we already built for costs nothing here
+    if (sampleRate != currentSampleRate)
+    {
+        currentSampleRate = sampleRate;
+
+        if (currentNumHarmonics > 1)
+            regenerateWavetables();
+    }
+}
+
+void SynthAudioSource::handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity)
+{
+    if (! isApplyingHostNotes)
+        keyboardEvents.push(juce::MidiMessage::noteOn(midiChannel, midiNoteNumber, velocity),
+                            juce::Time::getMillisecondCounterHiRes());
+}
+
+void SynthAudioSource::handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity)
+{
+    if (! isApplyingHostNotes)
+        keyboardEvents.push(juce::MidiMessage::noteOff(midiChannel, midiNoteNumber, velocity),
+                            juce::Time::getMillisecondCounterHiRes());
+}
+
+void SynthAudioSource::setKeyboardDisplayActive(bool shouldBeActive)
+{
+    keyboardDisplayActive.store(shouldBeActive, std::memory_order_release);
+
+    // Whatever queued up while nobody was watching is stale
+    hostNoteEvents.clear();
+
+    if (! shouldBeActive)
+    {
+        // Clears the lit keys without telling the listeners, so nothing reaches the synth
+        const juce::ScopedValueSetter<bool> applying(isApplyingHostNotes, true);
+        keyboardState.reset();
+    }
+}
+
+void SynthAudioSource::updateKeyboardDisplay()
+{
+    const juce::ScopedValueSetter<bool> applying(isApplyingHostNotes, true);
+
+    hostNoteEvents.popAll([this](const KeyboardEventQueue::Event& event)
+    {
+        keyboardState.processNextMidiEvent(juce::MidiMessage(event.data, juce::MidiMessage::getMessageLengthFromFirstByte(event.data[0])));
+    });
 }
 
 void SynthAudioSource::releaseResources()
 {
+    setNumOfflineRenderThreads(0);
 }
 
 void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
@@ -129,17 +346,74 @@ void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& buf
 void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill,
                                         juce::MidiBuffer& midiMessages)
 {
-    bufferToFill.clearActiveBufferRegion();
+    renderBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, midiMessages);
+}
+
+void SynthAudioSource::getNextAudioBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    renderBlock(buffer, 0, buffer.getNumSamples(), midiMessages);
+}
+
+template <typename SampleType>
+void SynthAudioSource::renderBlock(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                                   juce::MidiBuffer& midiMessages)
+{
+    buffer.clear(startSample, numSamples);
 
-    keyboardState.processNextMidiBuffer(
-        midiMessages,
-        bufferToFill.startSample,
-        bufferToFill.numSamples,
-        true);
+    auto* midiToRender = &midiMessages;
 
-    synth.renderNextBlock(
-        *bufferToFill.buffer,
-        midiMessages,
-        bufferToFill.startSample,
-        bufferToFill.numSamples);
-}
\ No newline at end of file
+    {
+        ARMONIO_TRACE_SCOPE("mergeKeyboardEvents");
+
+        // Mirror host notes onto the on-screen keyboard
+        if (keyboardDisplayActive.load(std::memory_order_acquire))
+        {
+            for (const auto metadata : midiMessages)
+            {
+                const auto status = metadata.data[0];
+                const auto isNote = (status & 0xe0) == 0x80;
+                const auto isAllNotesOff = (status & 0xf0) == 0xb0 && metadata.numBytes == 3 && metadata.data[1] == 123;
+
+                if (isNote || isAllNotesOff)
+                    hostNoteEvents.push(metadata.data, metadata.numBytes, 0.0);
+            }
+        }
+
+        // The host's buffer may not have room to spare, so on-screen notes are
+        // merged into our own preallocated one. They get only the room the host's
+        // events leave in it, and any that don't fit wait for the next block.
+        const auto maxKeyboardEvents = juce::jlimit(0, maxKeyboardEventsPerBlock,
+                                                    (mergedMidiCapacity - midiMessages.data.size()) / bytesPerShortMidiEvent);
+        mergedMidi.clear();
+
+        if (keyboardEvents.mergeInto(mergedMidi, startSample, numSamples,
+                                     juce::Time::getMillisecondCounterHiRes(), maxKeyboardEvents) > 0)
+        {
+            mergedMidi.addEvents(midiMessages, startSample, numSamples, 0);
+            midiToRender = &mergedMidi;
+        }
+    }
+
+    // Nothing is sounding and nothing new arrived: leave the block cleared and skip
+    // every voice, so idle instances cost next to nothing
+    const auto synthIsSilent = midiToRender->isEmpty() && ! hasActiveVoices();
+
+    if (! synthIsSilent)
+        renderSynth(buffer, startSample, numSamples, *midiToRender);
+
+    // The reverb still rings out, or returns other instances' sends, while the synth is idle
+    const auto addedEffects = effectsBus.process(buffer, startSample, numSamples, synthIsSilent);
+
+    outputSilent.store(synthIsSilent && ! addedEffects, std::memory_order_relaxed);
+}
+
+template <typename SampleType>
+void SynthAudioSource::renderSynth(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                                   const juce::MidiBuffer& midiToRender)
+{
+    // The synth works through large host blocks in cache-sized pieces itself, and
+    // handles each event at its own sample without splitting the voices up
+    ARMONIO_TRACE_SCOPE("synth.renderNextBlockScheduled");
+
+    synth.renderNextBlockScheduled(buffer, midiToRender, startSample, numSamples);
+}
@@ -3,12 +3,31 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
 #include "WavetableSound.h"
-#include "WaveformGenerator.h"
+#include "ArmonioSynthesiser.h"
+#include "WavetableBank.h"
+#include "TraceRecorder.h"
+#include "KeyboardEventQueue.h"
+#include "EffectsBus.h"
+#include "QualityGovernor.h"
 
-class SynthAudioSource : public juce::AudioSource
+class SynthAudioSource : public juce::AudioSource,
+                         private juce::MidiKeyboardState::Listener
 {
 public:
+    static constexpr unsigned int wavetableSize = 2048;
+    static constexpr float referenceFrequency = WavetableBank::referenceFrequency;
+
+    // Host blocks are rendered in pieces of at most this many samples
+    static constexpr int internalBlockSize = ArmonioSynthesiser::realtimeBlockSize;
+
+    // Offline renders trade cache footprint for fewer, larger pieces
+    static constexpr int offlineBlockSize = VoiceFilterBank::maxBlockSize;
+
+    // On-screen notes merged into one block at most; any more are dropped
+    static constexpr int maxKeyboardEventsPerBlock = 256;
+
     explicit SynthAudioSource(juce::MidiKeyboardState& keyState);
+    ~SynthAudioSource() override;
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void releaseResources() override;
@@ -16,25 +35,128 @@ public:
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill,
                           juce::MidiBuffer& midiMessages);
 
+    // For hosts that process in double precision: the same engine, summed straight
+    // into the double bus
+    void getNextAudioBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages);
+
+    // Message thread: the waveform, engine and harmonics may fetch tables from the
+    // bank, which locks and can build them, before swapping the new sound in
     void setWaveform(int waveformType);
+
+    enum OscillatorEngine
+    {
+        wavetableEngine,
+        analyticEngine,
+        additiveEngine
+    };
+
+    // The analytic engine plays saw, square and triangle as polyBLEP waveforms, which
+    // carry every harmonic below Nyquist. To keep Harmonics a partial count it only
+    // does so for notes high enough that the table's harmonics fill that band too;
+    // lower notes, and single-harmonic patches, read the same table as the wavetable
+    // engine. It saves table reads in the upper register, not table memory.
+    // The additive engine renders each note's partials directly, so changing the
+    // harmonics reshapes playing notes without building a table, and partials are
+    // dropped above Nyquist per note. It plays one centred copy, without unison.
+    void setOscillatorEngine(int engine);
+
+    // Message thread: applies all three at once, rebuilding only for what changed
+    void setOscillator(int engine, int waveformType, int numHarmonics);
+    static juce::StringArray getOscillatorEngineNames() { return { "Wavetable", "Analytic", "Additive" }; }
+
     void setADSRParameters(float attack, float decay, float sustain, float release);
+
+    // One thread at a time, e.g. the audio thread between blocks, for all three:
+    // voices adopt the settings at their next control interval
+    void setFilterParameters(int mode, float cutoffHz, float resonance, float envelopeAmount, float keyTracking) noexcept;
+    void setFilterEnvelopeParameters(float attack, float decay, float sustain, float release) noexcept;
+    void setModulationSettings(const Modulation::Settings& settings) noexcept;
+
     void setNumHarmonics(int numHarmonics);
     void setNumSubharmonics(int numSubharmonics);
+    void setUnison(int numVoices, float detuneCents, float spread);
+    void setRandomSeed(int seed, bool deterministic);
+
+    // Post-mix reverb; the impulse response is loaded and prepared in the background.
+    // Any thread, but off the message thread the size and sharing wait for
+    // applyReverbSettings().
+    void setReverbParameters(float sendLevel, float sizeSeconds, bool shareWithOtherInstances);
+    void applyReverbSettings() { effectsBus.applySettings(); }
+    void loadReverbImpulseResponse(const juce::File& file) { effectsBus.loadImpulseResponse(file); }
+    double getReverbTailLengthSeconds() const noexcept     { return effectsBus.getTailLengthSeconds(); }
+    bool isReverbReady() const                            { return effectsBus.isReverbReady(); }
+
+    // Audio thread; takes no lock
+    bool hasActiveVoices() const noexcept { return synth.isAnyVoiceActive(); }
+
+    // Message thread, with processing stopped: asks for the threads that offline renders
+    // spread voices across, or withdraws the request with 0. Every instance in the
+    // process shares one set, as many as the most any of them asked for.
+    void setNumOfflineRenderThreads(int numThreads);
+
+    // Audio thread, before each block: offline blocks are rendered in larger pieces,
+    // with cubic interpolation and, if threads were started, voices in parallel.
+    // Voices carry on where they were, so switching mid-note does not click.
+    void setNonRealtime(bool isNonRealtime) noexcept;
+
+    // Audio thread, before each block: a QualityGovernor::Stage. Subharmonics fade
+    // out rather than stop, and a lower voice cap only affects new notes.
+    void setQualityStage(int stage) noexcept;
+
+    // Message thread: shows host notes on the on-screen keyboard while an editor is open
+    void setKeyboardDisplayActive(bool shouldBeActive);
+    void updateKeyboardDisplay();
+
+    // Any thread: true if the last block was skipped because no voice or reverb tail was sounding
+    bool isOutputSilent() const noexcept { return outputSilent.load(std::memory_order_relaxed); }
 
 private:
     juce::MidiKeyboardState& keyboardState;
-    juce::Synthesiser synth;
+    ArmonioSynthesiser synth;
+
+    // The audio thread never touches keyboardState, whose lock the GUI also takes:
+    // on-screen notes come in through one queue and host notes go out through another
+    KeyboardEventQueue keyboardEvents;
+    KeyboardEventQueue hostNoteEvents;
+    juce::MidiBuffer mergedMidi;
+    int mergedMidiCapacity = 0;
 
-    juce::AudioSampleBuffer sineWavetable;
-    juce::AudioSampleBuffer sawWavetable;
-    juce::AudioSampleBuffer squareWavetable;
-    juce::AudioSampleBuffer triangleWavetable;
+    // A MidiBuffer stores a short message in 9 bytes: a 4-byte position, a 2-byte
+    // size and up to three data bytes
+    static constexpr int bytesPerShortMidiEvent = (int)(sizeof(juce::int32) + sizeof(juce::uint16)) + 3;
+    std::atomic<bool> keyboardDisplayActive { false };
+    bool isApplyingHostNotes = false;
+
+    EffectsBus effectsBus;
+
+    juce::SharedResourcePointer<SharedRenderPool> renderPool;
+    bool nonRealtime = false;
+    int qualityStage = QualityGovernor::fullQuality;
+
+    void handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+    void handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+
+    static constexpr int numWaveforms = 4;
+
+    // Tables come from the process-wide bank, shared with every other instance.
+    // Indexed by waveform (0=Sine, 1=Saw, 2=Square, 3=Triangle) and fetched on first use.
+    juce::SharedResourcePointer<WavetableBank> wavetableBank;
+    std::array<WavetableBank::TablePtr, numWaveforms> wavetables;
+    WavetableBank::TablePtr fundamentalWavetable;
 
     int currentWaveform = 0;
+    int oscillatorEngine = wavetableEngine;
     int currentNumHarmonics = 1;
     int currentNumSubharmonics = 0;
     double currentSampleRate = 44100.0;
+    std::atomic<bool> outputSilent { true };
+
+    const WavetableBank::TablePtr& getWavetable(int waveformType);
+    template <typename SampleType>
+    void renderBlock(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, juce::MidiBuffer& midiMessages);
 
-    void initializeWavetables();
+    template <typename SampleType>
+    void renderSynth(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples, const juce::MidiBuffer& midiToRender);
     void regenerateWavetables();
+    void updateAdditiveSpectrum();
 };
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "TraceRecorder.h"
+
+#if ARMONIO_ENABLE_TRACING
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    struct ThreadBuffer
+    {
+        std::atomic<const char*> threadName { nullptr };
+        std::atomic<juce::uint32> writeIndex { 0 };
+        TraceEvent events[TraceRecorder::eventsPerThread];
+    };
+
+    static_assert(juce::isPowerOfTwo(TraceRecorder::eventsPerThread),
+                  "eventsPerThread must be a power of two");
+
+    // Static storage so that no thread ever allocates when it starts recording
+    ThreadBuffer threadBuffers[TraceRecorder::maxThreads];
+    std::atomic<int> numClaimedBuffers { 0 };
+
+    thread_local ThreadBuffer* currentThreadBuffer = nullptr;
+    thread_local bool hasClaimedBuffer = false;
+
+    ThreadBuffer* getBufferForCurrentThread() noexcept
+    {
+        if (! hasClaimedBuffer)
+        {
+            hasClaimedBuffer = true;
+            auto slot = numClaimedBuffers.fetch_add(1);
+
+            // Threads beyond the limit are simply not traced
+            currentThreadBuffer = slot < TraceRecorder::maxThreads ? &threadBuffers[slot] : nullptr;
+        }
+
+        return currentThreadBuffer;
+    }
+}
+
+//==============================================================================
+void TraceRecorder::record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    if (auto* buffer = getBufferForCurrentThread())
+    {
+        auto index = buffer->writeIndex.load(std::memory_order_relaxed);
+        buffer->events[index & (juce::uint32)(eventsPerThread - 1)] = { name, startTicks, endTicks };
+        buffer->writeIndex.store(index + 1, std::memory_order_release);
+    }
+}
+
+void TraceRecorder::setCurrentThreadName(const char* name) noexcept
+{
+    if (auto* buffer = getBufferForCurrentThread())
+        buffer->threadName.store(name, std::memory_order_relaxed);
+}
+
+void TraceRecorder::clear() noexcept
+{
+    for (auto& buffer : threadBuffers)
+        buffer.writeIndex.store(0, std::memory_order_release);
+}
+
+bool TraceRecorder::writeChromeTrace(const juce::File& file)
+{
+    const auto numBuffers = juce::jmin(numClaimedBuffers.load(), maxThreads);
+    const auto ticksPerMicrosecond = (double)juce::Time::getHighResolutionTicksPerSecond() / 1.0e6;
+
+    // Events still being written while we read may be torn, so only the
+    // completed ones up to the published write index are exported
+    auto origin = std::numeric_limits<juce::int64>::max();
+
+    for (int i = 0; i < numBuffers; ++i)
+    {
+        auto& buffer = threadBuffers[i];
+        auto end = buffer.writeIndex.load(std::memory_order_acquire);
+        auto count = juce::jmin(end, (juce::uint32)eventsPerThread);
+
+        for (auto n = end - count; n != end; ++n)
+            origin = juce::jmin(origin, buffer.events[n & (juce::uint32)(eventsPerThread - 1)].startTicks);
+    }
+
+    juce::MemoryOutputStream json;
+    json << "{\"traceEvents\":[\n";
+
+    bool isFirst = true;
+    auto separator = [&isFirst]() -> const char*
+    {
+        if (isFirst)
+        {
+            isFirst = false;
+            return "";
+        }
+
+        return ",\n";
+    };
+
+    for (int i = 0; i < numBuffers; ++i)
+    {
+        auto& buffer = threadBuffers[i];
+        const auto tid = i + 1;
+
+        juce::String threadName(buffer.threadName.load(std::memory_order_relaxed));
+        if (threadName.isEmpty())
+            threadName = "Thread " + juce::String(tid);
+
+        json << separator()
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+             << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+
+        auto end = buffer.writeIndex.load(std::memory_order_acquire);
+        auto count = juce::jmin(end, (juce::uint32)eventsPerThread);
+
+        for (auto n = end - count; n != end; ++n)
+        {
+            const auto& event = buffer.events[n & (juce::uint32)(eventsPerThread - 1)];
+
+            if (event.name == nullptr)
+                continue;
+
+            auto startMicros = (double)(event.startTicks - origin) / ticksPerMicrosecond;
+            auto durationMicros = (double)(event.endTicks - event.startTicks) / ticksPerMicrosecond;
+
+            json << separator()
+                 << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                 << ",\"ts\":" << juce::String(startMicros, 3)
+                 << ",\"dur\":" << juce::String(durationMicros, 3) << "}";
+        }
+    }
+
+    json << "\n]}\n";
+
+    return file.replaceWithData(json.getData(), json.getDataSize());
+}
+
+#endif
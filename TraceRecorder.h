@@ -0,0 +1,63 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#ifndef ARMONIO_ENABLE_TRACING
+ #define ARMONIO_ENABLE_TRACING 0
+#endif
+
+#if ARMONIO_ENABLE_TRACING
+
+//==============================================================================
+// Records scoped timing spans into preallocated per-thread ring buffers and
+// writes them out as a Chrome / Perfetto JSON trace.
+//
+// Recording never allocates or locks: each thread claims one of a fixed set of
+// statically allocated buffers the first time it records, and older events are
+// overwritten once a buffer is full.
+class TraceRecorder
+{
+public:
+    static constexpr int maxThreads = 32;
+    static constexpr int eventsPerThread = 8192;
+
+    static void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    // Labels the calling thread in the exported trace. The string must outlive the recorder.
+    static void setCurrentThreadName(const char* name) noexcept;
+
+    static bool writeChromeTrace(const juce::File& file);
+    static void clear() noexcept;
+};
+
+//==============================================================================
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace(const char* spanName) noexcept
+        : name(spanName),
+          startTicks(juce::Time::getHighResolutionTicks())
+    {
+    }
+
+    ~ScopedTrace() noexcept
+    {
+        TraceRecorder::record(name, startTicks, juce::Time::getHighResolutionTicks());
+    }
+
+private:
+    const char* name;
+    juce::int64 startTicks;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedTrace)
+};
+
+ #define ARMONIO_TRACE_SCOPE(name)        const ScopedTrace JUCE_JOIN_MACRO(armonioTrace_, __LINE__)(name)
+ #define ARMONIO_TRACE_THREAD_NAME(name)  TraceRecorder::setCurrentThreadName(name)
+
+#else
+
+ #define ARMONIO_TRACE_SCOPE(name)
+ #define ARMONIO_TRACE_THREAD_NAME(name)
+
+#endif
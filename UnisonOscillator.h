@@ -0,0 +1,382 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <atomic>
+#include "FastRandom.h"
+#include "PolyBlepOscillator.h"
+
+//==============================================================================
+// A stack of detuned copies of one wavetable, rendered together.
+//
+// Each unison voice is one lane of a vector of phases. The table lookups share a
+// single read path, and the interpolation, stereo mix and phase advance run on
+// whole SIMD registers, so a 7-voice stack costs far less than 7 separate
+// WavetableOscillators.
+//
+// With an analytic shape set, the lanes compute a polyBLEP saw, square or triangle
+// from their phases instead, so the stack reads no table at all unless it morphs.
+class UnisonOscillator
+{
+public:
+    static constexpr int maxVoices = 16;
+
+    void setWavetable(const juce::AudioSampleBuffer& wavetableToUse)
+    {
+        jassert(wavetableToUse.getNumChannels() == 1);
+
+        wavetable = &wavetableToUse;
+        tableSize = wavetable->getNumSamples() - 1;
+        morphTable = nullptr;
+    }
+
+    // A table of the same size that renderModulated() can crossfade towards
+    void setMorphTable(const juce::AudioSampleBuffer& tableToMorphTo)
+    {
+        jassert(tableToMorphTo.getNumSamples() == tableSize + 1);
+
+        morphTable = &tableToMorphTo;
+    }
+
+    // Sets the number of stacked voices; takes effect together with the next setFrequency()
+    void setNumVoices(int newNumVoices)
+    {
+        numVoices = juce::jlimit(1, maxVoices, newNumVoices);
+        numRegisters = (numVoices + (int)Register::SIMDNumElements - 1) / (int)Register::SIMDNumElements;
+    }
+
+    void setFrequency(float frequency, float sampleRate)
+    {
+        baseFrequency = frequency;
+        currentSampleRate = sampleRate;
+        updateLanes();
+    }
+
+    // Any thread, also while a note is playing: the lanes pick the new values up at
+    // the start of the next render call, on the audio thread, and phases are left untouched
+    void setDetuneAndSpread(float newDetuneCents, float newSpread) noexcept
+    {
+        targetDetuneCents.store(newDetuneCents, std::memory_order_relaxed);
+        targetSpread.store(juce::jlimit(0.0f, 1.0f, newSpread), std::memory_order_relaxed);
+    }
+
+    // Four-point Hermite interpolation instead of linear, e.g. for offline renders.
+    // Both read the same table at the same phases, so switching mid-note is seamless.
+    void setHighQualityInterpolation(bool shouldUseHighQuality) noexcept
+    {
+        isHighQuality = shouldUseHighQuality;
+    }
+
+    // One of PolyBlep::Shape, or PolyBlep::none to read the wavetable, with a gain
+    // that matches the shape's level to the table's. Phases keep running in table
+    // units either way, so the shape can change mid-note.
+    void setAnalyticShape(int newShape, float gain = 1.0f) noexcept
+    {
+        analyticShape = newShape;
+        analyticGain = gain;
+    }
+
+    void setRandomPhase(FastRandom& random)
+    {
+        for (int i = 0; i < numVoices; ++i)
+            phases[(size_t)i] = random.nextFloat() * (float)tableSize;
+    }
+
+    void reset()
+    {
+        std::fill(phases.begin(), phases.end(), 0.0f);
+    }
+
+    // Overwrites numSamples of left and right with the summed stack
+    void render(float* left, float* right, int numSamples) noexcept
+    {
+        updateLanesIfMoved();
+
+        if (analyticShape != PolyBlep::none)
+            renderAnalyticShape<false>(left, right, numSamples, 1.0f, 0.0f, 0.0f, 0.0f);
+        else if (isHighQuality)
+            renderStack<false, true>(left, right, numSamples, 1.0f, 0.0f, 0.0f, 0.0f);
+        else
+            renderStack<false, false>(left, right, numSamples, 1.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    // As render(), with the pitch scaled by a ratio and the output crossfaded towards
+    // the morph table, both ramping linearly from their start to their end values
+    void renderModulated(float* left, float* right, int numSamples,
+                         float pitchRatioStart, float pitchRatioEnd,
+                         float morphStart, float morphEnd) noexcept
+    {
+        updateLanesIfMoved();
+
+        const auto pitchStep = (pitchRatioEnd - pitchRatioStart) / (float)numSamples;
+
+        const auto morphStep = (morphEnd - morphStart) / (float)numSamples;
+
+        if (morphTable == nullptr || (morphStart <= 0.0f && morphEnd <= 0.0f))
+        {
+            if (analyticShape != PolyBlep::none)
+                renderAnalyticShape<false>(left, right, numSamples, pitchRatioStart, pitchStep, 0.0f, 0.0f);
+            else if (isHighQuality)
+                renderStack<false, true>(left, right, numSamples, pitchRatioStart, pitchStep, 0.0f, 0.0f);
+            else
+                renderStack<false, false>(left, right, numSamples, pitchRatioStart, pitchStep, 0.0f, 0.0f);
+        }
+        else
+        {
+            if (analyticShape != PolyBlep::none)
+                renderAnalyticShape<true>(left, right, numSamples, pitchRatioStart, pitchStep, morphStart, morphStep);
+            else if (isHighQuality)
+                renderStack<true, true>(left, right, numSamples, pitchRatioStart, pitchStep, morphStart, morphStep);
+            else
+                renderStack<true, false>(left, right, numSamples, pitchRatioStart, pitchStep, morphStart, morphStep);
+        }
+    }
+
+private:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr size_t numLanes = ((size_t)maxVoices + Register::SIMDNumElements - 1)
+                                     / Register::SIMDNumElements * Register::SIMDNumElements;
+
+    using LaneArray = std::array<float, numLanes>;
+
+    const juce::AudioSampleBuffer* wavetable = nullptr;
+    const juce::AudioSampleBuffer* morphTable = nullptr;
+    int tableSize = 0;
+
+    int numVoices = 1;
+    int numRegisters = 1;
+    float baseFrequency = 0.0f;
+    float currentSampleRate = 44100.0f;
+
+    // Written from any thread; detuneCents and spread are what the lanes were built from
+    std::atomic<float> targetDetuneCents { 0.0f };
+    std::atomic<float> targetSpread { 0.0f };
+    float detuneCents = 0.0f;
+    float spread = 0.0f;
+    bool isHighQuality = false;
+    int analyticShape = PolyBlep::none;
+    float analyticGain = 1.0f;
+
+    alignas(Register::SIMDRegisterSize) LaneArray phases {};
+    alignas(Register::SIMDRegisterSize) LaneArray deltas {};
+    alignas(Register::SIMDRegisterSize) LaneArray leftGains {};
+    alignas(Register::SIMDRegisterSize) LaneArray rightGains {};
+
+    // Per-sample scratch for the gather
+    alignas(Register::SIMDRegisterSize) LaneArray fractions {};
+    alignas(Register::SIMDRegisterSize) LaneArray values0 {};
+    alignas(Register::SIMDRegisterSize) LaneArray differences {};
+
+    // The Hermite polynomial's higher coefficients; differences holds its slope
+    alignas(Register::SIMDRegisterSize) LaneArray curvatures {};
+    alignas(Register::SIMDRegisterSize) LaneArray cubics {};
+
+    template <bool isMorphing, bool isCubic>
+    void renderStack(float* left, float* right, int numSamples,
+                     float pitchRatio, float pitchStep, float morph, float morphStep) noexcept
+    {
+        const auto* table = wavetable->getReadPointer(0);
+        const auto* targetTable = isMorphing ? morphTable->getReadPointer(0) : nullptr;
+        const auto size = Register::expand((float)tableSize);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            // The shared gather: one lookup per lane into the same table
+            for (size_t lane = 0; lane < (size_t)(numRegisters * (int)Register::SIMDNumElements); ++lane)
+            {
+                auto index0 = (unsigned int)phases[lane];
+                fractions[lane] = phases[lane] - (float)index0;
+
+                if constexpr (isCubic)
+                {
+                    // The guard point covers index0 + 1; the outer two points wrap around
+                    const auto indexBefore = index0 == 0 ? (unsigned int)tableSize - 1 : index0 - 1;
+                    const auto indexAfter = index0 + 2 > (unsigned int)tableSize ? index0 + 2 - (unsigned int)tableSize : index0 + 2;
+
+                    auto y0 = table[indexBefore], y1 = table[index0], y2 = table[index0 + 1], y3 = table[indexAfter];
+
+                    if constexpr (isMorphing)
+                    {
+                        y0 += morph * (targetTable[indexBefore] - y0);
+                        y1 += morph * (targetTable[index0] - y1);
+                        y2 += morph * (targetTable[index0 + 1] - y2);
+                        y3 += morph * (targetTable[indexAfter] - y3);
+                    }
+
+                    values0[lane] = y1;
+                    differences[lane] = 0.5f * (y2 - y0);
+                    curvatures[lane] = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+                    cubics[lane] = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+                }
+                else
+                {
+                    values0[lane] = table[index0];
+                    differences[lane] = table[index0 + 1] - table[index0];
+
+                    if constexpr (isMorphing)
+                    {
+                        // Interpolating the two tables' points gives the same result as
+                        // interpolating within each table and crossfading afterwards
+                        values0[lane] += morph * (targetTable[index0] - values0[lane]);
+                        differences[lane] += morph * (targetTable[index0 + 1] - targetTable[index0] - differences[lane]);
+                    }
+                }
+            }
+
+            auto sumLeft = Register::expand(0.0f);
+            auto sumRight = Register::expand(0.0f);
+            const auto ratio = Register::expand(pitchRatio);
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                const auto offset = (size_t)(r * (int)Register::SIMDNumElements);
+
+                const auto fraction = Register::fromRawArray(fractions.data() + offset);
+                auto slope = Register::fromRawArray(differences.data() + offset);
+
+                if constexpr (isCubic)
+                    slope += fraction * (Register::fromRawArray(curvatures.data() + offset)
+                                         + fraction * Register::fromRawArray(cubics.data() + offset));
+
+                auto value = Register::fromRawArray(values0.data() + offset) + fraction * slope;
+
+                sumLeft += value * Register::fromRawArray(leftGains.data() + offset);
+                sumRight += value * Register::fromRawArray(rightGains.data() + offset);
+
+                // Advance and wrap; a large upward pitch ratio can overshoot by more
+                // than one table length, so wrap twice
+                auto phase = Register::fromRawArray(phases.data() + offset) + Register::fromRawArray(deltas.data() + offset) * ratio;
+                phase -= size & Register::greaterThanOrEqual(phase, size);
+                phase -= size & Register::greaterThanOrEqual(phase, size);
+                phase.copyToRawArray(phases.data() + offset);
+            }
+
+            left[n] = sumLeft.sum();
+            right[n] = sumRight.sum();
+
+            pitchRatio += pitchStep;
+
+            if constexpr (isMorphing)
+                morph += morphStep;
+        }
+    }
+
+    template <bool isMorphing>
+    void renderAnalyticShape(float* left, float* right, int numSamples,
+                             float pitchRatio, float pitchStep, float morph, float morphStep) noexcept
+    {
+        switch (analyticShape)
+        {
+            case PolyBlep::saw:
+                renderAnalytic<PolyBlep::saw, isMorphing>(left, right, numSamples, pitchRatio, pitchStep, morph, morphStep);
+                break;
+            case PolyBlep::square:
+                renderAnalytic<PolyBlep::square, isMorphing>(left, right, numSamples, pitchRatio, pitchStep, morph, morphStep);
+                break;
+            default:
+                renderAnalytic<PolyBlep::triangle, isMorphing>(left, right, numSamples, pitchRatio, pitchStep, morph, morphStep);
+                break;
+        }
+    }
+
+    template <int shape, bool isMorphing>
+    void renderAnalytic(float* left, float* right, int numSamples,
+                        float pitchRatio, float pitchStep, float morph, float morphStep) noexcept
+    {
+        const auto* targetTable = isMorphing ? morphTable->getReadPointer(0) : nullptr;
+        const auto size = Register::expand((float)tableSize);
+        const auto inverseSize = 1.0f / (float)tableSize;
+        const auto numActiveLanes = (size_t)(numRegisters * (int)Register::SIMDNumElements);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            // No gather: each lane's value depends only on its own phase and increment
+            for (size_t lane = 0; lane < numActiveLanes; ++lane)
+            {
+                const auto dt = PolyBlep::clampIncrement(deltas[lane] * pitchRatio * inverseSize);
+                values0[lane] = analyticGain * PolyBlep::sample<shape>(phases[lane] * inverseSize, dt);
+            }
+
+            if constexpr (isMorphing)
+            {
+                // The morph target is still a table, read linearly at the same phases
+                for (size_t lane = 0; lane < numActiveLanes; ++lane)
+                {
+                    const auto index0 = (unsigned int)phases[lane];
+                    const auto fraction = phases[lane] - (float)index0;
+                    const auto target = targetTable[index0] + fraction * (targetTable[index0 + 1] - targetTable[index0]);
+
+                    values0[lane] += morph * (target - values0[lane]);
+                }
+
+                morph += morphStep;
+            }
+
+            auto sumLeft = Register::expand(0.0f);
+            auto sumRight = Register::expand(0.0f);
+            const auto ratio = Register::expand(pitchRatio);
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                const auto offset = (size_t)(r * (int)Register::SIMDNumElements);
+                const auto value = Register::fromRawArray(values0.data() + offset);
+
+                sumLeft += value * Register::fromRawArray(leftGains.data() + offset);
+                sumRight += value * Register::fromRawArray(rightGains.data() + offset);
+
+                auto phase = Register::fromRawArray(phases.data() + offset) + Register::fromRawArray(deltas.data() + offset) * ratio;
+                phase -= size & Register::greaterThanOrEqual(phase, size);
+                phase -= size & Register::greaterThanOrEqual(phase, size);
+                phase.copyToRawArray(phases.data() + offset);
+            }
+
+            left[n] = sumLeft.sum();
+            right[n] = sumRight.sum();
+
+            pitchRatio += pitchStep;
+        }
+    }
+
+    void updateLanesIfMoved() noexcept
+    {
+        if (targetDetuneCents.load(std::memory_order_relaxed) != detuneCents
+             || targetSpread.load(std::memory_order_relaxed) != spread)
+            updateLanes();
+    }
+
+    void updateLanes() noexcept
+    {
+        detuneCents = targetDetuneCents.load(std::memory_order_relaxed);
+        spread = targetSpread.load(std::memory_order_relaxed);
+
+        const auto tableSizeOverSampleRate = (float)tableSize / currentSampleRate;
+
+        // Keeps the overall level roughly constant as voices are added
+        const auto gain = 1.0f / std::sqrt((float)numVoices);
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            if ((int)lane >= numVoices)
+            {
+                // Padding lanes are silent and never move
+                deltas[lane] = 0.0f;
+                leftGains[lane] = 0.0f;
+                rightGains[lane] = 0.0f;
+                phases[lane] = 0.0f;
+                continue;
+            }
+
+            // Spread evenly from -1 to +1 across the stack
+            auto position = numVoices > 1 ? 2.0f * (float)lane / (float)(numVoices - 1) - 1.0f : 0.0f;
+
+            auto ratio = std::pow(2.0f, position * detuneCents / 1200.0f);
+            deltas[lane] = baseFrequency * ratio * tableSizeOverSampleRate;
+
+            // Linear balance law: a centred lane plays at full level on both sides
+            auto pan = position * spread;
+            leftGains[lane] = gain * juce::jmin(1.0f, 1.0f - pan);
+            rightGains[lane] = gain * juce::jmin(1.0f, 1.0f + pan);
+        }
+    }
+};
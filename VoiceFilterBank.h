@@ -0,0 +1,236 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <atomic>
+
+//==============================================================================
+// Per-voice zero-delay-feedback state-variable filters (Simper's trapezoidal SVF),
+// run for all voices at once.
+//
+// Voices write their stereo output into lanes interleaved by voice, so sample n of
+// every voice sits side by side in memory. Each SIMD register then holds the same
+// sample of several voices, and one pass of the filter update advances all of
+// them. Cutoffs are set per voice once per control block; groups of lanes with no
+// sounding voice are skipped.
+//
+// Mode and resonance may be set from any thread. process() picks them up at the
+// start of each control block and derives every coefficient from them there.
+class VoiceFilterBank
+{
+public:
+    static constexpr int maxVoices = 16;
+
+    // Room for offline renders' larger blocks; realtime blocks of 128 samples only
+    // touch the first 16 KB of the lanes
+    static constexpr int maxBlockSize = 1024;
+    static constexpr int controlBlockSize = 32;
+
+    // Distance between consecutive samples of one voice in a lane
+    static constexpr int laneStride = maxVoices;
+
+    enum Mode
+    {
+        lowPass = 0,
+        bandPass,
+        highPass
+    };
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& channelState : ic1eq)
+            channelState.fill(0.0f);
+
+        for (auto& channelState : ic2eq)
+            channelState.fill(0.0f);
+
+        laneActive.fill(false);
+    }
+
+    // Any thread
+    void setMode(int newMode) noexcept
+    {
+        mode.store(juce::jlimit((int)lowPass, (int)highPass, newMode), std::memory_order_relaxed);
+    }
+
+    // Any thread: 0 is a gentle Q of 0.5, 1 is close to self-oscillation
+    void setResonance(float newResonance) noexcept
+    {
+        resonance.store(juce::jlimit(0.0f, 1.0f, newResonance), std::memory_order_relaxed);
+    }
+
+    // Starts a voice's filter from rest, e.g. for a new note
+    void resetLane(int voice) noexcept
+    {
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            ic1eq[(size_t)ch][(size_t)voice] = 0.0f;
+            ic2eq[(size_t)ch][(size_t)voice] = 0.0f;
+        }
+    }
+
+    // Inactive lanes are silent and their state is cleared
+    void setLaneActive(int voice, bool isActive) noexcept
+    {
+        if (! isActive && laneActive[(size_t)voice])
+            resetLane(voice);
+
+        laneActive[(size_t)voice] = isActive;
+    }
+
+    bool isLaneActive(int voice) const noexcept { return laneActive[(size_t)voice]; }
+
+    // Sample n of a voice lives at getLaneWritePointer(channel, voice)[n * laneStride]
+    float* getLaneWritePointer(int channel, int voice) noexcept
+    {
+        return lanes[(size_t)channel].data() + voice;
+    }
+
+    void clearLanes(int numSamples) noexcept
+    {
+        for (auto& channel : lanes)
+            juce::FloatVectorOperations::clear(channel.data(), numSamples * laneStride);
+    }
+
+    // Control rate: sets the voice's cutoff for the next call to process()
+    void setCutoff(int voice, float cutoffHz) noexcept
+    {
+        const auto limited = juce::jlimit(10.0f, 0.49f * (float)sampleRate, cutoffHz);
+        g[(size_t)voice] = std::tan(juce::MathConstants<float>::pi * limited / (float)sampleRate);
+    }
+
+    // Filters one control block of the lanes in place
+    void process(int startSample, int numSamples) noexcept
+    {
+        // One snapshot of mode and resonance for the whole block
+        const auto currentMode = mode.load(std::memory_order_relaxed);
+        const auto damping = 2.0f - 1.96f * resonance.load(std::memory_order_relaxed);
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            a1[lane] = 1.0f / (1.0f + g[lane] * (g[lane] + damping));
+            a2[lane] = g[lane] * a1[lane];
+            a3[lane] = g[lane] * a2[lane];
+        }
+
+        // Mixes the three SVF outputs into the selected response
+        const auto m0 = Register::expand(currentMode == highPass ? 1.0f : 0.0f);
+        const auto m1 = Register::expand(currentMode == bandPass ? damping : (currentMode == highPass ? -damping : 0.0f));
+        const auto m2 = Register::expand(currentMode == lowPass ? 1.0f : (currentMode == highPass ? -1.0f : 0.0f));
+
+        for (size_t group = 0; group < (size_t)numGroups; ++group)
+        {
+            const auto offset = group * Register::SIMDNumElements;
+
+            if (! isGroupActive(offset))
+                continue;
+
+            const auto ga1 = Register::fromRawArray(a1.data() + offset);
+            const auto ga2 = Register::fromRawArray(a2.data() + offset);
+            const auto ga3 = Register::fromRawArray(a3.data() + offset);
+
+            for (size_t ch = 0; ch < 2; ++ch)
+            {
+                auto s1 = Register::fromRawArray(ic1eq[ch].data() + offset);
+                auto s2 = Register::fromRawArray(ic2eq[ch].data() + offset);
+
+                auto* samples = lanes[ch].data() + (size_t)startSample * laneStride + offset;
+
+                for (int n = 0; n < numSamples; ++n, samples += laneStride)
+                {
+                    const auto v0 = Register::fromRawArray(samples);
+                    const auto v3 = v0 - s2;
+                    const auto v1 = ga1 * s1 + ga2 * v3;
+                    const auto v2 = s2 + ga2 * s1 + ga3 * v3;
+
+                    s1 = v1 + v1 - s1;
+                    s2 = v2 + v2 - s2;
+
+                    (m0 * v0 + m1 * v1 + m2 * v2).copyToRawArray(samples);
+                }
+
+                s1.copyToRawArray(ic1eq[ch].data() + offset);
+                s2.copyToRawArray(ic2eq[ch].data() + offset);
+            }
+        }
+    }
+
+    // Sums every voice into the output; a mono bus gets the average of both sides.
+    // A double bus gets the same float sum, converted once per sample.
+    template <typename SampleType>
+    void addTo(juce::AudioBuffer<SampleType>& output, int outputStart, int numSamples) const noexcept
+    {
+        const auto numChannels = output.getNumChannels();
+
+        for (int ch = 0; ch < juce::jmin(2, numChannels); ++ch)
+        {
+            auto* dest = output.getWritePointer(ch, outputStart);
+
+            if (numChannels == 1)
+            {
+                for (int n = 0; n < numSamples; ++n)
+                    dest[n] += (SampleType)(0.5f * (sumLanes(0, n) + sumLanes(1, n)));
+            }
+            else
+            {
+                for (int n = 0; n < numSamples; ++n)
+                    dest[n] += (SampleType)sumLanes((size_t)ch, n);
+            }
+        }
+    }
+
+private:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int numGroups = (maxVoices + (int)Register::SIMDNumElements - 1) / (int)Register::SIMDNumElements;
+    static constexpr size_t numLanes = (size_t)numGroups * Register::SIMDNumElements;
+
+    static_assert(numLanes == (size_t)laneStride, "Lanes must tile the SIMD registers exactly");
+
+    using LaneArray = std::array<float, numLanes>;
+
+    double sampleRate = 44100.0;
+    std::atomic<int> mode { lowPass };
+    std::atomic<float> resonance { 0.3f };
+
+    alignas(Register::SIMDRegisterSize) std::array<std::array<float, (size_t)(maxBlockSize * laneStride)>, 2> lanes {};
+
+    alignas(Register::SIMDRegisterSize) std::array<LaneArray, 2> ic1eq {};
+    alignas(Register::SIMDRegisterSize) std::array<LaneArray, 2> ic2eq {};
+
+    // Per-voice tan(pi * cutoff / sampleRate), turned into a1..a3 by process()
+    LaneArray g {};
+
+    alignas(Register::SIMDRegisterSize) LaneArray a1 {};
+    alignas(Register::SIMDRegisterSize) LaneArray a2 {};
+    alignas(Register::SIMDRegisterSize) LaneArray a3 {};
+
+    std::array<bool, numLanes> laneActive {};
+
+    bool isGroupActive(size_t offset) const noexcept
+    {
+        for (size_t lane = offset; lane < offset + Register::SIMDNumElements; ++lane)
+            if (laneActive[lane])
+                return true;
+
+        return false;
+    }
+
+    float sumLanes(size_t channel, int n) const noexcept
+    {
+        const auto* samples = lanes[channel].data() + (size_t)n * laneStride;
+
+        auto sum = Register::expand(0.0f);
+
+        for (size_t group = 0; group < (size_t)numGroups; ++group)
+            sum += Register::fromRawArray(samples + group * Register::SIMDNumElements);
+
+        return sum.sum();
+    }
+};
@@ -1,183 +1,154 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
-
-class WaveformGenerator
+#include <vector>
+
+//==============================================================================
+// The unnormalised sum of a waveform's partials over one table period, kept in
+// double so that harmonics can be added and removed one at a time: moving the
+// harmonic count by one costs a single partial's pass over the table instead of
+// summing every partial again. Normalising is left to createTable(), as a gain
+// applied while the table is copied out.
+class HarmonicSeries
 {
 public:
-    static juce::AudioSampleBuffer createSineWave(unsigned int tableSize,
-                                                   int numHarmonics,
-                                                   float fundamentalFreq = 440.0f,
-                                                   float sampleRate = 44100.0f)
+    // Waveform parameter index: 0=Sine, 1=Saw, 2=Square, 3=Triangle
+    HarmonicSeries(int waveform, unsigned int size, float fundamental, float rate)
+        : waveformType(waveform),
+          tableSize(size),
+          fundamentalFreq(fundamental),
+          sampleRate(rate),
+          sums((size_t)size, 0.0)
     {
-        juce::AudioSampleBuffer sineTable;
-        sineTable.setSize(1, (int)tableSize + 1);
-        sineTable.clear();
+    }
 
-        auto* samples = sineTable.getWritePointer(0);
-        float nyquistFreq = sampleRate / 2.0f;
+    int getNumHarmonics() const noexcept { return numHarmonics; }
 
-        // Add harmonics
-        for (int harmonic = 1; harmonic <= numHarmonics; ++harmonic)
-        {
-            // Band-limiting
-            float harmonicFreq = fundamentalFreq * harmonic;
-            if (harmonicFreq >= nyquistFreq)
-                break;
+    void setNumHarmonics(int newNumHarmonics)
+    {
+        newNumHarmonics = juce::jmax(0, newNumHarmonics);
 
-            float amplitude = 1.0f / (float)harmonic;
+        while (numHarmonics < newNumHarmonics)
+            addPartial(++numHarmonics, 1.0);
 
-            auto angleDelta = (juce::MathConstants<double>::twoPi / (double)(tableSize - 1)) * harmonic;
-            auto currentAngle = 0.0;
+        while (numHarmonics > newNumHarmonics)
+            addPartial(numHarmonics--, -1.0);
+    }
 
-            for (unsigned int i = 0; i < tableSize; ++i)
-            {
-                samples[i] += (float)std::sin(currentAngle) * amplitude;
-                currentAngle += angleDelta;
-            }
-        }
+    // A peak-normalised table, with the guard sample that repeats the first
+    juce::AudioSampleBuffer createTable() const
+    {
+        juce::AudioSampleBuffer table(1, (int)tableSize + 1);
+        auto* samples = table.getWritePointer(0);
+
+        const auto range = juce::FloatVectorOperations::findMinAndMax(sums.data(), (int)tableSize);
+        const auto peak = juce::jmax(-range.getStart(), range.getEnd());
+        const auto gain = peak > 0.0 ? 1.0 / peak : 1.0;
+
+        for (unsigned int i = 0; i < tableSize; ++i)
+            samples[i] = (float)(sums[i] * gain);
 
-        normalizeWaveform(samples, tableSize);
         samples[tableSize] = samples[0];
-        return sineTable;
+        return table;
     }
 
-    static juce::AudioSampleBuffer createSawWave(unsigned int tableSize,
-                                                  int numHarmonics,
-                                                  float fundamentalFreq = 440.0f,
-                                                  float sampleRate = 44100.0f)
+private:
+    const int waveformType;
+    const unsigned int tableSize;
+    const float fundamentalFreq;
+    const float sampleRate;
+    std::vector<double> sums;
+    int numHarmonics = 0;
+
+    // Adds partial n's contribution, or removes it with a sign of -1. Partials at or
+    // above Nyquist are left out, as are all the ones after them.
+    void addPartial(int n, double sign)
     {
-        juce::AudioSampleBuffer sawTable;
-        sawTable.setSize(1, (int)tableSize + 1);
-        sawTable.clear();
+        const auto isOddOnly = waveformType == 2 || waveformType == 3;
+        const auto harmonic = isOddOnly ? 2 * n - 1 : n;
 
-        auto* samples = sawTable.getWritePointer(0);
+        if (fundamentalFreq * (float)harmonic >= sampleRate / 2.0f)
+            return;
 
-        float nyquistFreq = sampleRate / 2.0f;
+        // The saw's partials are stretched slightly, so they wrap every period but
+        // are not exact multiples within it
+        auto ratio = (double)harmonic;
+        auto amplitude = 1.0 / (double)harmonic;
 
-        // Add harmonics
-        for (int harmonic = 1; harmonic <= numHarmonics; ++harmonic)
+        switch (waveformType)
         {
-            float harmonicFreq = fundamentalFreq * harmonic;
-            if (harmonicFreq >= nyquistFreq)
+            case 1:
+                ratio *= (double)(1.0f + (float)harmonic * 0.05f);
                 break;
 
-            float amplitude = 1.0f / harmonic;
-            float detune = 1.0f + (harmonic * 0.05f);
+            case 2:
+                amplitude *= (double)(4.0f / juce::MathConstants<float>::pi);
+                break;
 
-            auto angleDelta = (juce::MathConstants<double>::twoPi / (double)(tableSize - 1));
-            auto currentAngle = 0.0;
+            case 3:
+                amplitude *= (n % 2 == 0 ? -1.0 : 1.0) / (double)harmonic
+                           * (double)(8.0f / (juce::MathConstants<float>::pi * juce::MathConstants<float>::pi));
+                break;
 
-            for (unsigned int i = 0; i < tableSize; ++i)
-            {
-                samples[i] += std::sin(currentAngle * harmonic * detune) * amplitude;
-                currentAngle += angleDelta;
-            }
+            default:
+                break;
         }
 
-        normalizeWaveform(samples, tableSize);
-        samples[tableSize] = samples[0];
-        return sawTable;
+        const auto angleDelta = juce::MathConstants<double>::twoPi / (double)tableSize * ratio;
+        amplitude *= sign;
+
+        for (unsigned int i = 0; i < tableSize; ++i)
+            sums[i] += std::sin(angleDelta * (double)i) * amplitude;
+    }
+};
+
+//==============================================================================
+class WaveformGenerator
+{
+public:
+    // Waveform parameter index: 0=Sine, 1=Saw, 2=Square, 3=Triangle
+    static juce::AudioSampleBuffer createWaveform(int waveformType,
+                                                  unsigned int tableSize,
+                                                  int numHarmonics,
+                                                  float fundamentalFreq = 440.0f,
+                                                  float sampleRate = 44100.0f)
+    {
+        HarmonicSeries series(juce::jlimit(0, 3, waveformType), tableSize, fundamentalFreq, sampleRate);
+        series.setNumHarmonics(numHarmonics);
+        return series.createTable();
+    }
+
+    static juce::AudioSampleBuffer createSineWave(unsigned int tableSize,
+                                                   int numHarmonics,
+                                                   float fundamentalFreq = 440.0f,
+                                                   float sampleRate = 44100.0f)
+    {
+        return createWaveform(0, tableSize, numHarmonics, fundamentalFreq, sampleRate);
     }
 
+    static juce::AudioSampleBuffer createSawWave(unsigned int tableSize,
+                                                  int numHarmonics,
+                                                  float fundamentalFreq = 440.0f,
+                                                  float sampleRate = 44100.0f)
+    {
+        return createWaveform(1, tableSize, numHarmonics, fundamentalFreq, sampleRate);
+    }
+
+    // Odd harmonics only: n counts 1, 3, 5, 7...
     static juce::AudioSampleBuffer createSquareWave(unsigned int tableSize,
                                                      int numHarmonics,
                                                      float fundamentalFreq = 440.0f,
                                                      float sampleRate = 44100.0f)
     {
-        juce::AudioSampleBuffer squareTable;
-        squareTable.setSize(1, (int)tableSize + 1);
-        squareTable.clear();
-
-        auto* samples = squareTable.getWritePointer(0);
-
-        float nyquistFreq = sampleRate / 2.0f;
-
-        // Add harmonics
-        for (int n = 1; n <= numHarmonics; ++n)
-        {
-            int harmonic = 2 * n - 1;  // 1, 3, 5, 7...
-
-            float harmonicFreq = fundamentalFreq * harmonic;
-            if (harmonicFreq >= nyquistFreq)
-                break;
-
-            float amplitude = 1.0f / (float)harmonic;
-
-            auto angleDelta = (juce::MathConstants<double>::twoPi / (double)(tableSize - 1)) * harmonic;
-            auto currentAngle = 0.0;
-
-            for (unsigned int i = 0; i < tableSize; ++i)
-            {
-                samples[i] += (float)std::sin(currentAngle) * amplitude * (4.0f / juce::MathConstants<float>::pi);
-                currentAngle += angleDelta;
-            }
-        }
-
-        normalizeWaveform(samples, tableSize);
-        samples[tableSize] = samples[0];
-        return squareTable;
+        return createWaveform(2, tableSize, numHarmonics, fundamentalFreq, sampleRate);
     }
 
+    // Odd harmonics at 1/n², alternating in sign
     static juce::AudioSampleBuffer createTriangleWave(unsigned int tableSize,
                                                        int numHarmonics,
                                                        float fundamentalFreq = 440.0f,
                                                        float sampleRate = 44100.0f)
     {
-        juce::AudioSampleBuffer triangleTable;
-        triangleTable.setSize(1, (int)tableSize + 1);
-        triangleTable.clear();
-
-        auto* samples = triangleTable.getWritePointer(0);
-
-        float nyquistFreq = sampleRate / 2.0f;
-
-        // Add harmonics
-        for (int n = 1; n <= numHarmonics; ++n)
-        {
-            int harmonic = 2 * n - 1;
-
-            float harmonicFreq = fundamentalFreq * harmonic;
-            if (harmonicFreq >= nyquistFreq)
-                break;
-
-            float amplitude = 1.0f / (float)(harmonic * harmonic);
-            const float sign = (n % 2 == 0) ? -1.0f : 1.0f;
-
-            auto angleDelta = (juce::MathConstants<double>::twoPi / (double)(tableSize - 1)) * harmonic;
-            auto currentAngle = 0.0;
-
-            for (unsigned int i = 0; i < tableSize; ++i)
-            {
-                samples[i] += (float)std::sin(currentAngle) * amplitude * sign * (8.0f / (juce::MathConstants<float>::pi * juce::MathConstants<float>::pi));
-                currentAngle += angleDelta;
-            }
-        }
-
-        normalizeWaveform(samples, tableSize);
-        samples[tableSize] = samples[0];
-        return triangleTable;
-    }
-
-private:
-    // Normalize waveform
-    static void normalizeWaveform(float* samples, const unsigned int tableSize)
-    {
-        float maxVal = 0.0f;
-        for (unsigned int i = 0; i < tableSize; ++i)
-        {
-            float absVal = std::abs(samples[i]);
-            if (absVal > maxVal)
-                maxVal = absVal;
-        }
-
-        if (maxVal > 0.0f)
-        {
-            const float scale = 1.0f / maxVal;
-            for (unsigned int i = 0; i < tableSize; ++i)
-            {
-                samples[i] *= scale;
-            }
-        }
+        return createWaveform(3, tableSize, numHarmonics, fundamentalFreq, sampleRate);
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,102 @@
+#include "WavetableBank.h"
+#include "BaseWavetables.h"
+#include "TraceRecorder.h"
+
+WavetableBank::TablePtr WavetableBank::getTable(int waveformType, int numHarmonics,
+                                                unsigned int tableSize, double sampleRate)
+{
+    Key key { juce::jlimit(0, 3, waveformType), juce::jlimit(1, 16, numHarmonics), tableSize, sampleRate };
+
+    // A lone fundamental is far below Nyquist at any sample rate, so those tables are
+    // shared across rates
+    if (key.numHarmonics == 1)
+        key.sampleRate = 0.0;
+
+    const std::lock_guard<std::mutex> sl(lock);
+
+    ++numRequests;
+
+    if (auto existing = tables[key].lock())
+        return existing;
+
+    ++numBuilds;
+    removeExpiredTables();
+
+    auto table = std::make_shared<const juce::AudioSampleBuffer>(buildTable(key));
+    tables[key] = table;
+    return table;
+}
+
+juce::AudioSampleBuffer WavetableBank::buildTable(const Key& key)
+{
+    ARMONIO_TRACE_SCOPE("WavetableBank::buildTable");
+
+    if (key.numHarmonics == 1 && key.tableSize == BaseWavetables::tableSize)
+    {
+        // Compile-time data, so this costs a copy and no trig
+        const auto& base = BaseWavetables::get(key.waveformType);
+
+        juce::AudioSampleBuffer table(1, (int)base.size());
+        juce::FloatVectorOperations::copy(table.getWritePointer(0), base.data(), (int)base.size());
+        return table;
+    }
+
+    // Rate-independent keys still need a rate for the generator's Nyquist check
+    const auto sampleRate = key.sampleRate > 0.0 ? key.sampleRate : 44100.0;
+
+    // Steps from whatever count this waveform was last built at, so moving one
+    // harmonic costs one partial's worth of trig plus the normalised copy
+    auto& harmonics = getSeries(key.waveformType, key.tableSize, sampleRate);
+    harmonics.setNumHarmonics(key.numHarmonics);
+    return harmonics.createTable();
+}
+
+HarmonicSeries& WavetableBank::getSeries(int waveformType, unsigned int tableSize, double sampleRate)
+{
+    for (auto it = series.begin(); it != series.end(); ++it)
+    {
+        if (it->waveformType == waveformType && it->tableSize == tableSize && it->sampleRate == sampleRate)
+        {
+            series.splice(series.begin(), series, it);
+            return series.front().series;
+        }
+    }
+
+    if (series.size() >= maxSeries)
+        series.pop_back();
+
+    series.push_front({ waveformType, tableSize, sampleRate,
+                        HarmonicSeries(waveformType, tableSize, referenceFrequency, (float)sampleRate) });
+    return series.front().series;
+}
+
+void WavetableBank::removeExpiredTables()
+{
+    for (auto it = tables.begin(); it != tables.end();)
+    {
+        if (it->second.expired())
+            it = tables.erase(it);
+        else
+            ++it;
+    }
+}
+
+WavetableBank::Stats WavetableBank::getStats()
+{
+    const std::lock_guard<std::mutex> sl(lock);
+
+    Stats stats;
+    stats.numRequests = numRequests;
+    stats.numBuilds = numBuilds;
+
+    for (const auto& [key, weakTable] : tables)
+    {
+        if (auto table = weakTable.lock())
+        {
+            ++stats.numTables;
+            stats.numBytes += sizeof(float) * (size_t)table->getNumSamples() * (size_t)table->getNumChannels();
+        }
+    }
+
+    return stats;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include "WaveformGenerator.h"
+
+//==============================================================================
+// Process-wide registry of immutable wavetables. Every synth in the host process
+// asks the bank for its tables, so instances with the same settings share one copy
+// instead of each building and holding their own.
+//
+// Tables are handed out as shared pointers and the bank itself only keeps weak
+// ones, so a table is freed as soon as the last sound using it goes away. Hold the
+// bank through juce::SharedResourcePointer<WavetableBank>. Lookups lock a mutex
+// shared by every instance and may build a table, so they must stay off the audio
+// thread: SynthAudioSource only calls the bank from its message-thread setters and
+// prepareToPlay(), and the processor defers waveform, engine and harmonics
+// automation that arrives on the audio thread to the message thread.
+//
+// The bank also keeps the partial sums of the last few waveforms it built, so a
+// harmonic count sweep only adds or removes the partials in between rather than
+// summing every partial for each step.
+class WavetableBank
+{
+public:
+    using TablePtr = std::shared_ptr<const juce::AudioSampleBuffer>;
+
+    // Harmonic-rich tables are band-limited for this fundamental
+    static constexpr float referenceFrequency = 261.63f; // Middle C
+
+    // Waveform parameter index: 0=Sine, 1=Saw, 2=Square, 3=Triangle
+    TablePtr getTable(int waveformType, int numHarmonics, unsigned int tableSize, double sampleRate);
+
+    struct Stats
+    {
+        int numTables = 0;          // distinct tables alive right now
+        size_t numBytes = 0;        // sample memory held by those tables
+        int numRequests = 0;        // lookups since the bank was created
+        int numBuilds = 0;          // lookups that had to build a table
+    };
+
+    Stats getStats();
+
+private:
+    struct Key
+    {
+        int waveformType;
+        int numHarmonics;
+        unsigned int tableSize;
+        double sampleRate;
+
+        bool operator<(const Key& other) const noexcept
+        {
+            return std::tie(waveformType, numHarmonics, tableSize, sampleRate)
+                 < std::tie(other.waveformType, other.numHarmonics, other.tableSize, other.sampleRate);
+        }
+    };
+
+    // How many waveform/size/rate combinations keep their partial sums around
+    static constexpr size_t maxSeries = 8;
+
+    struct CachedSeries
+    {
+        int waveformType;
+        unsigned int tableSize;
+        double sampleRate;
+        HarmonicSeries series;
+    };
+
+    juce::AudioSampleBuffer buildTable(const Key& key);
+    HarmonicSeries& getSeries(int waveformType, unsigned int tableSize, double sampleRate);
+    void removeExpiredTables();
+
+    std::mutex lock;
+    std::map<Key, std::weak_ptr<const juce::AudioSampleBuffer>> tables;
+    std::list<CachedSeries> series;     // most recently used first
+    int numRequests = 0;
+    int numBuilds = 0;
+};
@@ -1,15 +1,25 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "FastRandom.h"
 
 class WavetableOscillator
 {
 public:
+    WavetableOscillator() = default;
+
     WavetableOscillator(const juce::AudioSampleBuffer& wavetableToUse)
-        : wavetable(wavetableToUse),
-          tableSize(wavetable.getNumSamples() - 1)
     {
-        jassert(wavetable.getNumChannels() == 1);
+        setWavetable(wavetableToUse);
+    }
+
+    // Lets preallocated oscillators be pointed at a new table without allocating
+    void setWavetable(const juce::AudioSampleBuffer& wavetableToUse)
+    {
+        jassert(wavetableToUse.getNumChannels() == 1);
+
+        wavetable = &wavetableToUse;
+        tableSize = wavetable->getNumSamples() - 1;
     }
 
     void setFrequency(float frequency, float sampleRate)
@@ -18,9 +28,9 @@ public:
         tableDelta = frequency * tableSizeOverSampleRate;
     }
 
-    void setRandomPhase()
+    void setRandomPhase(FastRandom& random)
     {
-        currentIndex = juce::Random::getSystemRandom().nextFloat() * (float)tableSize;
+        currentIndex = random.nextFloat() * (float)tableSize;
     }
 
     forcedinline float getNextSample() noexcept
@@ -31,7 +41,7 @@ public:
 
         auto frac = currentIndex - (float)index0;
 
-        auto* table = wavetable.getReadPointer(0);
+        auto* table = wavetable->getReadPointer(0);
         auto value0 = table[index0];
         auto value1 = table[index1];
 
@@ -57,8 +67,8 @@ public:
     }
 
 private:
-    const juce::AudioSampleBuffer& wavetable;
-    const int tableSize;
+    const juce::AudioSampleBuffer* wavetable = nullptr;
+    int tableSize = 0;
     float currentIndex = 0.0f;
     float tableDelta = 0.0f;
 };
\ No newline at end of file
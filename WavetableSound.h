@@ -2,23 +2,144 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "WavetableOscillator.h"
+#include "UnisonOscillator.h"
+#include "PolyBlepOscillator.h"
+#include "AdditiveOscillator.h"
+#include "ModulationMatrix.h"
+#include "SnapshotMailbox.h"
+#include "VoiceFilterBank.h"
+#include "TraceRecorder.h"
 
 //==============================================================================
 class WavetableSound : public juce::SynthesiserSound
 {
 public:
-    WavetableSound(const juce::AudioSampleBuffer& wavetableToUse)
-        : wavetable(wavetableToUse)
+    // Shares an immutable table, normally one handed out by the WavetableBank. The
+    // optional single-harmonic table of the same waveform is what the harmonics
+    // morph modulation fades towards.
+    //
+    // With an analytic shape, notes whose band the main table's harmonics already
+    // fill play a polyBLEP waveform instead of reading it; see getAnalyticShapeFor().
+    // Additive sounds read no table at all; voices render the spectrum they were
+    // given with setAdditiveSpectrum().
+    explicit WavetableSound(std::shared_ptr<const juce::AudioSampleBuffer> wavetableToUse,
+                            std::shared_ptr<const juce::AudioSampleBuffer> fundamentalToUse = nullptr,
+                            int analyticShapeToUse = PolyBlep::none,
+                            int numHarmonicsInTable = 1,
+                            bool isAdditiveSound = false)
+        : wavetable(std::move(wavetableToUse)),
+          fundamental(std::move(fundamentalToUse)),
+          analyticShape(analyticShapeToUse),
+          numHarmonics(numHarmonicsInTable),
+          additive(isAdditiveSound)
+    {
+        jassert(wavetable != nullptr);
+        jassert(fundamental == nullptr || fundamental->getNumSamples() == wavetable->getNumSamples());
+
+        // A table normalised to peak at 1 has a quieter fundamental than the shape
+        if (analyticShape != PolyBlep::none)
+            analyticGain = (float)(measureFundamental(*wavetable) / PolyBlep::fundamentalAmplitude(analyticShape));
+    }
+
+    explicit WavetableSound(const juce::AudioSampleBuffer& wavetableToCopy)
+        : WavetableSound(std::make_shared<const juce::AudioSampleBuffer>(wavetableToCopy))
     {
     }
 
     bool appliesToNote(int) override { return true; }
     bool appliesToChannel(int) override { return true; }
 
-    const juce::AudioSampleBuffer& getWavetable() const { return wavetable; }
+    const juce::AudioSampleBuffer& getWavetable() const { return *wavetable; }
+
+    // Falls back to the main table, so morphing is silent when there is nothing to fade to
+    const juce::AudioSampleBuffer& getFundamentalWavetable() const
+    {
+        return fundamental != nullptr ? *fundamental : *wavetable;
+    }
+
+    // One of PolyBlep::Shape, or PolyBlep::none for the wavetable engine
+    int getAnalyticShape() const noexcept { return analyticShape; }
+
+    // The shape a note at this frequency plays, or PolyBlep::none to read the table.
+    // A polyBLEP shape carries every harmonic below Nyquist, so it only stands in
+    // for a table of a few harmonics once the next one the table leaves out would
+    // be above Nyquist anyway; lower notes keep the table's partial count.
+    int getAnalyticShapeFor(float frequency, float sampleRate) const noexcept
+    {
+        if (analyticShape == PolyBlep::none)
+            return PolyBlep::none;
+
+        // Saws have every harmonic, squares and triangles only the odd ones
+        const auto firstMissing = analyticShape == PolyBlep::saw ? numHarmonics + 1 : 2 * numHarmonics + 1;
+
+        return frequency * (float)firstMissing >= 0.5f * sampleRate ? analyticShape : PolyBlep::none;
+    }
+
+    // Scales the analytic shape's fundamental to the table's
+    float getAnalyticGain() const noexcept { return analyticGain; }
+
+    bool isAdditive() const noexcept { return additive; }
 
 private:
-    juce::AudioSampleBuffer wavetable;
+    std::shared_ptr<const juce::AudioSampleBuffer> wavetable;
+    std::shared_ptr<const juce::AudioSampleBuffer> fundamental;
+    int analyticShape = PolyBlep::none;
+    int numHarmonics = 1;
+    float analyticGain = 1.0f;
+    bool additive = false;
+
+    // Amplitude of the first harmonic over one period, ignoring the guard sample
+    static double measureFundamental(const juce::AudioSampleBuffer& table)
+    {
+        const auto* samples = table.getReadPointer(0);
+        const auto period = table.getNumSamples() - 1;
+        auto re = 0.0, im = 0.0;
+
+        for (int i = 0; i < period; ++i)
+        {
+            const auto angle = juce::MathConstants<double>::twoPi * i / period;
+            re += samples[i] * std::cos(angle);
+            im += samples[i] * std::sin(angle);
+        }
+
+        return 2.0 * std::sqrt(re * re + im * im) / period;
+    }
+};
+
+//==============================================================================
+// What ArmonioSynthesiser's event scheduler shares with its voices while it works
+// through one block: where the event being handled falls, and the mod wheel moves
+// so far, which each voice picks up at its next modulation ramp.
+struct VoiceSchedule
+{
+    static constexpr int maxModWheelEvents = 64;
+
+    int eventPosition = 0;
+
+    // Block positions and values (0 to 1) in time order. Moves beyond the last slot
+    // only update its value, so the latest one always wins.
+    std::array<int, maxModWheelEvents> modWheelPositions {};
+    std::array<float, maxModWheelEvents> modWheelValues {};
+    int numModWheelEvents = 0;
+
+    void clear() noexcept
+    {
+        eventPosition = 0;
+        numModWheelEvents = 0;
+    }
+
+    void addModWheelEvent(int position, float value) noexcept
+    {
+        if (numModWheelEvents == maxModWheelEvents)
+        {
+            modWheelValues[(size_t)(maxModWheelEvents - 1)] = value;
+            return;
+        }
+
+        modWheelPositions[(size_t)numModWheelEvents] = position;
+        modWheelValues[(size_t)numModWheelEvents] = value;
+        ++numModWheelEvents;
+    }
 };
 
 //==============================================================================
@@ -35,6 +156,15 @@ public:
         params.sustain = 0.8f;
         params.release = 0.3f;
         adsr.setParameters(params);
+
+        filterEnvelope.setSampleRate(44100.0);
+
+        juce::ADSR::Parameters filterParams;
+        filterParams.attack = 0.01f;
+        filterParams.decay = 0.3f;
+        filterParams.sustain = 0.5f;
+        filterParams.release = 0.3f;
+        filterEnvelope.setParameters(filterParams);
     }
 
     bool canPlaySound(juce::SynthesiserSound* sound) override
@@ -46,96 +176,394 @@ public:
                    juce::SynthesiserSound* sound,
                    int /*currentPitchWheelPosition*/) override
     {
+        catchUpToEvent();
+
         auto* wavetableSound = dynamic_cast<WavetableSound*>(sound);
         if (wavetableSound != nullptr)
         {
             auto sampleRate = getSampleRate();
             auto fundamentalFreq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
 
-            // Create main oscillator with random starting phase
-            mainOscillator = std::make_unique<WavetableOscillator>(wavetableSound->getWavetable());
-            mainOscillator->setFrequency((float)fundamentalFreq, (float)sampleRate);
-            mainOscillator->setRandomPhase();
+            applyPendingSeed();
+
+            // In deterministic mode a note's phases depend only on the seed and the note itself
+            if (isDeterministic)
+                random.setSeed(FastRandom::mix(randomSeed ^ (juce::uint64)((midiNoteNumber << 8) | juce::roundToInt(velocity * 127.0f))));
+
+            isAdditive = wavetableSound->isAdditive();
+
+            if (isAdditive)
+            {
+                // Every partial, the subharmonics included, lives in the one bank
+                additiveOscillator.startNote((float)fundamentalFreq, (float)sampleRate, numSubharmonics, random);
+            }
+            else
+            {
+                // Point the preallocated unison stack at the table with random starting phases
+                mainOscillator.setWavetable(wavetableSound->getWavetable());
+                mainOscillator.setMorphTable(wavetableSound->getFundamentalWavetable());
+                mainOscillator.setAnalyticShape(wavetableSound->getAnalyticShapeFor((float)fundamentalFreq, (float)sampleRate),
+                                                wavetableSound->getAnalyticGain());
+                mainOscillator.setNumVoices(numUnisonVoices.load(std::memory_order_relaxed));
+                mainOscillator.setFrequency((float)fundamentalFreq, (float)sampleRate);
+                mainOscillator.setRandomPhase(random);
+            }
 
             // Calculate Nyquist frequency for band-limiting
             float nyquistFreq = (float)sampleRate / 2.0f;
 
-            // Create subharmonic oscillators with band-limiting
-            subharmonicOscillators.clear();
-            for (int i = 0; i < numSubharmonics; ++i)
+            // Set up subharmonic oscillators with band-limiting. They all follow the
+            // engine the lowest of them can use, so they share one render loop.
+            analyticShape = wavetableSound->getAnalyticShapeFor((float)fundamentalFreq / (float)(numSubharmonics + 1),
+                                                                (float)sampleRate);
+            numActiveSubharmonics = 0;
+            for (int i = 0; i < (isAdditive ? 0 : numSubharmonics); ++i)
             {
                 float divisor = (float)(i + 2);
                 float subFreq = fundamentalFreq / divisor;
 
                 if (subFreq < nyquistFreq)
                 {
-                    auto subOsc = std::make_unique<WavetableOscillator>(wavetableSound->getWavetable());
-                    subOsc->setFrequency(subFreq, (float)sampleRate);
-                    subOsc->setRandomPhase();
-                    subharmonicOscillators.push_back(std::move(subOsc));
+                    subharmonicFrequencies[(size_t)numActiveSubharmonics] = (float)subFreq;
+
+                    if (analyticShape != PolyBlep::none)
+                    {
+                        auto& subOsc = analyticSubharmonicOscillators[(size_t)numActiveSubharmonics];
+                        subOsc.setShape(analyticShape, wavetableSound->getAnalyticGain());
+                        subOsc.setFrequency(subFreq, (float)sampleRate);
+                        subOsc.setRandomPhase(random);
+                    }
+                    else
+                    {
+                        auto& subOsc = subharmonicOscillators[(size_t)numActiveSubharmonics];
+                        subOsc.setWavetable(wavetableSound->getWavetable());
+                        subOsc.setFrequency(subFreq, (float)sampleRate);
+                        subOsc.setRandomPhase(random);
+                    }
+
+                    ++numActiveSubharmonics;
                 }
             }
 
+            isOscillatorActive = true;
+            isReleasing = false;
             level = velocity * 0.15f;
-            tailOff = 0.0;
+
+            // A note that starts thinned does not fade its subharmonics out first
+            subharmonicFade = shouldThinSubharmonics() ? 0.0f : 1.0f;
+
+            currentNoteNumber = midiNoteNumber;
+
+            // The filter restarts where the note does, or at the next block if it
+            // starts between blocks
+            filterResetPosition = schedule != nullptr ? blockPosition : 0;
+
+            adoptNewFilterSettings();
 
             adsr.noteOn();
+            filterEnvelope.noteOn();
+            modulation.noteOn(velocity);
+
+            if (! modulation.hasActiveSlots())
+                currentFilterModulation = 0.0f;
         }
     }
 
     void stopNote(float /*velocity*/, bool allowTailOff) override
     {
+        catchUpToEvent();
+
+        isReleasing = true;
         adsr.noteOff();
+        filterEnvelope.noteOff();
+        modulation.noteOff();
     }
 
     void pitchWheelMoved(int) override {}
-    void controllerMoved(int, int) override {}
 
+    // Scheduled blocks hand mod wheel moves over through the VoiceSchedule instead
+    void controllerMoved(int controllerNumber, int newValue) override
+    {
+        if (schedule == nullptr && controllerNumber == 1)
+            modulation.setModWheel((float)newValue / 127.0f);
+    }
+
+    //==============================================================================
+    // ArmonioSynthesiser's event scheduler. Between beginBlock() and endBlock() the
+    // voice renders into its filter lane by itself: an event that reaches it first
+    // renders it up to the event's position, and renderUpTo() finishes the block, so
+    // events meant for other voices never split its rendering.
+    void beginBlock(const VoiceSchedule& scheduleToUse, float* left, float* right, int stride) noexcept
+    {
+        schedule = &scheduleToUse;
+        laneLeft = left;
+        laneRight = right;
+        laneStride = stride;
+        nextModWheelEvent = 0;
+        startBlock();
+    }
+
+    void endBlock() noexcept
+    {
+        // Moves the voice never reached still count for its next note
+        applyModWheelUpTo(std::numeric_limits<int>::max());
+
+        schedule = nullptr;
+        filterResetPosition = -1;
+    }
+
+    // Renders into the lane from where the voice got to, up to a block position
+    void renderUpTo(int position) noexcept
+    {
+        renderUpTo(position, laneLeft, laneRight, laneStride);
+    }
+
+    // The same into other buffers, whose sample n is also block position n
+    void renderUpTo(int position, float* left, float* right, int stride) noexcept
+    {
+        if (position > blockPosition)
+            renderAdding(left + blockPosition * stride, right + blockPosition * stride,
+                         stride, position - blockPosition, 1.0f);
+    }
+
+    int getBlockPosition() const noexcept { return blockPosition; }
+
+    // True if the voice put anything into its lane this block, even if it has finished since
+    bool hasSoundedInBlock() const noexcept { return soundedInBlock; }
+
+    // On a plain Synthesiser the voice renders unfiltered; ArmonioSynthesiser routes
+    // it through the voice filter bank with renderAdding() instead
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer,
                         int startSample, int numSamples) override
     {
-        if (mainOscillator != nullptr)
+        renderToBuffer(outputBuffer, startSample, numSamples);
+    }
+
+    // Renders straight into a double bus rather than through a float copy
+    void renderNextBlock(juce::AudioBuffer<double>& outputBuffer,
+                        int startSample, int numSamples) override
+    {
+        renderToBuffer(outputBuffer, startSample, numSamples);
+    }
+
+    // Adds numSamples of the voice to left and right, whose consecutive samples are
+    // stride apart. The voice itself runs in float either way; a double output only
+    // changes the final add.
+    template <typename SampleType>
+    void renderAdding(SampleType* left, SampleType* right, int stride, int numSamples, float outputGain) noexcept
+    {
+        const auto endPosition = blockPosition + numSamples;
+
+        if (isOscillatorActive)
         {
-            // Process each sample
-            while (--numSamples >= 0)
+            ARMONIO_TRACE_SCOPE("WavetableVoice::renderNextBlock");
+
+            soundedInBlock = true;
+
+            while (numSamples > 0)
             {
-                // Get main oscillator sample
-                auto mainSample = mainOscillator->getNextSample();
+                auto numThisTime = juce::jmin(numSamples, renderChunkSize);
+
+                // New filter and modulation settings take effect at the start of a control interval
+                adoptNewFilterSettings();
 
-                // Add subharmonic oscillators
-                float subharmonicSum = 0.0f;
-                for (int i = 0; i < subharmonicOscillators.size(); ++i)
+                if (modulation.adoptNewSettings() && ! modulation.hasActiveSlots())
+                    currentFilterModulation = 0.0f;
+
+                const auto isModulated = modulation.hasActiveSlots();
+
+                // Level and subharmonic mix ramp across the chunk; unmodulated they stay at 1
+                auto levelGain = 1.0f, levelStep = 0.0f;
+                auto subGain = 1.0f, subEnd = 1.0f;
+
+                // Subharmonics being thinned out fade over the chunk, and once silent
+                // are not rendered at all
+                const auto fadeStart = subharmonicFade;
+                subharmonicFade = shouldThinSubharmonics() ? 0.0f : 1.0f;
+                const auto numSubharmonicsToRender = fadeStart > 0.0f || subharmonicFade > 0.0f ? numActiveSubharmonics : 0;
+
+                if (isModulated)
+                {
+                    // Each chunk is one control interval of the modulation matrix, and
+                    // ramps to any mod wheel move made by the time it starts
+                    applyModWheelUpTo(blockPosition);
+                    modulation.advance(numThisTime, random);
+
+                    auto pitchRatio = [](float value) { return std::exp2(value * 2.0f); };
+                    auto morph      = [](float value) { return juce::jlimit(0.0f, 1.0f, value); };
+                    auto scale      = [](float value) { return juce::jlimit(0.0f, 2.0f, 1.0f + value); };
+
+                    const auto startRatio = pitchRatio(modulation.getStart(Modulation::pitch));
+                    const auto endRatio = pitchRatio(modulation.getEnd(Modulation::pitch));
+
+                    if (isAdditive)
+                    {
+                        // One pitch per chunk, like the subharmonics, with every partial's
+                        // amplitude ramping to where the chunk ends
+                        additiveOscillator.render(unisonLeft.data(), numThisTime, 0.5f * (startRatio + endRatio),
+                                                  morph(modulation.getEnd(Modulation::harmonicsMorph)),
+                                                  scale(modulation.getEnd(Modulation::subharmonicMix)) * subharmonicFade);
+                    }
+                    else
+                    {
+                        mainOscillator.renderModulated(unisonLeft.data(), unisonRight.data(), numThisTime,
+                                                       startRatio, endRatio,
+                                                       morph(modulation.getStart(Modulation::harmonicsMorph)),
+                                                       morph(modulation.getEnd(Modulation::harmonicsMorph)));
+                    }
+
+                    // Subharmonics follow the pitch once per chunk, at its midpoint
+                    for (int i = 0; i < numSubharmonicsToRender; ++i)
+                        setSubharmonicFrequency(i, subharmonicFrequencies[(size_t)i] * 0.5f * (startRatio + endRatio));
+
+                    levelGain = scale(modulation.getStart(Modulation::level));
+                    levelStep = (scale(modulation.getEnd(Modulation::level)) - levelGain) / (float)numThisTime;
+                    subGain = scale(modulation.getStart(Modulation::subharmonicMix));
+                    subEnd = scale(modulation.getEnd(Modulation::subharmonicMix));
+
+                    // The filter only takes a new cutoff per control block, so it gets the midpoint
+                    currentFilterModulation = 24.0f * (modulation.getStart(Modulation::filterCutoff)
+                                                     + modulation.getEnd(Modulation::filterCutoff));
+                }
+                else if (isAdditive)
+                {
+                    additiveOscillator.render(unisonLeft.data(), numThisTime, 1.0f, 0.0f, subharmonicFade);
+                }
+                else
                 {
-                    float divisor = (float)(i + 2);
-                    float amplitude = 0.5f / divisor;
-                    subharmonicSum += subharmonicOscillators[i]->getNextSample() * amplitude;
+                    // The whole unison stack for this chunk in one pass
+                    mainOscillator.render(unisonLeft.data(), unisonRight.data(), numThisTime);
                 }
 
-                // Combine main + subharmonics
-                auto waveformSample = mainSample + subharmonicSum;
+                // The bank has no stereo spread of its own
+                if (isAdditive)
+                    juce::FloatVectorOperations::copy(unisonRight.data(), unisonLeft.data(), numThisTime);
 
-                // Apply ADSR envelope
-                auto envelopeValue = adsr.getNextSample();
+                subGain *= fadeStart;
+                const auto subStep = (subEnd * subharmonicFade - subGain) / (float)numThisTime;
 
-                // Final sample: waveform × ADSR × velocity × anti-click
-                auto currentSample = waveformSample * envelopeValue * level;
+                auto numRendered = numThisTime;
+                auto noteFinished = false;
 
-                // Write to all output channels
-                for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
-                    outputBuffer.addSample(i, startSample, currentSample);
+                for (int n = 0; n < numThisTime; ++n)
+                {
+                    // Add subharmonic oscillators
+                    auto subharmonicSum = getNextSubharmonicSum(numSubharmonicsToRender) * subGain;
+
+                    // Apply ADSR envelope
+                    auto envelopeValue = adsr.getNextSample();
+                    auto gain = envelopeValue * level * outputGain * levelGain;
+
+                    // Final sample: (unison stack + subharmonics) × ADSR × velocity
+                    unisonLeft[(size_t)n] = (unisonLeft[(size_t)n] + subharmonicSum) * gain;
+                    unisonRight[(size_t)n] = (unisonRight[(size_t)n] + subharmonicSum) * gain;
+
+                    levelGain += levelStep;
+                    subGain += subStep;
+
+                    // The filter envelope runs alongside; where the voice enters a control
+                    // block sets that block's cutoff
+                    const auto filterEnvelopeValue = filterEnvelope.getNextSample();
+
+                    if (blockPosition + n >= nextFilterCutoffPosition)
+                        recordFilterCutoff(blockPosition + n, filterEnvelopeValue);
+
+                    // Check if envelope has finished
+                    if (!adsr.isActive())
+                    {
+                        numRendered = n + 1;
+                        noteFinished = true;
+                        break;
+                    }
+                }
 
-                ++startSample;
+                // Mix the finished chunk into the output
+                if constexpr (std::is_same_v<SampleType, float>)
+                {
+                    if (stride == 1)
+                    {
+                        juce::FloatVectorOperations::add(left, unisonLeft.data(), numRendered);
+                        juce::FloatVectorOperations::add(right, unisonRight.data(), numRendered);
+                    }
+                    else
+                    {
+                        for (int n = 0; n < numRendered; ++n)
+                        {
+                            left[n * stride] += unisonLeft[(size_t)n];
+                            right[n * stride] += unisonRight[(size_t)n];
+                        }
+                    }
+                }
+                else
+                {
+                    for (int n = 0; n < numRendered; ++n)
+                    {
+                        left[n * stride] += (SampleType)unisonLeft[(size_t)n];
+                        right[n * stride] += (SampleType)unisonRight[(size_t)n];
+                    }
+                }
+
+                left += numRendered * stride;
+                right += numRendered * stride;
+                blockPosition += numRendered;
 
-                // Check if envelope has finished
-                if (!adsr.isActive())
+                if (noteFinished)
                 {
                     clearCurrentNote();
-                    mainOscillator.reset();
-                    subharmonicOscillators.clear();
+                    isOscillatorActive = false;
+                    numActiveSubharmonics = 0;
+
+                    // The next note's filter envelope starts from rest, as its amplitude does
+                    filterEnvelope.reset();
                     break;
                 }
+
+                numSamples -= numThisTime;
             }
         }
+
+        blockPosition = endPosition;
+    }
+
+    // Control rate: the filter cutoff for one control block of the current block.
+    // Blocks the voice did not sound in keep the cutoff it had last.
+    float getFilterCutoff(int controlBlock) const noexcept
+    {
+        return controlBlock < numFilterCutoffs ? filterCutoffs[(size_t)controlBlock] : lastFilterCutoff;
+    }
+
+    // True once if the voice's latest note started within this range of the block,
+    // so that the filter can start it from rest
+    bool consumeFilterReset(int startPosition, int numSamples) noexcept
+    {
+        if (filterResetPosition < startPosition || filterResetPosition >= startPosition + numSamples)
+            return false;
+
+        filterResetPosition = -1;
+        return true;
+    }
+
+    // One thread at a time, e.g. the audio thread between blocks, for both of these:
+    // a playing note picks the settings up at its next control block
+    void setFilterParameters(float cutoffHz, float envelopeAmountSemitones, float keyTracking) noexcept
+    {
+        filterSettingsToPublish.cutoff = cutoffHz;
+        filterSettingsToPublish.envelopeAmount = envelopeAmountSemitones;
+        filterSettingsToPublish.keyTracking = keyTracking;
+        filterSettings.publish(filterSettingsToPublish);
+    }
+
+    void setFilterEnvelopeParameters(const juce::ADSR::Parameters& params) noexcept
+    {
+        filterSettingsToPublish.envelopeParameters = params;
+        filterSettings.publish(filterSettingsToPublish);
+    }
+
+    // One thread at a time, e.g. the audio thread between blocks; a playing note
+    // picks the settings up at its next control interval
+    void setModulationSettings(const Modulation::Settings& settings) noexcept
+    {
+        modulation.setSettings(settings);
     }
 
     void setADSRParameters(const juce::ADSR::Parameters& params)
@@ -145,24 +573,293 @@ public:
 
     void setNumSubharmonics(int num)
     {
-        numSubharmonics = juce::jlimit(0, 8, num);
+        numSubharmonics = juce::jlimit(0, maxSubharmonics, num);
+    }
+
+    // Any thread. The voice count applies from the next note; detune and spread also
+    // reach a playing note, from its next render chunk.
+    void setUnison(int numVoices, float detuneCents, float spread) noexcept
+    {
+        numUnisonVoices.store(juce::jlimit(1, UnisonOscillator::maxVoices, numVoices), std::memory_order_relaxed);
+        mainOscillator.setDetuneAndSpread(detuneCents, spread);
+    }
+
+    // The partials an additive sound plays; a playing additive note moves to the
+    // new spectrum over its next chunk
+    void setAdditiveSpectrum(const Additive::Spectrum& spectrum) noexcept
+    {
+        additiveOscillator.setSpectrum(spectrum);
+    }
+
+    // Cubic interpolation for the main stack, e.g. while rendering offline
+    void setHighQualityInterpolation(bool shouldUseHighQuality) noexcept
+    {
+        mainOscillator.setHighQualityInterpolation(shouldUseHighQuality);
+    }
+
+    enum SubharmonicThinning
+    {
+        keepSubharmonics,
+        thinQuietSubharmonics,   // only on soft notes and notes in their release
+        dropSubharmonics
+    };
+
+    // Audio thread: under CPU pressure, fades subharmonics out and stops rendering them
+    void setSubharmonicThinning(int thinning) noexcept
+    {
+        subharmonicThinning = thinning;
+    }
+
+    // Any thread. Each voice runs its own generator, seeded from the global seed and
+    // its index; the audio thread reseeds it when the next note starts.
+    void setRandomSeed(juce::uint64 seed, int voiceIndex, bool shouldBeDeterministic) noexcept
+    {
+        pendingSeed.store(FastRandom::mix(seed) ^ (juce::uint64)voiceIndex, std::memory_order_relaxed);
+        pendingBaseSeed.store(seed, std::memory_order_relaxed);
+        pendingDeterministic.store(shouldBeDeterministic, std::memory_order_relaxed);
+        seedChanged.store(true, std::memory_order_release);
+    }
+
+    // Silences the voice at once, e.g. before an offline render starts
+    void resetVoice()
+    {
+        clearCurrentNote();
+        adsr.reset();
+        filterEnvelope.reset();
+        modulation.reset();
+        currentFilterModulation = 0.0f;
+        filterResetPosition = 0;
+        isOscillatorActive = false;
+        numActiveSubharmonics = 0;
     }
 
     void setCurrentPlaybackSampleRate(double newRate) override
     {
         SynthesiserVoice::setCurrentPlaybackSampleRate(newRate);
         adsr.setSampleRate(newRate);
+        filterEnvelope.setSampleRate(newRate);
+        modulation.setSampleRate(newRate);
     }
 
 private:
-    std::unique_ptr<WavetableOscillator> mainOscillator;
-    std::vector<std::unique_ptr<WavetableOscillator>> subharmonicOscillators;
+    static constexpr int maxSubharmonics = 8;
+
+    template <typename SampleType>
+    void renderToBuffer(juce::AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples) noexcept
+    {
+        // Every call is a block of its own
+        startBlock();
+
+        if (outputBuffer.getNumChannels() > 1)
+        {
+            renderAdding(outputBuffer.getWritePointer(0, startSample),
+                         outputBuffer.getWritePointer(1, startSample),
+                         1, numSamples, 1.0f);
+        }
+        else
+        {
+            auto* mono = outputBuffer.getWritePointer(0, startSample);
+            renderAdding(mono, mono, 1, numSamples, 0.5f);
+        }
+    }
+
+    float getNextSubharmonicSum(int numToRender) noexcept
+    {
+        float subharmonicSum = 0.0f;
+
+        if (analyticShape != PolyBlep::none)
+        {
+            for (int i = 0; i < numToRender; ++i)
+                subharmonicSum += analyticSubharmonicOscillators[(size_t)i].getNextSample() * subharmonicAmplitude(i);
+        }
+        else
+        {
+            for (int i = 0; i < numToRender; ++i)
+                subharmonicSum += subharmonicOscillators[(size_t)i].getNextSample() * subharmonicAmplitude(i);
+        }
+
+        return subharmonicSum;
+    }
+
+    // The additive engine keeps its subharmonics in the partial bank, where
+    // silencing them saves nothing, but they still fade the same way
+    bool shouldThinSubharmonics() const noexcept
+    {
+        switch (subharmonicThinning)
+        {
+            case dropSubharmonics:      return true;
+            case thinQuietSubharmonics: return isReleasing || level < quietLevel;
+            default:                    return false;
+        }
+    }
+
+    // Subharmonic i sounds at 1 / (i + 2) of the note, at half that amplitude
+    static float subharmonicAmplitude(int i) noexcept
+    {
+        return 0.5f / (float)(i + 2);
+    }
+
+    void setSubharmonicFrequency(int i, float frequency) noexcept
+    {
+        if (analyticShape != PolyBlep::none)
+            analyticSubharmonicOscillators[(size_t)i].setFrequency(frequency, (float)getSampleRate());
+        else
+            subharmonicOscillators[(size_t)i].setFrequency(frequency, (float)getSampleRate());
+    }
+
+    // A seed set while this runs raises the flag again, so the next note picks it up
+    void applyPendingSeed() noexcept
+    {
+        if (! seedChanged.exchange(false, std::memory_order_acquire))
+            return;
+
+        random.setSeed(pendingSeed.load(std::memory_order_relaxed));
+        randomSeed = pendingBaseSeed.load(std::memory_order_relaxed);
+        isDeterministic = pendingDeterministic.load(std::memory_order_relaxed);
+    }
+
+    void startBlock() noexcept
+    {
+        blockPosition = 0;
+        soundedInBlock = false;
+        numFilterCutoffs = 0;
+        nextFilterCutoffPosition = 0;
+    }
+
+    // An event the scheduler is handling has reached this voice: render up to it first
+    void catchUpToEvent() noexcept
+    {
+        if (schedule != nullptr)
+        {
+            renderUpTo(schedule->eventPosition);
+            applyModWheelUpTo(schedule->eventPosition);
+        }
+    }
+
+    void applyModWheelUpTo(int position) noexcept
+    {
+        if (schedule == nullptr)
+            return;
+
+        for (; nextModWheelEvent < schedule->numModWheelEvents
+                   && schedule->modWheelPositions[(size_t)nextModWheelEvent] <= position;
+             ++nextModWheelEvent)
+        {
+            modulation.setModWheel(schedule->modWheelValues[(size_t)nextModWheelEvent]);
+        }
+    }
+
+    void adoptNewFilterSettings() noexcept
+    {
+        if (filterSettings.adoptLatest())
+            filterEnvelope.setParameters(filterSettings.get().envelopeParameters);
+    }
+
+    void recordFilterCutoff(int position, float envelopeValue) noexcept
+    {
+        constexpr auto maxCutoffs = (int)std::tuple_size<decltype(filterCutoffs)>::value;
+        const auto controlBlock = juce::jmin(position / VoiceFilterBank::controlBlockSize, maxCutoffs);
+
+        // Control blocks the voice skipped over were silent, so they keep the old cutoff
+        while (numFilterCutoffs < controlBlock)
+            filterCutoffs[(size_t)numFilterCutoffs++] = lastFilterCutoff;
+
+        const auto& settings = filterSettings.get();
+        const auto semitones = settings.keyTracking * (float)(currentNoteNumber - 60)
+                             + settings.envelopeAmount * envelopeValue
+                             + currentFilterModulation;
+
+        lastFilterCutoff = settings.cutoff * std::exp2(semitones / 12.0f);
+
+        if (numFilterCutoffs < maxCutoffs)
+            filterCutoffs[(size_t)numFilterCutoffs++] = lastFilterCutoff;
+
+        nextFilterCutoffPosition = numFilterCutoffs < maxCutoffs ? numFilterCutoffs * VoiceFilterBank::controlBlockSize
+                                                                 : std::numeric_limits<int>::max();
+    }
+
+    // One modulation control interval, which also lines up with the filter's control blocks
+    static constexpr int renderChunkSize = Modulation::controlInterval;
+
+    // Preallocated so that starting a note never touches the heap
+    UnisonOscillator mainOscillator;
+    AdditiveOscillator additiveOscillator;
+    bool isAdditive = false;
+    std::array<WavetableOscillator, maxSubharmonics> subharmonicOscillators;
+    std::array<PolyBlepOscillator, maxSubharmonics> analyticSubharmonicOscillators;
+    int analyticShape = PolyBlep::none;
+    std::array<float, maxSubharmonics> subharmonicFrequencies {};
+    int numActiveSubharmonics = 0;
+    bool isOscillatorActive = false;
+
+    // What the quality governor has asked for, and how far the subharmonics have faded
+    int subharmonicThinning = keepSubharmonics;
+    float subharmonicFade = 1.0f;
+    bool isReleasing = false;
+
+    // Below velocity 0.1, 20 dB under the loudest note
+    static constexpr float quietLevel = 0.015f;
+
+    std::array<float, renderChunkSize> unisonLeft {};
+    std::array<float, renderChunkSize> unisonRight {};
+
+    // Audio thread only; setRandomSeed() leaves the new seed in the pending values
+    FastRandom random;
+    juce::uint64 randomSeed = 0;
+    bool isDeterministic = false;
+
+    std::atomic<juce::uint64> pendingSeed { 0 };
+    std::atomic<juce::uint64> pendingBaseSeed { 0 };
+    std::atomic<bool> pendingDeterministic { false };
+    std::atomic<bool> seedChanged { false };
 
     int numSubharmonics = 0;
-    double level = 0.0;
-    double tailOff = 0.0;
+    std::atomic<int> numUnisonVoices { 1 };
+    float level = 0.0f;
     juce::ADSR adsr;
 
+    // Cutoff in Hz, moved by the filter envelope (in semitones at full level) and
+    // by key tracking (1 = follows the keyboard exactly, around middle C)
+    struct FilterSettings
+    {
+        float cutoff = 20000.0f;
+        float envelopeAmount = 0.0f;
+        float keyTracking = 0.0f;
+        juce::ADSR::Parameters envelopeParameters;
+    };
+
+    // The setters' copy, and the mailbox the audio thread adopts it from
+    FilterSettings filterSettingsToPublish;
+    SnapshotMailbox<FilterSettings> filterSettings;
+
+    juce::ADSR filterEnvelope;
+    int currentNoteNumber = 60;
+
+    // Block position at which the latest note restarts the filter, or -1
+    int filterResetPosition = 0;
+
+    // LFOs and the modulation envelope, evaluated once per render chunk
+    Modulation::Matrix modulation;
+
+    // Filter modulation in semitones for the chunk being rendered
+    float currentFilterModulation = 0.0f;
+
+    // The cutoff for each control block of the current block the voice has sounded in
+    std::array<float, VoiceFilterBank::maxBlockSize / VoiceFilterBank::controlBlockSize> filterCutoffs {};
+    int numFilterCutoffs = 0;
+    int nextFilterCutoffPosition = 0;
+    float lastFilterCutoff = 20000.0f;
+
+    // Where the voice has rendered up to in the current block, and what the scheduler
+    // shares with it; no schedule outside ArmonioSynthesiser's blocks
+    int blockPosition = 0;
+    bool soundedInBlock = false;
+    const VoiceSchedule* schedule = nullptr;
+    float* laneLeft = nullptr;
+    float* laneRight = nullptr;
+    int laneStride = 1;
+    int nextModWheelEvent = 0;
+
     // NEW: Anti-click fade-in envelope (independent of ADSR)
     int antiClickSamplesRemaining = 0;
     int antiClickSamplesTotal = 0;
@@ -0,0 +1,283 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+#include <thread>
+
+//==============================================================================
+class AdditiveOscillatorTests final : public juce::UnitTest
+{
+public:
+    AdditiveOscillatorTests() : juce::UnitTest("AdditiveOscillator", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr float sampleRate = 48000.0f;
+        constexpr int chunkSize = 32;
+
+        beginTest("Partials match the harmonics of the equivalent table");
+        {
+            // 480 Hz repeats every 100 samples, so one period can be compared bin for bin
+            constexpr int period = 100;
+
+            for (int waveform : { 0, 2, 3 })
+            {
+                for (int numHarmonics : { 1, 5, 16 })
+                {
+                    auto table = WaveformGenerator::createWaveform(waveform, SynthAudioSource::wavetableSize, numHarmonics,
+                                                                   SynthAudioSource::referenceFrequency, sampleRate);
+
+                    FastRandom random;
+                    AdditiveOscillator oscillator;
+                    oscillator.setSpectrum(Additive::createSpectrum(waveform, numHarmonics));
+                    oscillator.startNote(480.0f, sampleRate, 0, random);
+
+                    std::vector<float> output(10 * period);
+                    for (int offset = 0; offset < (int)output.size(); offset += chunkSize)
+                        oscillator.render(output.data() + offset, juce::jmin(chunkSize, (int)output.size() - offset), 1.0f, 0.0f, 1.0f);
+
+                    for (int harmonic = 1; harmonic <= 31; ++harmonic)
+                    {
+                        const auto expected = TestHelpers::harmonicMagnitude(table.getReadPointer(0), (int)SynthAudioSource::wavetableSize, harmonic);
+                        const auto measured = TestHelpers::harmonicMagnitude(output.data() + output.size() - period, period, harmonic);
+
+                        expectWithinAbsoluteError(measured, expected, 1.0e-3,
+                                                  "waveform " + juce::String(waveform) + ", " + juce::String(numHarmonics)
+                                                  + " harmonics, partial " + juce::String(harmonic));
+                    }
+                }
+            }
+        }
+
+        beginTest("Partials above Nyquist are left out");
+        {
+            constexpr int fftOrder = 14;
+            constexpr int fftSize = 1 << fftOrder;
+
+            // A 3 kHz square with 16 odd harmonics reaches 93 kHz; a table built for
+            // middle C would fold most of them back down
+            FastRandom random;
+            AdditiveOscillator oscillator;
+            oscillator.setSpectrum(Additive::createSpectrum(2, 16));
+            oscillator.startNote(3000.0f, sampleRate, 0, random);
+
+            std::vector<float> output((size_t)fftSize);
+            for (int offset = 0; offset < fftSize; offset += chunkSize)
+                oscillator.render(output.data() + offset, chunkSize, 1.0f, 0.0f, 1.0f);
+
+            expectLessThan(TestHelpers::measureInharmonicEnergyDb(output.data(), fftOrder, 3000.0, sampleRate), -80.0);
+        }
+
+        beginTest("Phasors keep their length over a minute");
+        {
+            // Every partial and subharmonic repeats within 300 samples
+            constexpr int window = 300;
+
+            FastRandom random;
+            random.setSeed(5);
+
+            AdditiveOscillator oscillator;
+            oscillator.setSpectrum(Additive::createSpectrum(2, 16));
+            oscillator.startNote(480.0f, sampleRate, 2, random);
+
+            std::array<float, window> output {};
+            auto energy = [&]
+            {
+                for (int offset = 0; offset < window; offset += 30)
+                    oscillator.render(output.data() + offset, 30, 1.0f, 0.0f, 1.0f);
+
+                return TestHelpers::rms(output.data(), window);
+            };
+
+            const auto initial = energy();
+
+            for (int i = 0; i < (int)sampleRate * 60 / window; ++i)
+                energy();
+
+            expectWithinAbsoluteError(energy() / initial, 1.0, 1.0e-4);
+        }
+
+        beginTest("Amplitude changes ramp linearly across a render call");
+        {
+            // Three notes with the same phases: with a subharmonic held, with it fading
+            // out over the second call, and without it at all
+            auto start = [&](AdditiveOscillator& oscillator, int numSubharmonics)
+            {
+                FastRandom random;
+                random.setSeed(9);
+                oscillator.setSpectrum(Additive::createSpectrum(3, 4));
+                oscillator.startNote(300.0f, sampleRate, numSubharmonics, random);
+            };
+
+            AdditiveOscillator held, fading, without;
+            start(held, 1);
+            start(fading, 1);
+            start(without, 0);
+
+            std::array<float, chunkSize> heldOutput {}, fadingOutput {}, withoutOutput {};
+
+            held.render(heldOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+            fading.render(fadingOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+            without.render(withoutOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+
+            held.render(heldOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+            fading.render(fadingOutput.data(), chunkSize, 1.0f, 0.0f, 0.0f);
+            without.render(withoutOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+
+            for (int n = 0; n < chunkSize; ++n)
+            {
+                const auto subharmonic = heldOutput[(size_t)n] - withoutOutput[(size_t)n];
+                const auto expected = withoutOutput[(size_t)n] + subharmonic * (1.0f - (float)n / (float)chunkSize);
+
+                expectWithinAbsoluteError(fadingOutput[(size_t)n], expected, 1.0e-5f);
+            }
+
+            // Once faded, only the harmonics are left
+            fading.render(fadingOutput.data(), chunkSize, 1.0f, 0.0f, 0.0f);
+            without.render(withoutOutput.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+
+            for (int n = 0; n < chunkSize; ++n)
+                expectWithinAbsoluteError(fadingOutput[(size_t)n], withoutOutput[(size_t)n], 1.0e-5f);
+        }
+
+        beginTest("Spectra set from another thread arrive whole, the latest one last");
+        {
+            constexpr int period = 100;
+
+            auto table = WaveformGenerator::createWaveform(2, SynthAudioSource::wavetableSize, 16,
+                                                           SynthAudioSource::referenceFrequency, sampleRate);
+
+            FastRandom random;
+            AdditiveOscillator oscillator;
+            oscillator.startNote(480.0f, sampleRate, 0, random);
+
+            std::atomic<bool> isWriting { true };
+            std::thread writer([&]
+            {
+                const auto sine = Additive::createSpectrum(0, 1);
+                const auto triangle = Additive::createSpectrum(3, 32);
+
+                for (int i = 0; i < 20000; ++i)
+                    oscillator.setSpectrum(i % 2 == 0 ? triangle : sine);
+
+                oscillator.setSpectrum(Additive::createSpectrum(2, 16));
+                isWriting = false;
+            });
+
+            std::array<float, chunkSize> chunk {};
+            while (isWriting)
+                oscillator.render(chunk.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+
+            writer.join();
+
+            // One call to ramp over, then the square alone
+            std::vector<float> output(10 * period);
+            oscillator.render(chunk.data(), chunkSize, 1.0f, 0.0f, 1.0f);
+
+            for (int offset = 0; offset < (int)output.size(); offset += chunkSize)
+                oscillator.render(output.data() + offset, juce::jmin(chunkSize, (int)output.size() - offset), 1.0f, 0.0f, 1.0f);
+
+            for (int harmonic = 1; harmonic <= 31; ++harmonic)
+            {
+                const auto expected = TestHelpers::harmonicMagnitude(table.getReadPointer(0), (int)SynthAudioSource::wavetableSize, harmonic);
+                const auto measured = TestHelpers::harmonicMagnitude(output.data() + output.size() - period, period, harmonic);
+
+                expectWithinAbsoluteError(measured, expected, 1.0e-3, "partial " + juce::String(harmonic));
+            }
+        }
+
+        beginTest("Changing the harmonics reshapes a playing note without touching the bank");
+        {
+            constexpr int blockSize = 8192;
+
+            juce::SharedResourcePointer<WavetableBank> bank;
+            juce::MidiKeyboardState keyboardState;
+
+            SynthAudioSource source(keyboardState);
+            source.setOscillatorEngine(SynthAudioSource::additiveEngine);
+            source.setWaveform(2);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(blockSize, sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            juce::MidiBuffer midi;
+            midi.addEvent(juce::MidiMessage::noteOn(1, 69, (juce::uint8)100), 0);
+            source.getNextAudioBlock(info, midi);
+
+            // A lone sine at 440 Hz, so nothing at its third harmonic yet
+            const auto thirdBefore = TestHelpers::magnitudeAt(buffer.getReadPointer(0), blockSize, 1320.0, sampleRate);
+            const auto requestsBefore = bank->getStats().numRequests;
+
+            for (int numHarmonics = 2; numHarmonics <= 16; ++numHarmonics)
+                source.setNumHarmonics(numHarmonics);
+
+            expectEquals(bank->getStats().numRequests, requestsBefore);
+
+            juce::MidiBuffer noMidi;
+            source.getNextAudioBlock(info, noMidi);
+
+            const auto thirdAfter = TestHelpers::magnitudeAt(buffer.getReadPointer(0), blockSize, 1320.0, sampleRate);
+            expectGreaterThan(thirdAfter, 0.005);
+            expectGreaterThan(thirdAfter, thirdBefore * 100.0);
+        }
+    }
+};
+
+static AdditiveOscillatorTests additiveOscillatorTests;
+
+//==============================================================================
+// A full voice load of additive partials, steady and with the pitch moving every
+// chunk, which recomputes every rotation.
+class AdditiveOscillatorBenchmark final : public juce::UnitTest
+{
+public:
+    AdditiveOscillatorBenchmark() : juce::UnitTest("Additive oscillator bank", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr float sampleRate = 48000.0f;
+        constexpr int chunkSize = 32;
+        constexpr int numVoices = 16;
+        constexpr int numSamplesToRender = (int)sampleRate * 10;
+
+        beginTest("16 voices x 32 partials");
+
+        for (auto isPitchModulated : { false, true })
+        {
+            std::array<AdditiveOscillator, numVoices> voices;
+            FastRandom random;
+
+            // Low notes, so that all 32 partials stay below Nyquist
+            for (int i = 0; i < numVoices; ++i)
+            {
+                voices[(size_t)i].setSpectrum(Additive::createSpectrum(0, Additive::maxHarmonics));
+                voices[(size_t)i].startNote(40.0f + 2.0f * (float)i, sampleRate, 0, random);
+            }
+
+            std::array<float, chunkSize> output {};
+            auto sink = 0.0f;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += chunkSize)
+            {
+                const auto pitchRatio = isPitchModulated ? 1.0f + 0.01f * (float)((rendered / chunkSize) % 16) : 1.0f;
+
+                for (auto& voice : voices)
+                {
+                    voice.render(output.data(), chunkSize, pitchRatio, 0.0f, 1.0f);
+                    sink += output[0];
+                }
+            }
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            expect(std::isfinite(sink));
+
+            logMessage(juce::String(isPitchModulated ? "pitch moving: " : "steady:       ")
+                       + juce::String(numSamplesToRender / sampleRate / seconds, 1) + "x realtime, "
+                       + juce::String(seconds * 1.0e9 / ((double)numSamplesToRender * numVoices * Additive::maxHarmonics), 2)
+                       + " ns per partial sample");
+        }
+    }
+};
+
+static AdditiveOscillatorBenchmark additiveOscillatorBenchmark;
@@ -0,0 +1,461 @@
+#include "TestHelpers.h"
+#include "EffectsBus.h"
+#include <thread>
+
+//==============================================================================
+namespace
+{
+    // Decaying noise, so the tail segments carry less than the head as in a real room
+    juce::AudioBuffer<float> makeImpulseResponse(int numChannels, int numSamples, juce::uint64 seed)
+    {
+        juce::AudioBuffer<float> impulse(numChannels, numSamples);
+        FastRandom random;
+        random.setSeed(seed);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numSamples; ++i)
+                impulse.setSample(ch, i, (2.0f * random.nextFloat() - 1.0f) * std::exp(-4.0f * (float)i / (float)numSamples));
+
+        return impulse;
+    }
+
+    // Runs a convolver over the input in blocks whose sizes are drawn from the given range
+    std::vector<float> convolveInBlocks(PartitionedConvolver& convolver, int channel, const std::vector<float>& input,
+                                        int minBlockSize, int maxBlockSize, juce::uint64 seed)
+    {
+        std::vector<float> output(input.size());
+        FastRandom random;
+        random.setSeed(seed);
+
+        for (int start = 0; start < (int)input.size();)
+        {
+            const auto blockSize = juce::jmin((int)input.size() - start,
+                                              minBlockSize + (int)(random.nextFloat() * (float)(maxBlockSize - minBlockSize + 1)));
+            convolver.process(channel, input.data() + start, output.data() + start, blockSize);
+            start += blockSize;
+        }
+
+        return output;
+    }
+
+    // Lets the bus swap in its impulse response as a host's callbacks would
+    bool waitUntilReady(EffectsBus& bus, int blockSize)
+    {
+        juce::AudioBuffer<float> silence(2, blockSize);
+
+        for (int attempt = 0; attempt < 5000; ++attempt)
+        {
+            silence.clear();
+            bus.process(silence, 0, blockSize, true);
+
+            if (bus.isReverbReady())
+                return true;
+
+            juce::Thread::sleep(1);
+        }
+
+        return false;
+    }
+}
+
+//==============================================================================
+class ConvolutionReverbTests final : public juce::UnitTest
+{
+public:
+    ConvolutionReverbTests() : juce::UnitTest("ConvolutionReverb", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        beginTest("Partitioned convolution matches direct convolution");
+        {
+            // Long enough to use the head and three segments
+            constexpr int numTaps = 12000;
+            constexpr int numSamples = 16000;
+
+            auto impulse = makeImpulseResponse(2, numTaps, 7);
+            PartitionedConvolver convolver(impulse, 2);
+            expectEquals(convolver.getImpulseLength(), numTaps);
+
+            FastRandom random;
+            random.setSeed(3);
+            std::vector<float> input((size_t)numSamples);
+
+            for (auto& sample : input)
+                sample = 2.0f * random.nextFloat() - 1.0f;
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                const auto output = convolveInBlocks(convolver, ch, input, 1, 700, 11 + (juce::uint64)ch);
+                const auto* taps = impulse.getReadPointer(ch);
+                double maxError = 0.0, peak = 0.0;
+
+                for (int n = 0; n < numSamples; ++n)
+                {
+                    double expected = 0.0;
+
+                    for (int k = 0; k <= juce::jmin(n, numTaps - 1); ++k)
+                        expected += (double)taps[k] * input[(size_t)(n - k)];
+
+                    maxError = juce::jmax(maxError, std::abs(expected - output[(size_t)n]));
+                    peak = juce::jmax(peak, std::abs(expected));
+                }
+
+                expectLessThan(maxError / peak, 1.0e-4);
+            }
+        }
+
+        beginTest("An impulse comes back as the response with no latency");
+        {
+            constexpr int numTaps = 3000;
+            auto impulse = makeImpulseResponse(1, numTaps, 5);
+            PartitionedConvolver convolver(impulse, 1);
+
+            std::vector<float> input((size_t)(numTaps + 200), 0.0f);
+            input[0] = 1.0f;
+
+            const auto output = convolveInBlocks(convolver, 0, input, 37, 37, 1);
+
+            for (int n = 0; n < numTaps; ++n)
+                expectWithinAbsoluteError(output[(size_t)n], impulse.getSample(0, n), 1.0e-5f);
+
+            // After reset nothing of the previous input is left
+            convolver.reset();
+            std::fill(input.begin(), input.end(), 0.0f);
+            const auto silent = convolveInBlocks(convolver, 0, input, 64, 512, 2);
+            expect(std::all_of(silent.begin(), silent.end(), [](float sample) { return sample == 0.0f; }));
+        }
+
+        beginTest("The bus builds its response off the audio thread and adds the tail");
+        {
+            constexpr int blockSize = 256;
+
+            EffectsBus bus;
+            bus.setReverbSize(0.5f);
+            bus.setReverbSend(1.0f);
+            bus.prepare(sampleRate, blockSize);
+            expect(waitUntilReady(bus, blockSize));
+            expectWithinAbsoluteError(bus.getTailLengthSeconds(), 0.5, 0.01);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            buffer.clear();
+            buffer.setSample(0, 0, 1.0f);
+            buffer.setSample(1, 0, 1.0f);
+            expect(bus.process(buffer, 0, blockSize, false));
+            expectGreaterThan(buffer.getMagnitude(0, 1, blockSize - 1), 0.0f);
+
+            // Silent input keeps the tail going until it has rung out, then stops
+            auto numBlocksWithOutput = 0;
+
+            for (int block = 0; block < 200; ++block)
+            {
+                buffer.clear();
+
+                if (bus.process(buffer, 0, blockSize, true))
+                    ++numBlocksWithOutput;
+            }
+
+            expectGreaterThan(numBlocksWithOutput, (int)(0.5 * sampleRate / blockSize) - 1);
+            expectLessThan(numBlocksWithOutput, 200);
+
+            // With no send nothing is added
+            bus.setReverbSend(0.0f);
+            buffer.clear();
+            buffer.setSample(0, 0, 1.0f);
+            expect(! bus.process(buffer, 0, blockSize, false));
+        }
+
+        beginTest("Size and sharing set off the message thread wait for applySettings()");
+        {
+            constexpr int blockSize = 256;
+
+            EffectsBus owner, member;
+
+            for (auto* bus : { &owner, &member })
+            {
+                bus->setReverbSize(0.5f);
+                bus->setReverbSend(1.0f);
+                bus->prepare(sampleRate, blockSize);
+                expect(waitUntilReady(*bus, blockSize));
+            }
+
+            owner.setSharedReverb(true);
+
+            // As host automation would, from a thread that is not the message thread
+            std::thread([&]
+            {
+                member.setReverbSize(1.0f);
+                member.setSharedReverb(true);
+            }).join();
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            buffer.clear();
+            buffer.setSample(0, 0, 1.0f);
+
+            expect(waitUntilReady(member, blockSize));
+            expectWithinAbsoluteError(member.getTailLengthSeconds(), 0.5, 0.01);
+            expect(member.process(buffer, 0, blockSize, false));
+
+            member.applySettings();
+
+            expect(waitUntilReady(member, blockSize));
+            expectWithinAbsoluteError(member.getTailLengthSeconds(), 1.0, 0.01);
+            expect(! member.process(buffer, 0, blockSize, false));
+
+            owner.setSharedReverb(false);
+            member.setSharedReverb(false);
+        }
+
+        beginTest("A shared reverb is returned only by its owner");
+        {
+            constexpr int blockSize = 128;
+
+            EffectsBus owner, member;
+
+            for (auto* bus : { &owner, &member })
+            {
+                bus->setReverbSize(0.3f);
+                bus->setReverbSend(1.0f);
+                bus->setSharedReverb(true);
+                bus->prepare(sampleRate, blockSize);
+            }
+
+            expect(waitUntilReady(owner, blockSize));
+            expect(waitUntilReady(member, blockSize));
+
+            juce::AudioBuffer<float> memberBuffer(2, blockSize);
+            memberBuffer.clear();
+            memberBuffer.setSample(0, 0, 1.0f);
+            memberBuffer.setSample(1, 0, 1.0f);
+            expect(! member.process(memberBuffer, 0, blockSize, false));
+            expectEquals(memberBuffer.getMagnitude(0, 1, blockSize - 1), 0.0f);
+
+            // The member ran first, so its send comes back in the owner's next block
+            juce::AudioBuffer<float> ownerBuffer(2, blockSize);
+            ownerBuffer.clear();
+            owner.process(ownerBuffer, 0, blockSize, true);
+            expectEquals(ownerBuffer.getMagnitude(0, 0, blockSize), 0.0f);
+
+            ownerBuffer.clear();
+            expect(owner.process(ownerBuffer, 0, blockSize, true));
+            expectGreaterThan(ownerBuffer.getMagnitude(0, 0, blockSize), 0.0f);
+
+            // Once the owner leaves, the other member takes over
+            owner.setSharedReverb(false);
+            memberBuffer.clear();
+            memberBuffer.setSample(0, 0, 1.0f);
+            expect(member.process(memberBuffer, 0, blockSize, false));
+            member.setSharedReverb(false);
+        }
+
+        beginTest("Shared sends come back once each, whichever instance runs first");
+        {
+            constexpr int blockSize = 128;
+            constexpr int numBlocks = 300;
+
+            // The owner returns the member's sends; the separate reverb gets the same
+            // input one block late, as the shared send delivers it
+            EffectsBus owner, member, separate;
+
+            for (auto* bus : { &owner, &member, &separate })
+            {
+                bus->setReverbSize(0.3f);
+                bus->setReverbSend(1.0f);
+                bus->prepare(sampleRate, blockSize);
+            }
+
+            owner.setSharedReverb(true);
+            member.setSharedReverb(true);
+
+            for (auto* bus : { &owner, &member, &separate })
+                expect(waitUntilReady(*bus, blockSize));
+
+            juce::Random random(42);
+            juce::AudioBuffer<float> input(2, blockSize), previousInput(2, blockSize);
+            juce::AudioBuffer<float> memberBuffer(2, blockSize), ownerBuffer(2, blockSize), separateBuffer(2, blockSize);
+            previousInput.clear();
+
+            auto maxError = 0.0f;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        input.setSample(ch, i, random.nextFloat() - 0.5f);
+
+                // The member renders its block in two pieces of varying size
+                auto runMember = [&]
+                {
+                    memberBuffer.makeCopyOf(input);
+                    const auto split = random.nextInt(blockSize);
+                    member.process(memberBuffer, 0, split, false);
+                    member.process(memberBuffer, split, blockSize - split, false);
+                };
+
+                auto runOwner = [&]
+                {
+                    ownerBuffer.clear();
+                    owner.process(ownerBuffer, 0, blockSize, true);
+                };
+
+                // The first block fixes the latency at one block
+                if (block == 0 || random.nextBool())
+                {
+                    runMember();
+                    runOwner();
+                }
+                else
+                {
+                    runOwner();
+                    runMember();
+                }
+
+                separateBuffer.makeCopyOf(previousInput);
+                separate.process(separateBuffer, 0, blockSize, false);
+
+                for (int ch = 0; ch < 2; ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        maxError = juce::jmax(maxError, std::abs(ownerBuffer.getSample(ch, i)
+                                                                 - (separateBuffer.getSample(ch, i) - previousInput.getSample(ch, i))));
+
+                previousInput.makeCopyOf(input);
+            }
+
+            expectLessThan(maxError, 1.0e-4f);
+
+            owner.setSharedReverb(false);
+            member.setSharedReverb(false);
+        }
+    }
+};
+
+static ConvolutionReverbTests convolutionReverbTests;
+
+//==============================================================================
+// Callback cost of the reverb per second of impulse response, its worst single
+// callback, and eight instances sharing one reverb against each running its own.
+class ConvolutionReverbBenchmark final : public juce::UnitTest
+{
+public:
+    ConvolutionReverbBenchmark() : juce::UnitTest("Convolution reverb", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 128;
+        constexpr int numSamples = 48000 * 10;
+
+        beginTest("CPU per second of impulse response");
+        {
+            FastRandom random;
+            std::vector<float> input((size_t)blockSize), output((size_t)blockSize);
+
+            for (auto seconds : { 0.5, 1.0, 2.0, 4.0, 8.0 })
+            {
+                PartitionedConvolver convolver(makeImpulseResponse(2, (int)(seconds * sampleRate), 1), 2);
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int n = 0; n < numSamples; n += blockSize)
+                {
+                    for (auto& sample : input)
+                        sample = 2.0f * random.nextFloat() - 1.0f;
+
+                    for (int ch = 0; ch < 2; ++ch)
+                        convolver.process(ch, input.data(), output.data(), blockSize);
+                }
+
+                auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                auto cpuPercent = elapsed * sampleRate / numSamples * 100.0;
+
+                logMessage(juce::String(seconds, 1) + " s stereo: " + juce::String(cpuPercent, 2) + "% CPU, "
+                           + juce::String(cpuPercent / seconds, 2) + "% per second of response");
+            }
+        }
+
+        // The average hides the callbacks that complete a large segment's block
+        beginTest("Worst single callback");
+        {
+            FastRandom random;
+            std::vector<float> input((size_t)blockSize), output((size_t)blockSize);
+            const auto callbackPeriod = blockSize / sampleRate;
+
+            for (auto seconds : { 0.5, 2.0, 8.0 })
+            {
+                PartitionedConvolver convolver(makeImpulseResponse(2, (int)(seconds * sampleRate), 1), 2);
+                double worst = 0.0;
+
+                for (int n = 0; n < numSamples; n += blockSize)
+                {
+                    for (auto& sample : input)
+                        sample = 2.0f * random.nextFloat() - 1.0f;
+
+                    auto start = juce::Time::getHighResolutionTicks();
+
+                    for (int ch = 0; ch < 2; ++ch)
+                        convolver.process(ch, input.data(), output.data(), blockSize);
+
+                    worst = juce::jmax(worst, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+                }
+
+                logMessage(juce::String(seconds, 1) + " s stereo: worst callback " + juce::String(worst * 1.0e6, 1) + " us, "
+                           + juce::String(worst / callbackPeriod * 100.0, 1) + "% of its " + juce::String(blockSize) + "-sample period");
+            }
+        }
+
+        beginTest("Eight instances, shared and separate");
+        {
+            constexpr int numInstances = 8;
+
+            auto timeInstances = [&](bool shared)
+            {
+                std::vector<std::unique_ptr<EffectsBus>> buses;
+
+                for (int i = 0; i < numInstances; ++i)
+                {
+                    buses.push_back(std::make_unique<EffectsBus>());
+                    buses.back()->setReverbSize(2.0f);
+                    buses.back()->setReverbSend(0.3f);
+                    buses.back()->setSharedReverb(shared);
+                    buses.back()->prepare(sampleRate, blockSize);
+                }
+
+                for (auto& bus : buses)
+                    waitUntilReady(*bus, blockSize);
+
+                FastRandom random;
+                juce::AudioBuffer<float> buffer(2, blockSize);
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int n = 0; n < numSamples / 4; n += blockSize)
+                {
+                    for (auto& bus : buses)
+                    {
+                        for (int i = 0; i < blockSize; ++i)
+                            buffer.setSample(0, i, 2.0f * random.nextFloat() - 1.0f);
+
+                        buffer.copyFrom(1, 0, buffer, 0, 0, blockSize);
+                        bus->process(buffer, 0, blockSize, false);
+                    }
+                }
+
+                auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+                for (auto& bus : buses)
+                    bus->setSharedReverb(false);
+
+                return elapsed * sampleRate / (numSamples / 4) * 100.0;
+            };
+
+            auto separate = timeInstances(false);
+            auto shared = timeInstances(true);
+
+            logMessage("2 s response, " + juce::String(numInstances) + " instances: "
+                       + juce::String(separate, 2) + "% CPU separate, " + juce::String(shared, 2) + "% CPU shared");
+        }
+    }
+};
+
+static ConvolutionReverbBenchmark convolutionReverbBenchmark;
@@ -0,0 +1,270 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+namespace
+{
+    struct ScheduledSynth
+    {
+        explicit ScheduledSynth(double sampleRate, const Modulation::Settings& modulation = {})
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                auto* voice = new WavetableVoice();
+                voice->setRandomSeed(1, i, true);
+                voice->setModulationSettings(modulation);
+                voice->setNumSubharmonics(1);
+                synth.addVoice(voice);
+            }
+
+            synth.addSound(new WavetableSound(bank->getTable(1, 8, SynthAudioSource::wavetableSize, sampleRate)));
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+            synth.setFilterResonance(0.3f);
+        }
+
+        juce::AudioBuffer<float> render(const juce::MidiBuffer& midi, int numSamples, bool isScheduled)
+        {
+            juce::AudioBuffer<float> buffer(2, numSamples);
+            buffer.clear();
+
+            if (isScheduled)
+                synth.renderNextBlockScheduled(buffer, midi, 0, numSamples);
+            else
+                synth.renderNextBlock(buffer, midi, 0, numSamples);
+
+            return buffer;
+        }
+
+        juce::SharedResourcePointer<WavetableBank> bank;
+        ArmonioSynthesiser synth;
+    };
+
+    // A roll of short notes over a held chord, each on a fresh voice, with the mod
+    // wheel moving all the while
+    juce::MidiBuffer createDenseMidi(int numSamples, int spacing)
+    {
+        juce::MidiBuffer midi;
+
+        for (int i = 0; i < 3; ++i)
+            midi.addEvent(juce::MidiMessage::noteOn(1, 48 + i * 4, (juce::uint8)90), 0);
+
+        for (int position = 5, i = 0; position < numSamples; position += spacing, ++i)
+        {
+            const auto note = 60 + i % 12;
+
+            if (i < 12)
+                midi.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8)(60 + i * 5)), position);
+            else
+                midi.addEvent(juce::MidiMessage::noteOff(1, note), position);
+
+            midi.addEvent(juce::MidiMessage::controllerEvent(1, 1, (i * 11) % 128), position + spacing / 2);
+        }
+
+        return midi;
+    }
+}
+
+//==============================================================================
+class EventSchedulerTests final : public juce::UnitTest
+{
+public:
+    EventSchedulerTests() : juce::UnitTest("EventScheduler", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numSamples = 1024;
+
+        beginTest("Dense MIDI renders the same as splitting the block at every event");
+        {
+            // Without modulation, the control-rate work does not depend on where the
+            // voices were split, so both ways must agree sample for sample
+            const auto midi = createDenseMidi(numSamples, 37);
+
+            ScheduledSynth split(sampleRate), scheduled(sampleRate);
+            const auto expected = split.render(midi, numSamples, false);
+            const auto rendered = scheduled.render(midi, numSamples, true);
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int n = 0; n < numSamples; ++n)
+                    expectWithinAbsoluteError(rendered.getSample(ch, n), expected.getSample(ch, n), 1.0e-6f);
+        }
+
+        beginTest("Notes start on their exact sample");
+        {
+            for (auto offset : { 1, 31, 32, 77, 127, 128, 700 })
+            {
+                juce::MidiBuffer midi;
+                midi.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8)100), offset);
+
+                ScheduledSynth synth(sampleRate);
+                const auto rendered = synth.render(midi, numSamples, true);
+
+                expectEquals(TestHelpers::rms(rendered.getReadPointer(0), offset), 0.0, "offset " + juce::String(offset));
+                expectGreaterThan(TestHelpers::rms(rendered.getReadPointer(0, offset), 32), 0.0, "offset " + juce::String(offset));
+            }
+        }
+
+        beginTest("Mod wheel moves take effect at the next ramp");
+        {
+            // The mod wheel turns the level down to nothing
+            Modulation::Settings settings;
+            settings.slots[0] = { Modulation::modWheel, Modulation::level, -1.0f };
+
+            juce::MidiBuffer noteOnly;
+            noteOnly.addEvent(juce::MidiMessage::noteOn(1, 69, (juce::uint8)100), 0);
+
+            auto withWheel = noteOnly;
+            withWheel.addEvent(juce::MidiMessage::controllerEvent(1, 1, 127), 100);
+
+            ScheduledSynth reference(sampleRate, settings), moved(sampleRate, settings);
+            const auto expected = reference.render(noteOnly, numSamples, true);
+            const auto rendered = moved.render(withWheel, numSamples, true);
+
+            // Untouched up to the ramp starting at sample 128, which fades to silence
+            for (int n = 0; n < 128; ++n)
+                expectEquals(rendered.getSample(0, n), expected.getSample(0, n));
+
+            expectLessThan(TestHelpers::rms(rendered.getReadPointer(0, 192), numSamples - 192),
+                           TestHelpers::rms(expected.getReadPointer(0, 192), numSamples - 192) * 0.01);
+        }
+
+        beginTest("A note started after the wheel has moved picks it up");
+        {
+            Modulation::Settings settings;
+            settings.slots[0] = { Modulation::modWheel, Modulation::level, -1.0f };
+
+            juce::MidiBuffer wheel;
+            wheel.addEvent(juce::MidiMessage::controllerEvent(1, 1, 127), 0);
+
+            juce::MidiBuffer note;
+            note.addEvent(juce::MidiMessage::noteOn(1, 69, (juce::uint8)100), 10);
+
+            ScheduledSynth synth(sampleRate, settings);
+            synth.render(wheel, numSamples, true);
+            const auto rendered = synth.render(note, numSamples, true);
+
+            expectLessThan(TestHelpers::rms(rendered.getReadPointer(0), numSamples), 1.0e-4);
+        }
+
+        beginTest("A new sound reaches the next note and is freed off the audio thread");
+        {
+            struct TrackedSound final : public WavetableSound
+            {
+                TrackedSound(WavetableBank::TablePtr table, bool& flag) : WavetableSound(std::move(table)), freed(flag) {}
+                ~TrackedSound() override { freed = true; }
+                bool& freed;
+            };
+
+            ScheduledSynth synth(sampleRate);
+            const auto sine = synth.bank->getTable(0, 1, SynthAudioSource::wavetableSize, sampleRate);
+
+            bool firstFreed = false;
+            auto* first = new TrackedSound(sine, firstFreed);
+            synth.synth.setSound(first);
+
+            // Waits for a note-on, and then takes the one slot
+            expect(synth.synth.getSound(0).get() != first);
+
+            juce::MidiBuffer midi;
+            midi.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8)100), 0);
+            synth.render(midi, numSamples, true);
+
+            expectEquals(synth.synth.getNumSounds(), 1);
+            expect(synth.synth.getSound(0).get() == first);
+
+            // The held note keeps the sound it started with
+            synth.synth.setSound(new WavetableSound(sine));
+            midi.clear();
+            midi.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8)100), 0);
+            synth.render(midi, numSamples, true);
+
+            expectEquals(synth.synth.getNumSounds(), 1);
+            expect(synth.synth.getSound(0).get() != first);
+            expect(! firstFreed);
+
+            midi.clear();
+            midi.addEvent(juce::MidiMessage::allNotesOff(1), 0);
+
+            for (int block = 0; block < 100; ++block)
+            {
+                synth.render(midi, numSamples, true);
+                midi.clear();
+            }
+
+            expect(! firstFreed);
+
+            // Nothing plays it any more, so the next call frees it
+            synth.synth.setSound(new WavetableSound(sine));
+            expect(firstFreed);
+        }
+    }
+};
+
+static EventSchedulerTests eventSchedulerTests;
+
+//==============================================================================
+// Throughput with MIDI-heavy input, splitting the block at every event against the
+// scheduler, for increasingly dense streams of notes and mod wheel moves.
+class EventSchedulerBenchmark final : public juce::UnitTest
+{
+public:
+    EventSchedulerBenchmark() : juce::UnitTest("Event scheduler", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 512;
+        constexpr int numBlocks = 2000;
+
+        beginTest("x realtime with dense MIDI, 512-sample blocks");
+
+        for (auto spacing : { 512, 64, 16, 4 })
+        {
+            double speeds[2] {};
+
+            for (auto isScheduled : { false, true })
+            {
+                ScheduledSynth synth(sampleRate);
+
+                // Keeps every voice busy: each note is released a block after it starts
+                juce::MidiBuffer midi;
+                for (int position = 0, i = 0; position < blockSize; position += spacing, ++i)
+                {
+                    midi.addEvent(juce::MidiMessage::noteOn(1, 40 + (i * 7) % 48, (juce::uint8)100), position);
+                    midi.addEvent(juce::MidiMessage::controllerEvent(1, 1, (i * 13) % 128), position + spacing / 2);
+                }
+
+                juce::MidiBuffer releases;
+                for (const auto metadata : midi)
+                    if (metadata.getMessage().isNoteOn())
+                        releases.addEvent(juce::MidiMessage::noteOff(1, metadata.getMessage().getNoteNumber()),
+                                          metadata.samplePosition);
+
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    buffer.clear();
+
+                    // Alternates between starting notes and releasing them
+                    const auto& events = block % 2 == 0 ? midi : releases;
+
+                    if (isScheduled)
+                        synth.synth.renderNextBlockScheduled(buffer, events, 0, blockSize);
+                    else
+                        synth.synth.renderNextBlock(buffer, events, 0, blockSize);
+                }
+
+                auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                speeds[isScheduled ? 1 : 0] = numBlocks * blockSize / sampleRate / seconds;
+            }
+
+            logMessage("An event every " + juce::String(spacing).paddedLeft(' ', 3) + " samples: split "
+                       + juce::String(speeds[0], 1) + "x, scheduled " + juce::String(speeds[1], 1) + "x realtime");
+        }
+    }
+};
+
+static EventSchedulerBenchmark eventSchedulerBenchmark;
@@ -0,0 +1,213 @@
+#include "SynthAudioSource.h"
+
+//==============================================================================
+class KeyboardEventQueueTests final : public juce::UnitTest
+{
+public:
+    KeyboardEventQueueTests() : juce::UnitTest("KeyboardEventQueue", "Armonio") {}
+
+    void runTest() override
+    {
+        beginTest("Events come out in order and a full queue drops new ones");
+        {
+            KeyboardEventQueue queue;
+            int numPushed = 0;
+
+            for (int i = 0; i < KeyboardEventQueue::capacity + 10; ++i)
+                if (queue.push(juce::MidiMessage::noteOn(1, i % 128, (juce::uint8)100), (double)i))
+                    ++numPushed;
+
+            expectEquals(numPushed, KeyboardEventQueue::capacity - 1);
+
+            int numPopped = 0;
+            queue.popAll([&](const KeyboardEventQueue::Event& event)
+            {
+                expectEquals((int)event.data[1], numPopped % 128);
+                expectEquals(event.timeMs, (double)numPopped);
+                ++numPopped;
+            });
+
+            expectEquals(numPopped, numPushed);
+            expect(queue.isEmpty());
+        }
+
+        beginTest("Merging spreads events across the block by arrival time");
+        {
+            KeyboardEventQueue queue;
+            juce::MidiBuffer midi;
+
+            expectEquals(queue.mergeInto(midi, 0, 480, 1000.0), 0);
+
+            queue.push(juce::MidiMessage::noteOn(1, 60, (juce::uint8)100), 1002.5);
+            queue.push(juce::MidiMessage::noteOff(1, 60), 1007.5);
+            expectEquals(queue.mergeInto(midi, 32, 480, 1010.0), 2);
+
+            juce::Array<int> positions;
+            for (const auto metadata : midi)
+                positions.add(metadata.samplePosition);
+
+            expect(positions == juce::Array<int> { 32 + 120, 32 + 360 });
+        }
+
+        beginTest("Merging adds at most maxEvents and keeps the rest for the next block");
+        {
+            KeyboardEventQueue queue;
+            juce::MidiBuffer midi;
+
+            for (int i = 0; i < 10; ++i)
+                queue.push(juce::MidiMessage::noteOn(1, 60 + i, (juce::uint8)100), 1000.0 + i);
+
+            expectEquals(queue.mergeInto(midi, 0, 480, 1010.0, 4), 4);
+            expectEquals(midi.getNumEvents(), 4);
+            expect(! queue.isEmpty());
+
+            int note = 60;
+            for (const auto metadata : midi)
+                expectEquals(metadata.getMessage().getNoteNumber(), note++);
+
+            // Late ones arrived before this block began, so they start it
+            midi.clear();
+            expectEquals(queue.mergeInto(midi, 32, 480, 1020.0, 4), 4);
+            expectEquals(queue.mergeInto(midi, 32, 480, 1030.0, 4), 2);
+            expect(queue.isEmpty());
+
+            for (const auto metadata : midi)
+            {
+                expectEquals(metadata.getMessage().getNoteNumber(), note++);
+                expectEquals(metadata.samplePosition, 32);
+            }
+        }
+
+        beginTest("A note-off behind a full block arrives in the next one");
+        {
+            constexpr int maxEvents = 8;
+
+            KeyboardEventQueue queue;
+            juce::MidiBuffer midi;
+
+            queue.push(juce::MidiMessage::noteOn(1, 60, (juce::uint8)100), 1000.0);
+
+            for (int i = 1; i < maxEvents; ++i)
+                queue.push(juce::MidiMessage::controllerEvent(1, 1, i), 1000.0 + i);
+
+            queue.push(juce::MidiMessage::noteOff(1, 60), 1009.0);
+
+            expectEquals(queue.mergeInto(midi, 0, 480, 1010.0, maxEvents), maxEvents);
+
+            for (const auto metadata : midi)
+                expect(! metadata.getMessage().isNoteOff());
+
+            midi.clear();
+            expectEquals(queue.mergeInto(midi, 0, 480, 1020.0, maxEvents), 1);
+            expect(midi.cbegin() != midi.cend() && (*midi.cbegin()).getMessage().isNoteOff());
+        }
+
+        beginTest("On-screen notes reach the synth and host notes light the keyboard");
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.prepareToPlay(256, 48000.0);
+            source.setKeyboardDisplayActive(true);
+
+            juce::AudioBuffer<float> buffer(2, 256);
+            juce::AudioSourceChannelInfo info(buffer);
+            juce::MidiBuffer midi;
+
+            keyboardState.noteOn(1, 60, 1.0f);
+            source.getNextAudioBlock(info, midi);
+            expect(! source.isOutputSilent());
+
+            keyboardState.noteOff(1, 60, 0.0f);
+
+            midi.addEvent(juce::MidiMessage::noteOn(1, 64, (juce::uint8)100), 10);
+            source.getNextAudioBlock(info, midi);
+            source.updateKeyboardDisplay();
+            expect(keyboardState.isNoteOn(1, 64));
+
+            // Mirrored host notes must not be sent back to the synth, or this one would hang
+            midi.clear();
+            midi.addEvent(juce::MidiMessage::noteOff(1, 64), 0);
+            source.getNextAudioBlock(info, midi);
+            source.updateKeyboardDisplay();
+            expect(! keyboardState.isNoteOn(1, 64));
+
+            midi.clear();
+            for (int block = 0; block < 100; ++block)
+                source.getNextAudioBlock(info, midi);
+
+            expect(source.isOutputSilent());
+
+            source.setKeyboardDisplayActive(false);
+        }
+    }
+};
+
+static KeyboardEventQueueTests keyboardEventQueueTests;
+
+//==============================================================================
+// Cost of the per-block MIDI merge under heavy host and on-screen event streams,
+// next to MidiKeyboardState::processNextMidiBuffer doing the same job under its lock
+class KeyboardMergeBenchmark final : public juce::UnitTest
+{
+public:
+    KeyboardMergeBenchmark() : juce::UnitTest("Keyboard MIDI merge", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr int blockSize = 256;
+        constexpr int numBlocks = 20000;
+
+        beginTest("Merge cost per block");
+
+        for (auto [numHostEvents, numKeyboardEvents] : { std::pair { 0, 0 }, std::pair { 0, 16 },
+                                                         std::pair { 128, 16 }, std::pair { 512, 256 } })
+        {
+            juce::MidiBuffer hostMidi;
+            for (int i = 0; i < numHostEvents; ++i)
+                hostMidi.addEvent(juce::MidiMessage::noteOn(1, i % 128, (juce::uint8)100), i % blockSize);
+
+            // Lock-free queue
+            KeyboardEventQueue queue;
+            juce::MidiBuffer merged;
+            merged.ensureSize((size_t)(numHostEvents + numKeyboardEvents) * 16 + 64);
+
+            double queueSeconds = 0.0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                for (int i = 0; i < numKeyboardEvents; ++i)
+                    queue.push(juce::MidiMessage::noteOn(1, i % 128, (juce::uint8)100), (double)block + i / (double)numKeyboardEvents);
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                merged.clear();
+                if (queue.mergeInto(merged, 0, blockSize, (double)block + 1.0) > 0)
+                    merged.addEvents(hostMidi, 0, blockSize, 0);
+
+                queueSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            }
+
+            // The locked path it replaces
+            juce::MidiKeyboardState keyboardState;
+            double lockedSeconds = 0.0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                for (int i = 0; i < numKeyboardEvents; ++i)
+                    keyboardState.noteOn(1, i % 128, 0.8f);
+
+                juce::MidiBuffer midi(hostMidi);
+
+                auto start = juce::Time::getHighResolutionTicks();
+                keyboardState.processNextMidiBuffer(midi, 0, blockSize, true);
+                lockedSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            }
+
+            logMessage(juce::String(numHostEvents) + " host + " + juce::String(numKeyboardEvents) + " on-screen events: "
+                       + juce::String(queueSeconds * 1.0e9 / numBlocks, 0) + " ns/block queued, "
+                       + juce::String(lockedSeconds * 1.0e9 / numBlocks, 0) + " ns/block locked");
+        }
+    }
+};
+
+static KeyboardMergeBenchmark keyboardMergeBenchmark;
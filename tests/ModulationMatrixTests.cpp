@@ -0,0 +1,336 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+namespace
+{
+    // Renders numSamples of one note from a plain single-voice synth with the given modulation
+    juce::AudioBuffer<float> renderNote(const Modulation::Settings& settings, int numSamples, double sampleRate,
+                                        int noteNumber = 69, float velocity = 1.0f)
+    {
+        juce::SharedResourcePointer<WavetableBank> bank;
+
+        juce::Synthesiser synth;
+        auto* voice = new WavetableVoice();
+        voice->setRandomSeed(1, 0, true);
+        voice->setModulationSettings(settings);
+        synth.addVoice(voice);
+
+        // Eight harmonics of the sine generator, morphing towards a pure sine
+        synth.addSound(new WavetableSound(bank->getTable(0, 8, SynthAudioSource::wavetableSize, sampleRate),
+                                          bank->getTable(0, 1, SynthAudioSource::wavetableSize, sampleRate)));
+        synth.setCurrentPlaybackSampleRate(sampleRate);
+        synth.noteOn(1, noteNumber, velocity);
+
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        buffer.clear();
+
+        juce::MidiBuffer noMidi;
+        synth.renderNextBlock(buffer, noMidi, 0, numSamples);
+
+        return buffer;
+    }
+
+    int countRisingZeroCrossings(const float* samples, int numSamples)
+    {
+        int count = 0;
+
+        for (int i = 1; i < numSamples; ++i)
+            if (samples[i - 1] < 0.0f && samples[i] >= 0.0f)
+                ++count;
+
+        return count;
+    }
+}
+
+//==============================================================================
+class ModulationMatrixTests final : public juce::UnitTest
+{
+public:
+    ModulationMatrixTests() : juce::UnitTest("ModulationMatrix", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        beginTest("LFO shapes a quarter of the way through their cycle");
+        {
+            FastRandom random;
+            Modulation::Lfo lfo;
+            lfo.advance(1.0f, 100.0, 25, random);
+
+            expectWithinAbsoluteError(lfo.getValue(Modulation::sine), 1.0f, 1.0e-5f);
+            expectWithinAbsoluteError(lfo.getValue(Modulation::triangle), 0.0f, 1.0e-5f);
+            expectWithinAbsoluteError(lfo.getValue(Modulation::saw), -0.5f, 1.0e-5f);
+            expectEquals(lfo.getValue(Modulation::square), 1.0f);
+
+            // Sample and hold only picks a new value as a cycle wraps
+            const auto held = lfo.getValue(Modulation::sampleAndHold);
+            lfo.advance(1.0f, 100.0, 50, random);
+            expectEquals(lfo.getValue(Modulation::sampleAndHold), held);
+            lfo.advance(1.0f, 100.0, 50, random);
+            expect(lfo.getValue(Modulation::sampleAndHold) != held);
+        }
+
+        beginTest("Each interval ramps on from where the last one ended");
+        {
+            Modulation::Settings settings;
+            settings.lfoRates[0] = 5.0f;
+            settings.slots[0] = { Modulation::lfo1, Modulation::pitch, 0.5f };
+            settings.slots[1] = { Modulation::lfo1, Modulation::level, -1.0f };
+
+            Modulation::Matrix matrix;
+            matrix.setSampleRate(sampleRate);
+            matrix.setSettings(settings);
+            expect(matrix.adoptNewSettings());
+            expect(matrix.hasActiveSlots());
+
+            FastRandom random;
+            matrix.noteOn(1.0f);
+            expectEquals(matrix.getStart(Modulation::pitch), 0.0f);
+
+            auto previousEnd = matrix.getEnd(Modulation::pitch);
+
+            for (int interval = 1; interval <= 100; ++interval)
+            {
+                matrix.advance(Modulation::controlInterval, random);
+                expectEquals(matrix.getStart(Modulation::pitch), previousEnd);
+                previousEnd = matrix.getEnd(Modulation::pitch);
+
+                const auto phase = 5.0 * interval * Modulation::controlInterval / sampleRate;
+                const auto expected = 0.5 * std::sin(juce::MathConstants<double>::twoPi * phase);
+                expectWithinAbsoluteError((double)previousEnd, expected, 1.0e-3);
+
+                // Slots aimed at the same source scale it independently
+                expectWithinAbsoluteError(matrix.getEnd(Modulation::level), -2.0f * previousEnd, 1.0e-6f);
+            }
+
+            // New settings wait for the audio thread to adopt them
+            settings.slots = {};
+            matrix.setSettings(settings);
+            expect(matrix.hasActiveSlots());
+            expect(matrix.adoptNewSettings());
+            expect(! matrix.hasActiveSlots());
+            expect(! matrix.adoptNewSettings());
+        }
+
+        beginTest("Level modulation scales the voice");
+        {
+            constexpr int numSamples = 9600;
+
+            Modulation::Settings unmodulated;
+            auto plain = renderNote(unmodulated, numSamples, sampleRate);
+
+            Modulation::Settings halved;
+            halved.slots[0] = { Modulation::velocity, Modulation::level, -0.5f };
+            auto quieter = renderNote(halved, numSamples, sampleRate);
+
+            Modulation::Settings muted;
+            muted.slots[0] = { Modulation::velocity, Modulation::level, -1.0f };
+            auto silent = renderNote(muted, numSamples, sampleRate);
+
+            const auto plainRms = TestHelpers::rms(plain.getReadPointer(0), numSamples);
+            expectWithinAbsoluteError(TestHelpers::rms(quieter.getReadPointer(0), numSamples) / plainRms, 0.5, 1.0e-3);
+            expectEquals(silent.getMagnitude(0, numSamples), 0.0f);
+        }
+
+        beginTest("Settings changed mid-note reach it at the next control interval");
+        {
+            constexpr int numSamples = 100 * Modulation::controlInterval;
+            juce::SharedResourcePointer<WavetableBank> bank;
+
+            auto renderHalves = [&](const Modulation::Settings& secondHalf)
+            {
+                juce::Synthesiser synth;
+                auto* voice = new WavetableVoice();
+                voice->setRandomSeed(1, 0, true);
+                synth.addVoice(voice);
+                synth.addSound(new WavetableSound(bank->getTable(0, 8, SynthAudioSource::wavetableSize, sampleRate)));
+                synth.setCurrentPlaybackSampleRate(sampleRate);
+                synth.noteOn(1, 69, 1.0f);
+
+                juce::AudioBuffer<float> buffer(2, 2 * numSamples);
+                buffer.clear();
+
+                juce::MidiBuffer noMidi;
+                synth.renderNextBlock(buffer, noMidi, 0, numSamples);
+                voice->setModulationSettings(secondHalf);
+                synth.renderNextBlock(buffer, noMidi, numSamples, numSamples);
+                return buffer;
+            };
+
+            Modulation::Settings halved;
+            halved.slots[0] = { Modulation::velocity, Modulation::level, -0.5f };
+
+            auto plain = renderHalves({});
+            auto changed = renderHalves(halved);
+
+            // The first interval after the change ramps down; from the next on the level is halved
+            const auto* plainSamples = plain.getReadPointer(0);
+            const auto* changedSamples = changed.getReadPointer(0);
+
+            expectEquals(TestHelpers::rms(changedSamples, numSamples), TestHelpers::rms(plainSamples, numSamples));
+
+            const auto settledStart = numSamples + Modulation::controlInterval;
+            const auto numSettled = numSamples - Modulation::controlInterval;
+            expectWithinAbsoluteError(TestHelpers::rms(changedSamples + settledStart, numSettled)
+                                          / TestHelpers::rms(plainSamples + settledStart, numSettled),
+                                      0.5, 1.0e-3);
+        }
+
+        beginTest("Pitch modulation transposes the voice");
+        {
+            constexpr int numSamples = 48000;
+
+            // Full velocity at half depth is +12 semitones
+            Modulation::Settings octaveUp;
+            octaveUp.slots[0] = { Modulation::velocity, Modulation::pitch, 0.5f };
+
+            auto plain = renderNote({}, numSamples, sampleRate, 57);
+            auto transposed = renderNote(octaveUp, numSamples, sampleRate, 57);
+
+            expectWithinAbsoluteError(countRisingZeroCrossings(plain.getReadPointer(0), numSamples), 220, 2);
+            expectWithinAbsoluteError(countRisingZeroCrossings(transposed.getReadPointer(0), numSamples), 440, 2);
+        }
+
+        beginTest("Harmonics morph fades to the bare fundamental");
+        {
+            constexpr int numSamples = 9600;
+
+            Modulation::Settings morphed;
+            morphed.slots[0] = { Modulation::velocity, Modulation::harmonicsMorph, 1.0f };
+
+            auto plain = renderNote({}, numSamples, sampleRate, 71);
+            auto fundamental = renderNote(morphed, numSamples, sampleRate, 71);
+
+            // Hann-windowed DFT at twice the note's frequency, over the second half of the render
+            auto secondHarmonic = [&](const juce::AudioBuffer<float>& buffer)
+            {
+                constexpr int length = numSamples / 2;
+                const auto frequency = 2.0 * juce::MidiMessage::getMidiNoteInHertz(71);
+                const auto* samples = buffer.getReadPointer(0, numSamples - length);
+                double re = 0.0, im = 0.0, windowSum = 0.0;
+
+                for (int i = 0; i < length; ++i)
+                {
+                    auto window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / length);
+                    auto angle = juce::MathConstants<double>::twoPi * frequency * i / sampleRate;
+                    re += window * samples[i] * std::cos(angle);
+                    im -= window * samples[i] * std::sin(angle);
+                    windowSum += window;
+                }
+
+                return std::sqrt(re * re + im * im) * 2.0 / windowSum;
+            };
+
+            expectGreaterThan(secondHarmonic(plain), 0.01);
+            expectLessThan(secondHarmonic(fundamental), 0.0005);
+        }
+    }
+};
+
+static ModulationMatrixTests modulationMatrixTests;
+
+//==============================================================================
+// Cost of the matrix at control rate against evaluating it every sample, and of a
+// fully modulated 16-voice patch against an unmodulated one.
+class ModulationBenchmark final : public juce::UnitTest
+{
+public:
+    ModulationBenchmark() : juce::UnitTest("Modulation matrix", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numSamples = 48000 * 20;
+
+        Modulation::Settings settings;
+        settings.lfoShapes[1] = Modulation::sampleAndHold;
+        settings.slots[0] = { Modulation::lfo1, Modulation::pitch, 0.02f };
+        settings.slots[1] = { Modulation::lfo2, Modulation::harmonicsMorph, 0.5f };
+        settings.slots[2] = { Modulation::envelope, Modulation::filterCutoff, 0.5f };
+        settings.slots[3] = { Modulation::lfo1, Modulation::level, -0.3f };
+
+        beginTest("Matrix evaluation at control and audio rate");
+        {
+            auto timeMatrix = [&](int interval)
+            {
+                Modulation::Matrix matrix;
+                matrix.setSampleRate(sampleRate);
+                matrix.setSettings(settings);
+                matrix.noteOn(0.8f);
+
+                FastRandom random;
+                auto sum = 0.0f;
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int n = 0; n < numSamples; n += interval)
+                {
+                    matrix.advance(interval, random);
+                    sum += matrix.getEnd(Modulation::pitch);
+                }
+
+                auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                juce::ignoreUnused(sum);
+                return seconds * 1.0e9 / numSamples;
+            };
+
+            auto audioRate = timeMatrix(1);
+            auto controlRate = timeMatrix(Modulation::controlInterval);
+
+            logMessage("Per sample: " + juce::String(audioRate, 2) + " ns at audio rate, "
+                       + juce::String(controlRate, 2) + " ns at control rate");
+        }
+
+        beginTest("16 voices with and without four active slots");
+        {
+            juce::SharedResourcePointer<WavetableBank> bank;
+            constexpr int blockSize = 128;
+
+            auto timeRender = [&](const Modulation::Settings& modulation)
+            {
+                ArmonioSynthesiser synth;
+
+                for (int i = 0; i < 16; ++i)
+                {
+                    auto* voice = new WavetableVoice();
+                    voice->setRandomSeed(1, i, true);
+                    voice->setModulationSettings(modulation);
+                    voice->setNumSubharmonics(2);
+                    synth.addVoice(voice);
+                }
+
+                synth.addSound(new WavetableSound(bank->getTable(0, 12, SynthAudioSource::wavetableSize, sampleRate),
+                                                  bank->getTable(0, 1, SynthAudioSource::wavetableSize, sampleRate)));
+                synth.setCurrentPlaybackSampleRate(sampleRate);
+                synth.setFilterResonance(0.3f);
+
+                for (int i = 0; i < 16; ++i)
+                    synth.noteOn(1, 40 + i * 2, 0.8f);
+
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                juce::MidiBuffer noMidi;
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int n = 0; n < numSamples / 4; n += blockSize)
+                {
+                    buffer.clear();
+                    synth.renderNextBlock(buffer, noMidi, 0, blockSize);
+                }
+
+                return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            };
+
+            auto plainSeconds = timeRender({});
+            auto modulatedSeconds = timeRender(settings);
+
+            logMessage("Unmodulated: " + juce::String(plainSeconds * 1000.0, 1) + " ms, modulated: "
+                       + juce::String(modulatedSeconds * 1000.0, 1) + " ms ("
+                       + juce::String((modulatedSeconds / plainSeconds - 1.0) * 100.0, 1) + "% extra)");
+        }
+    }
+};
+
+static ModulationBenchmark modulationBenchmark;
@@ -0,0 +1,184 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+#include <thread>
+
+//==============================================================================
+namespace
+{
+    // A dense patch: twelve notes of an eight-harmonic stack with subharmonics
+    struct BouncePatch
+    {
+        explicit BouncePatch(double sampleRate, int blockSize)
+        {
+            source.setNumHarmonics(8);
+            source.setNumSubharmonics(2);
+            source.setUnison(3, 12.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(blockSize, sampleRate);
+        }
+
+        // Renders numBlocks blocks, starting the notes in the first; isOfflineBlock
+        // picks the mode of each block
+        template <typename ModeFunction>
+        juce::AudioBuffer<float> render(int numBlocks, int blockSize, ModeFunction&& isOfflineBlock)
+        {
+            juce::AudioBuffer<float> output(2, numBlocks * blockSize);
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                juce::MidiBuffer midi;
+
+                if (block == 0)
+                    for (int i = 0; i < 12; ++i)
+                        midi.addEvent(juce::MidiMessage::noteOn(1, 48 + i * 2, (juce::uint8)100), i * 7);
+
+                source.setNonRealtime(isOfflineBlock(block));
+                source.getNextAudioBlock(info, midi);
+
+                for (int ch = 0; ch < 2; ++ch)
+                    output.copyFrom(ch, block * blockSize, buffer, ch, 0, blockSize);
+            }
+
+            return output;
+        }
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource source { keyboardState };
+    };
+
+    float maxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        auto difference = 0.0f;
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            for (int i = 0; i < a.getNumSamples(); ++i)
+                difference = juce::jmax(difference, std::abs(a.getSample(ch, i) - b.getSample(ch, i)));
+
+        return difference;
+    }
+}
+
+//==============================================================================
+class OfflineRenderTests final : public juce::UnitTest
+{
+public:
+    OfflineRenderTests() : juce::UnitTest("OfflineRender", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 2048;
+        constexpr int numBlocks = 24;
+
+        beginTest("The render pool runs every task exactly once");
+        {
+            ParallelRenderPool pool;
+            pool.setNumWorkers(3);
+            expectEquals(pool.getNumWorkers(), 3);
+
+            std::array<std::atomic<int>, 16> counts {};
+
+            for (int run = 0; run < 1000; ++run)
+            {
+                const auto numTasks = 1 + run % 16;
+                auto task = [&counts](int index) { counts[(size_t)index].fetch_add(1); };
+                pool.forEach(numTasks, task);
+            }
+
+            // Task i ran in every run with more than i tasks
+            for (int i = 0; i < 16; ++i)
+            {
+                auto expected = 0;
+
+                for (int run = 0; run < 1000; ++run)
+                    if (1 + run % 16 > i)
+                        ++expected;
+
+                expectEquals(counts[(size_t)i].load(), expected);
+            }
+
+            pool.setNumWorkers(0);
+            expectEquals(pool.getNumWorkers(), 0);
+        }
+
+        beginTest("Runs from several threads at once each finish every task");
+        {
+            ParallelRenderPool pool;
+            pool.setNumWorkers(3);
+
+            // As instances bouncing side by side would: only one has the workers at a time
+            constexpr int numCallers = 4;
+            std::array<std::array<std::atomic<int>, 8>, numCallers> counts {};
+            std::vector<std::thread> callers;
+
+            for (int caller = 0; caller < numCallers; ++caller)
+            {
+                callers.emplace_back([&pool, &counts, caller]
+                {
+                    auto task = [&counts, caller](int index) { counts[(size_t)caller][(size_t)index].fetch_add(1); };
+
+                    for (int run = 0; run < 500; ++run)
+                        pool.forEach(8, task);
+                });
+            }
+
+            // Workers can come and go while others render
+            pool.setNumWorkers(1);
+            pool.setNumWorkers(3);
+
+            for (auto& caller : callers)
+                caller.join();
+
+            for (const auto& callerCounts : counts)
+                for (const auto& count : callerCounts)
+                    expectEquals(count.load(), 500);
+        }
+
+        beginTest("Instances share one set of render workers");
+        {
+            juce::SharedResourcePointer<SharedRenderPool> shared;
+
+            {
+                BouncePatch first(sampleRate, blockSize), second(sampleRate, blockSize);
+                first.source.setNumOfflineRenderThreads(3);
+                second.source.setNumOfflineRenderThreads(2);
+                expectEquals(shared->getPool().getNumWorkers(), 3);
+
+                first.source.setNumOfflineRenderThreads(0);
+                expectEquals(shared->getPool().getNumWorkers(), 2);
+            }
+
+            expectEquals(shared->getPool().getNumWorkers(), 0);
+        }
+
+        beginTest("Voices rendered in parallel match voices rendered in turn");
+        {
+            BouncePatch serial(sampleRate, blockSize);
+            auto expected = serial.render(numBlocks, blockSize, [](int) { return true; });
+
+            BouncePatch parallel(sampleRate, blockSize);
+            parallel.source.setNumOfflineRenderThreads(3);
+            auto rendered = parallel.render(numBlocks, blockSize, [](int) { return true; });
+
+            expectGreaterThan(expected.getMagnitude(0, expected.getNumSamples()), 0.01f);
+            expectEquals(maxDifference(expected, rendered), 0.0f);
+        }
+
+        beginTest("Switching between realtime and offline mid-note does not click");
+        {
+            BouncePatch realtime(sampleRate, blockSize);
+            auto expected = realtime.render(numBlocks, blockSize, [](int) { return false; });
+
+            BouncePatch switching(sampleRate, blockSize);
+            switching.source.setNumOfflineRenderThreads(2);
+            auto rendered = switching.render(numBlocks, blockSize, [](int block) { return (block / 3) % 2 == 1; });
+
+            // Only the interpolation differs, far below anything audible as a step
+            expectLessThan(maxDifference(expected, rendered), 1.0e-3f);
+        }
+    }
+};
+
+static OfflineRenderTests offlineRenderTests;
@@ -0,0 +1,350 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+namespace
+{
+    // The same waveforms with no correction at all
+    float naiveSample(int shape, float t)
+    {
+        switch (shape)
+        {
+            case PolyBlep::saw:    return 2.0f * t - 1.0f;
+            case PolyBlep::square: return t < 0.5f ? 1.0f : -1.0f;
+            default:               return 2.0f * std::abs(2.0f * t - 1.0f) - 1.0f;
+        }
+    }
+
+    juce::AudioBuffer<float> renderNote(SynthAudioSource& source, int note, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        juce::AudioSourceChannelInfo info(buffer);
+
+        juce::MidiBuffer midi;
+        midi.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8)100), 0);
+        source.getNextAudioBlock(info, midi);
+
+        return buffer;
+    }
+}
+
+//==============================================================================
+class PolyBlepOscillatorTests final : public juce::UnitTest
+{
+public:
+    PolyBlepOscillatorTests() : juce::UnitTest("PolyBlepOscillator", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int fftOrder = 14;
+        constexpr int fftSize = 1 << fftOrder;
+
+        beginTest("Corrections take at least 12 dB off the naive waveforms' aliasing");
+        {
+            for (int shape = 0; shape < PolyBlep::numShapes; ++shape)
+            {
+                for (auto frequency : { 440.0f, 1234.5f, 3520.0f })
+                {
+                    PolyBlepOscillator oscillator;
+                    oscillator.setShape(shape);
+                    oscillator.setFrequency(frequency, (float)sampleRate);
+
+                    std::vector<float> corrected((size_t)fftSize), naive((size_t)fftSize);
+                    auto phase = 0.0f;
+
+                    for (int i = 0; i < fftSize; ++i)
+                    {
+                        corrected[(size_t)i] = oscillator.getNextSample();
+                        naive[(size_t)i] = naiveSample(shape, phase);
+
+                        phase += frequency / (float)sampleRate;
+                        if (phase >= 1.0f)
+                            phase -= 1.0f;
+                    }
+
+                    const auto correctedDb = TestHelpers::measureInharmonicEnergyDb(corrected.data(), fftOrder, frequency, sampleRate);
+                    const auto naiveDb = TestHelpers::measureInharmonicEnergyDb(naive.data(), fftOrder, frequency, sampleRate);
+                    const auto description = "shape " + juce::String(shape) + " at " + juce::String(frequency) + " Hz: "
+                                            + juce::String(correctedDb, 1) + " dB vs " + juce::String(naiveDb, 1) + " dB";
+
+                    expectLessThan(correctedDb, naiveDb - 12.0, description);
+                    expectLessThan(correctedDb, shape == PolyBlep::triangle ? -40.0 : -22.0, description);
+                }
+            }
+        }
+
+        beginTest("Waveforms peak near +/-1 with no offset");
+        {
+            for (int shape = 0; shape < PolyBlep::numShapes; ++shape)
+            {
+                PolyBlepOscillator oscillator;
+                oscillator.setShape(shape);
+                oscillator.setFrequency(100.0f, (float)sampleRate);
+
+                auto peak = 0.0f;
+                auto sum = 0.0;
+
+                // Exactly 20 periods
+                for (int i = 0; i < 9600; ++i)
+                {
+                    const auto value = oscillator.getNextSample();
+                    peak = juce::jmax(peak, std::abs(value));
+                    sum += value;
+                }
+
+                expectWithinAbsoluteError(peak, 1.0f, 0.05f);
+                expectWithinAbsoluteError(sum / 9600.0, 0.0, 1.0e-3);
+            }
+        }
+
+        beginTest("A unison stack of one matches the single oscillator");
+        {
+            auto table = WaveformGenerator::createSineWave(SynthAudioSource::wavetableSize, 1);
+
+            for (int shape = 0; shape < PolyBlep::numShapes; ++shape)
+            {
+                UnisonOscillator stack;
+                stack.setWavetable(table);
+                stack.setAnalyticShape(shape);
+                stack.setNumVoices(1);
+                stack.setFrequency(523.25f, (float)sampleRate);
+
+                PolyBlepOscillator single;
+                single.setShape(shape);
+                single.setFrequency(523.25f, (float)sampleRate);
+
+                std::vector<float> left(1024), right(1024);
+                stack.render(left.data(), right.data(), 1024);
+
+                // Phases are kept in table units by one and in cycles by the other, so
+                // only rounding separates them; the corrected waveforms have no jumps
+                // for that to turn into a large error
+                auto maxError = 0.0f;
+
+                for (size_t i = 0; i < left.size(); ++i)
+                    maxError = juce::jmax(maxError, std::abs(left[i] - single.getNextSample()));
+
+                expectLessThan(maxError, 1.0e-3f);
+                expect(left == right);
+            }
+        }
+
+        beginTest("Single-harmonic patches sound the same in both engines");
+        {
+            auto render = [&](int engine)
+            {
+                juce::MidiKeyboardState keyboardState;
+                SynthAudioSource source(keyboardState);
+                source.setOscillatorEngine(engine);
+                source.setWaveform(1);
+                source.setUnison(3, 10.0f, 0.5f);
+                source.setRandomSeed(3, true);
+                source.prepareToPlay(512, sampleRate);
+                return renderNote(source, 60, 4096);
+            };
+
+            auto wavetable = render(0);
+            auto analytic = render(1);
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < wavetable.getNumSamples(); ++i)
+                    expectEquals(analytic.getSample(ch, i), wavetable.getSample(ch, i));
+        }
+
+        beginTest("Analytic patches keep their subharmonics");
+        {
+            auto render = [&](int numSubharmonics)
+            {
+                juce::MidiKeyboardState keyboardState;
+                SynthAudioSource source(keyboardState);
+                source.setOscillatorEngine(1);
+                source.setNumHarmonics(8);
+                source.setWaveform(2);
+                source.setNumSubharmonics(numSubharmonics);
+                source.setRandomSeed(1, true);
+                source.prepareToPlay(512, sampleRate);
+                return renderNote(source, 69, fftSize);
+            };
+
+            auto withSubharmonics = render(2);
+            auto without = render(0);
+
+            // Note 69 is 440 Hz; its subharmonics sit at 220 and 146.7 Hz
+            for (auto frequency : { 220.0, 440.0 / 3.0 })
+            {
+                const auto present = TestHelpers::magnitudeAt(withSubharmonics.getReadPointer(0), fftSize, frequency, sampleRate);
+                const auto absent = TestHelpers::magnitudeAt(without.getReadPointer(0), fftSize, frequency, sampleRate);
+
+                expectGreaterThan(present, absent * 30.0);
+            }
+
+            // The fundamental is there either way
+            expectGreaterThan(TestHelpers::magnitudeAt(without.getReadPointer(0), fftSize, 440.0, sampleRate), 0.01);
+        }
+
+        auto renderPatch = [&](int engine, int waveform, int numHarmonics, int note)
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setOscillatorEngine(engine);
+            source.setNumHarmonics(numHarmonics);
+            source.setWaveform(waveform);
+            source.setRandomSeed(4, true);
+            source.prepareToPlay(512, sampleRate);
+            return renderNote(source, note, fftSize);
+        };
+
+        beginTest("Analytic patches keep the wavetable engine's partial count");
+        {
+            for (auto numHarmonics : { 2, 5, 8 })
+            {
+                const auto wavetable = renderPatch(0, 2, numHarmonics, 57);
+                const auto analytic = renderPatch(1, 2, numHarmonics, 57);
+
+                // Note 57 is 220 Hz: its square carries the odd harmonics up to
+                // 2N - 1 and nothing from the next odd one on, in both engines
+                const auto fundamental = TestHelpers::magnitudeAt(analytic.getReadPointer(0), fftSize, 220.0, sampleRate);
+
+                for (int harmonic = 1; harmonic <= 2 * numHarmonics + 5; harmonic += 2)
+                {
+                    const auto description = juce::String(numHarmonics) + " harmonics, partial " + juce::String(harmonic);
+                    const auto analyticMagnitude = TestHelpers::magnitudeAt(analytic.getReadPointer(0), fftSize, 220.0 * harmonic, sampleRate);
+                    const auto wavetableMagnitude = TestHelpers::magnitudeAt(wavetable.getReadPointer(0), fftSize, 220.0 * harmonic, sampleRate);
+
+                    if (harmonic < 2 * numHarmonics)
+                        expectGreaterThan(analyticMagnitude, fundamental * 0.5 / harmonic, description);
+                    else
+                        expectLessThan(analyticMagnitude, fundamental * 3.0e-3, description);
+
+                    expectWithinAbsoluteError(analyticMagnitude, wavetableMagnitude, fundamental * 1.0e-3, description);
+                }
+            }
+        }
+
+        beginTest("High notes play the analytic shape at the table's level");
+        {
+            // Note 90 is 1480 Hz, where an eight-harmonic square's next partial, the
+            // 17th, would be above Nyquist, so the analytic shape takes over
+            const auto wavetable = renderPatch(0, 2, 8, 90);
+            const auto analytic = renderPatch(1, 2, 8, 90);
+
+            auto isIdentical = true;
+            for (int i = 0; i < fftSize; ++i)
+                isIdentical = isIdentical && analytic.getSample(0, i) == wavetable.getSample(0, i);
+
+            expect(! isIdentical);
+
+            const auto frequency = juce::MidiMessage::getMidiNoteInHertz(90);
+
+            for (auto [harmonic, tolerance] : { std::pair { 1, 0.03 }, std::pair { 3, 0.1 } })
+            {
+                const auto analyticMagnitude = TestHelpers::magnitudeAt(analytic.getReadPointer(0), fftSize, frequency * harmonic, sampleRate);
+                const auto wavetableMagnitude = TestHelpers::magnitudeAt(wavetable.getReadPointer(0), fftSize, frequency * harmonic, sampleRate);
+
+                expectWithinAbsoluteError(analyticMagnitude / wavetableMagnitude, 1.0, tolerance, "partial " + juce::String(harmonic));
+            }
+        }
+    }
+};
+
+static PolyBlepOscillatorTests polyBlepOscillatorTests;
+
+//==============================================================================
+// Cost of the two engines side by side: the unison stack alone, per waveform and
+// voice count, and a whole patch through SynthAudioSource.
+class OscillatorEngineBenchmark final : public juce::UnitTest
+{
+public:
+    OscillatorEngineBenchmark() : juce::UnitTest("Oscillator engines", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr float sampleRate = 48000.0f;
+        constexpr int blockSize = 32;
+        constexpr int numBlocks = 30000;
+
+        beginTest("Unison stack, ns per oscillator sample");
+
+        const juce::StringArray names { "Saw", "Square", "Triangle" };
+
+        for (int shape = 0; shape < PolyBlep::numShapes; ++shape)
+        {
+            auto table = WaveformGenerator::createWaveform(shape + 1, SynthAudioSource::wavetableSize, 16,
+                                                           SynthAudioSource::referenceFrequency, sampleRate);
+
+            for (auto numVoices : { 1, 7, 16 })
+            {
+                double costs[2] {};
+
+                for (int engine = 0; engine < 2; ++engine)
+                {
+                    UnisonOscillator stack;
+                    stack.setWavetable(table);
+                    stack.setAnalyticShape(engine == 1 ? shape : PolyBlep::none);
+                    stack.setNumVoices(numVoices);
+                    stack.setDetuneAndSpread(15.0f, 0.5f);
+                    stack.setFrequency(220.0f, sampleRate);
+
+                    std::array<float, blockSize> left {}, right {};
+                    auto sink = 0.0f;
+                    auto start = juce::Time::getHighResolutionTicks();
+
+                    for (int block = 0; block < numBlocks; ++block)
+                    {
+                        stack.render(left.data(), right.data(), blockSize);
+                        sink += left[0];
+                    }
+
+                    auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                    costs[engine] = seconds * 1.0e9 / ((double)numBlocks * blockSize * numVoices);
+                    expect(std::isfinite(sink));
+                }
+
+                logMessage(names[shape].paddedRight(' ', 9) + juce::String(numVoices).paddedLeft(' ', 2) + " voices: "
+                           + "wavetable " + juce::String(costs[0], 2) + " ns, analytic " + juce::String(costs[1], 2) + " ns");
+            }
+        }
+
+        // Notes from C5 up: from note 90 on, the analytic engine plays its shapes
+        beginTest("Whole patch, x realtime");
+
+        for (int engine = 0; engine < 2; ++engine)
+        {
+            juce::SharedResourcePointer<WavetableBank> bank;
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setOscillatorEngine(engine);
+            source.setNumHarmonics(16);
+            source.setWaveform(1);
+            source.setNumSubharmonics(2);
+            source.setUnison(7, 15.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(512, sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, 512);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            juce::MidiBuffer notes;
+            for (int i = 0; i < 12; ++i)
+                notes.addEvent(juce::MidiMessage::noteOn(1, 72 + i * 3, (juce::uint8)100), 0);
+
+            source.getNextAudioBlock(info, notes);
+
+            const auto numSamplesToRender = (int)sampleRate * 10;
+            juce::MidiBuffer noMidi;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += 512)
+                source.getNextAudioBlock(info, noMidi);
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            logMessage(juce::String(engine == 0 ? "Wavetable" : "Analytic").paddedRight(' ', 10)
+                       + juce::String(numSamplesToRender / sampleRate / seconds, 1) + "x realtime, "
+                       + juce::String((int)bank->getStats().numBytes) + " bytes of tables held");
+        }
+    }
+};
+
+static OscillatorEngineBenchmark oscillatorEngineBenchmark;
@@ -0,0 +1,253 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 128;
+
+    // Feeds the governor callbacks that each took load times their deadline
+    int runAtLoad(QualityGovernor& governor, double load, double seconds)
+    {
+        const auto deadline = blockSize / sampleRate;
+        auto stage = governor.getStage();
+
+        for (double elapsed = 0.0; elapsed < seconds; elapsed += deadline)
+            stage = governor.update(load * deadline, blockSize);
+
+        return stage;
+    }
+
+    int countActiveVoices(ArmonioSynthesiser& synth)
+    {
+        auto numActive = 0;
+
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+            if (synth.getVoice(i)->isVoiceActive())
+                ++numActive;
+
+        return numActive;
+    }
+}
+
+//==============================================================================
+class QualityGovernorTests final : public juce::UnitTest
+{
+public:
+    QualityGovernorTests() : juce::UnitTest("QualityGovernor", "Armonio") {}
+
+    void runTest() override
+    {
+        beginTest("Sustained overload steps down one stage at a time");
+        {
+            QualityGovernor governor;
+            governor.prepare(sampleRate);
+            runAtLoad(governor, 0.3, 1.0);
+            expectEquals(governor.getStage(), (int)QualityGovernor::fullQuality);
+
+            const auto deadline = blockSize / sampleRate;
+            const auto minBlocksBetweenSteps = (int)(QualityGovernor::holdSeconds / deadline);
+            auto lastStage = governor.getStage();
+            auto blocksSinceStep = minBlocksBetweenSteps;
+
+            for (int block = 0; block < 1000; ++block)
+            {
+                const auto stage = governor.update(1.2 * deadline, blockSize);
+                ++blocksSinceStep;
+
+                if (stage != lastStage)
+                {
+                    expectEquals(stage, lastStage + 1);
+                    expectGreaterThanOrEqual(blocksSinceStep, minBlocksBetweenSteps);
+                    lastStage = stage;
+                    blocksSinceStep = 0;
+                }
+            }
+
+            expectEquals(governor.getStage(), (int)QualityGovernor::fewerVoices);
+            expectGreaterThan(governor.getLoad(), 1.0f);
+        }
+
+        beginTest("A single slow callback does not lower quality");
+        {
+            QualityGovernor governor;
+            governor.prepare(sampleRate);
+            runAtLoad(governor, 0.3, 1.0);
+
+            governor.update(2.0 * blockSize / sampleRate, blockSize);
+            expectEquals(runAtLoad(governor, 0.3, 1.0), (int)QualityGovernor::fullQuality);
+        }
+
+        beginTest("Loads between the thresholds hold the stage");
+        {
+            QualityGovernor governor;
+            governor.prepare(sampleRate);
+
+            while (governor.getStage() == QualityGovernor::fullQuality)
+                governor.update(1.5 * blockSize / sampleRate, blockSize);
+
+            // The smoothed load needs a moment to fall below degradeLoad
+            const auto settled = runAtLoad(governor, 0.65, 1.0);
+            expectGreaterThan(settled, (int)QualityGovernor::fullQuality);
+            expectEquals(runAtLoad(governor, 0.65, 10.0), settled);
+        }
+
+        beginTest("Quality comes back one stage per restore period");
+        {
+            QualityGovernor governor;
+            governor.prepare(sampleRate);
+            runAtLoad(governor, 1.5, 1.0);
+            expectEquals(governor.getStage(), (int)QualityGovernor::fewerVoices);
+
+            expectEquals(runAtLoad(governor, 0.2, QualityGovernor::restoreSeconds * 0.9), (int)QualityGovernor::fewerVoices);
+            expectEquals(runAtLoad(governor, 0.2, QualityGovernor::restoreSeconds), (int)QualityGovernor::noSubharmonics);
+            expectEquals(runAtLoad(governor, 0.2, QualityGovernor::restoreSeconds * 3.0), (int)QualityGovernor::fullQuality);
+        }
+
+        beginTest("A disabled governor stays at full quality");
+        {
+            QualityGovernor governor;
+            governor.prepare(sampleRate);
+            runAtLoad(governor, 1.5, 1.0);
+
+            governor.setEnabled(false);
+            expectEquals(runAtLoad(governor, 1.5, 1.0), (int)QualityGovernor::fullQuality);
+        }
+
+        auto renderSubharmonicMagnitude = [](int velocity, bool releaseNote, int stage)
+        {
+            constexpr int numSamples = 16384;
+
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setWaveform(0);
+            source.setNumSubharmonics(1);
+            source.setADSRParameters(0.001f, 0.1f, 1.0f, 2.0f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(numSamples, sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, numSamples);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            juce::MidiBuffer midi;
+            midi.addEvent(juce::MidiMessage::noteOn(1, 69, (juce::uint8)velocity), 0);
+
+            if (releaseNote)
+                midi.addEvent(juce::MidiMessage::noteOff(1, 69), 1);
+
+            source.getNextAudioBlock(info, midi);
+            source.setQualityStage(stage);
+
+            // Note 69 is 440 Hz, with its subharmonic at 220 Hz; relative to the
+            // fundamental, so that the release and velocity cancel out
+            juce::MidiBuffer noMidi;
+            source.getNextAudioBlock(info, noMidi);
+
+            return TestHelpers::magnitudeAt(buffer.getReadPointer(0), numSamples, 220.0, sampleRate)
+                 / TestHelpers::magnitudeAt(buffer.getReadPointer(0), numSamples, 440.0, sampleRate);
+        };
+
+        beginTest("Thinning drops subharmonics from quiet and releasing notes only");
+        {
+            const auto held = renderSubharmonicMagnitude(100, false, QualityGovernor::fullQuality);
+            expectGreaterThan(held, 0.1);
+
+            expectWithinAbsoluteError(renderSubharmonicMagnitude(100, false, QualityGovernor::thinQuietVoices), held, held * 0.05);
+            expectLessThan(renderSubharmonicMagnitude(100, true, QualityGovernor::thinQuietVoices), held * 0.01);
+            expectLessThan(renderSubharmonicMagnitude(5, false, QualityGovernor::thinQuietVoices), held * 0.01);
+            expectLessThan(renderSubharmonicMagnitude(100, false, QualityGovernor::noSubharmonics), held * 0.01);
+        }
+
+        beginTest("A lower voice cap steals for new notes and leaves playing ones alone");
+        {
+            juce::SharedResourcePointer<WavetableBank> bank;
+            ArmonioSynthesiser synth;
+
+            for (int i = 0; i < 16; ++i)
+                synth.addVoice(new WavetableVoice());
+
+            synth.addSound(new WavetableSound(bank->getTable(0, 1, SynthAudioSource::wavetableSize, sampleRate)));
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            auto playNotes = [&](int firstNote, int numNotes)
+            {
+                juce::MidiBuffer midi;
+                for (int i = 0; i < numNotes; ++i)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, firstNote + i, (juce::uint8)100), i);
+
+                buffer.clear();
+                synth.renderNextBlockScheduled(buffer, midi, 0, blockSize);
+            };
+
+            playNotes(40, 12);
+            expectEquals(countActiveVoices(synth), 12);
+
+            synth.setVoiceLimit(QualityGovernor::reducedVoiceLimit);
+            playNotes(60, 0);
+            expectEquals(countActiveVoices(synth), 12);
+
+            playNotes(60, 4);
+            expectEquals(countActiveVoices(synth), 12);
+
+            synth.setVoiceLimit(16);
+            playNotes(70, 4);
+            expectEquals(countActiveVoices(synth), 16);
+        }
+    }
+};
+
+static QualityGovernorTests qualityGovernorTests;
+
+//==============================================================================
+// What each stage buys back: a full patch of held notes with subharmonics, unison
+// and every voice in use, rendered at each stage in turn.
+class QualityStageBenchmark final : public juce::UnitTest
+{
+public:
+    QualityStageBenchmark() : juce::UnitTest("Quality stages", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr int numSamplesToRender = (int)sampleRate * 10;
+
+        beginTest("16 notes, 8 subharmonics, 5-voice unison");
+
+        for (int stage = 0; stage < QualityGovernor::numStages; ++stage)
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setNumHarmonics(16);
+            source.setWaveform(1);
+            source.setNumSubharmonics(8);
+            source.setUnison(5, 15.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(blockSize, sampleRate);
+            source.setQualityStage(stage);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            // Half the notes soft, so that thinning quiet voices has something to do
+            juce::MidiBuffer notes;
+            for (int i = 0; i < 16; ++i)
+                notes.addEvent(juce::MidiMessage::noteOn(1, 36 + i * 3, (juce::uint8)(i % 2 == 0 ? 100 : 8)), 0);
+
+            source.getNextAudioBlock(info, notes);
+
+            juce::MidiBuffer noMidi;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += blockSize)
+                source.getNextAudioBlock(info, noMidi);
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            logMessage(QualityGovernor::getStageNames()[stage].paddedRight(' ', 22)
+                       + juce::String(numSamplesToRender / sampleRate / seconds, 1) + "x realtime");
+        }
+    }
+};
+
+static QualityStageBenchmark qualityStageBenchmark;
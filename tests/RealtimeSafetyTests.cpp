@@ -0,0 +1,141 @@
+#include "PluginProcessor.h"
+#include <thread>
+
+//==============================================================================
+// Drives the processor with dense MIDI and parameter automation and expects the
+// realtime safety checker to see no allocations or blocking locks on the way.
+class RealtimeSafetyTests final : public juce::UnitTest
+{
+public:
+    RealtimeSafetyTests() : juce::UnitTest("RealtimeSafety", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        constexpr int numBlocks = 1000;
+
+        AudioPluginAudioProcessor processor;
+        processor.setPlayConfigDetails(0, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        auto& apvts = processor.getValueTreeState();
+
+        auto setParameter = [&](const juce::String& parameterID, float value)
+        {
+            auto* parameter = apvts.getParameter(parameterID);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        setParameter("harmonics", 8.0f);
+        setParameter("subharmonics", 2.0f);
+        setParameter("unison", 5.0f);
+
+        // An LFO on the first slot, so that automating its amount moves something
+        setParameter("mod1Source", (float)Modulation::lfo1);
+        setParameter("mod1Destination", (float)Modulation::filterCutoff);
+        setParameter("reverbSend", 0.3f);
+
+        auto* release = apvts.getParameter("release");
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(4096);
+
+        juce::Random random(1234);
+
+        auto runBlocks = [&]
+        {
+            std::array<int, 8> heldNotes {};
+            heldNotes.fill(-1);
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                // Built outside the realtime scope, as a host would
+                midi.clear();
+
+                auto slot = (size_t)random.nextInt((int)heldNotes.size());
+                auto position = random.nextInt(blockSize);
+
+                // Eight held notes plus a few short releases never exceed the sixteen
+                // voices, so the synth never has to steal one
+                if (heldNotes[slot] >= 0)
+                {
+                    midi.addEvent(juce::MidiMessage::noteOff(1, heldNotes[slot]), position);
+                    heldNotes[slot] = -1;
+                }
+                else
+                {
+                    heldNotes[slot] = 36 + (int)slot * 6 + random.nextInt(6);
+                    midi.addEvent(juce::MidiMessage::noteOn(1, heldNotes[slot], 0.2f + 0.8f * random.nextFloat()), position);
+                }
+
+                buffer.clear();
+
+                {
+                    RealtimeSafetyChecker::ScopedRealtimeContext realtimeContext;
+
+                    // Host automation arrives on the audio thread, here one parameter
+                    // from each group. Engine and reverb size changes only flag the
+                    // processor's timer from here, which this test never runs.
+                    apvts.getParameter("attack")->setValueNotifyingHost(random.nextFloat());
+                    release->setValueNotifyingHost(release->convertTo0to1(0.005f + 0.015f * random.nextFloat()));
+                    apvts.getParameter("unisonDetune")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("unisonSpread")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("filterCutoff")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("filterResonance")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("mod1Amount")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("lfo1Rate")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("reverbSize")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("oscEngine")->setValueNotifyingHost(random.nextFloat());
+                    apvts.getParameter("adaptiveQuality")->setValueNotifyingHost(random.nextBool() ? 1.0f : 0.0f);
+
+                    processor.processBlock(buffer, midi);
+                }
+            }
+
+            // Release everything so that the next pass starts from silence
+            midi.clear();
+
+            for (auto note : heldNotes)
+                if (note >= 0)
+                    midi.addEvent(juce::MidiMessage::noteOff(1, note), 0);
+
+            for (int block = 0; block < 10; ++block)
+            {
+                processor.processBlock(buffer, midi);
+                midi.clear();
+            }
+        };
+
+        beginTest("Rendering with dense MIDI and automation is realtime safe");
+        {
+            // On a thread of its own, as a host's audio thread would be, since some
+            // parameters are only applied at once on the message thread. The first
+            // pass lets one-off lazy initialisation happen.
+            std::thread(runBlocks).join();
+            RealtimeSafetyChecker::resetViolations();
+
+            std::thread(runBlocks).join();
+            expectEquals(RealtimeSafetyChecker::getNumViolations(), 0);
+        }
+
+        beginTest("The checker catches an allocation inside the realtime scope");
+        {
+            RealtimeSafetyChecker::resetViolations();
+
+            {
+                RealtimeSafetyChecker::ScopedRealtimeContext realtimeContext;
+                auto allocation = std::make_unique<juce::HeapBlock<float>>(64);
+                juce::ignoreUnused(allocation);
+            }
+
+            expectGreaterThan(RealtimeSafetyChecker::getNumViolations(), 0);
+            RealtimeSafetyChecker::resetViolations();
+        }
+
+        processor.releaseResources();
+    }
+};
+
+static RealtimeSafetyTests realtimeSafetyTests;
@@ -0,0 +1,208 @@
+#include "SynthAudioSource.h"
+
+//==============================================================================
+// Renders the same dense patch at several host block sizes and reports the cost per
+// output sample; with internal sub-blocks, large blocks should be no slower. Then
+// compares an offline bounce, serial and across every core, with the realtime path,
+// a double bus with a float one, and a unison stack with separate oscillators.
+class RenderBenchmark final : public juce::UnitTest
+{
+public:
+    RenderBenchmark() : juce::UnitTest("Render throughput", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int numSamplesToRender = (int)sampleRate * 20;
+
+        beginTest("Cost per sample by host block size");
+
+        for (auto blockSize : { 32, 64, 256, 1024, 4096, 8192 })
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setNumHarmonics(8);
+            source.setNumSubharmonics(2);
+            source.setUnison(4, 15.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(blockSize, sampleRate);
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            juce::MidiBuffer notes;
+            for (int i = 0; i < 12; ++i)
+                notes.addEvent(juce::MidiMessage::noteOn(1, 48 + i * 2, (juce::uint8)100), 0);
+
+            source.getNextAudioBlock(info, notes);
+
+            juce::MidiBuffer noMidi;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += blockSize)
+                source.getNextAudioBlock(info, noMidi);
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            logMessage(juce::String(blockSize).paddedLeft(' ', 5) + " samples/block: "
+                       + juce::String(seconds * 1.0e9 / numSamplesToRender, 1) + " ns/sample, "
+                       + juce::String(numSamplesToRender / sampleRate / seconds, 1) + "x realtime");
+        }
+
+        beginTest("Offline bounce speed");
+
+        constexpr int bounceBlockSize = 4096;
+        const auto numThreads = juce::SystemStats::getNumCpus() - 1;
+
+        for (auto mode : { 0, 1, 2 })
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setNumHarmonics(8);
+            source.setNumSubharmonics(2);
+            source.setUnison(7, 15.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.setNumOfflineRenderThreads(mode == 2 ? numThreads : 0);
+            source.prepareToPlay(bounceBlockSize, sampleRate);
+            source.setNonRealtime(mode > 0);
+
+            juce::AudioBuffer<float> buffer(2, bounceBlockSize);
+            juce::AudioSourceChannelInfo info(buffer);
+
+            juce::MidiBuffer notes;
+            for (int i = 0; i < 16; ++i)
+                notes.addEvent(juce::MidiMessage::noteOn(1, 40 + i * 2, (juce::uint8)100), 0);
+
+            source.getNextAudioBlock(info, notes);
+
+            juce::MidiBuffer noMidi;
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += bounceBlockSize)
+                source.getNextAudioBlock(info, noMidi);
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            const juce::String names[] = { "realtime path", "offline, serial", "offline, " + juce::String(numThreads + 1) + " threads" };
+
+            logMessage(names[mode].paddedRight(' ', 20) + juce::String(numSamplesToRender / sampleRate / seconds, 1) + "x realtime");
+        }
+
+        beginTest("Float and double buses");
+
+        auto timeBus = [&](auto& buffer)
+        {
+            juce::MidiKeyboardState keyboardState;
+            SynthAudioSource source(keyboardState);
+            source.setNumHarmonics(8);
+            source.setNumSubharmonics(2);
+            source.setUnison(4, 15.0f, 0.5f);
+            source.setRandomSeed(1, true);
+            source.prepareToPlay(buffer.getNumSamples(), sampleRate);
+
+            juce::MidiBuffer midi;
+            for (int i = 0; i < 12; ++i)
+                midi.addEvent(juce::MidiMessage::noteOn(1, 48 + i * 2, (juce::uint8)100), 0);
+
+            auto renderBlock = [&]
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(buffer)>, juce::AudioBuffer<float>>)
+                {
+                    juce::AudioSourceChannelInfo info(buffer);
+                    source.getNextAudioBlock(info, midi);
+                }
+                else
+                {
+                    source.getNextAudioBlock(buffer, midi);
+                }
+
+                midi.clear();
+            };
+
+            renderBlock();
+
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += buffer.getNumSamples())
+                renderBlock();
+
+            return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1.0e9 / numSamplesToRender;
+        };
+
+        juce::AudioBuffer<float> floatBus(2, 512);
+        juce::AudioBuffer<double> doubleBus(2, 512);
+        const auto floatCost = timeBus(floatBus);
+        const auto doubleCost = timeBus(doubleBus);
+
+        logMessage("float bus: " + juce::String(floatCost, 1) + " ns/sample, double bus: " + juce::String(doubleCost, 1) + " ns/sample");
+
+        beginTest("Unison stack against separate oscillators");
+
+        // The same detuned and panned voices, once as a stack and once as one
+        // WavetableOscillator each, summed into the two sides one sample at a time
+        auto table = WaveformGenerator::createSawWave(SynthAudioSource::wavetableSize, 8,
+                                                      SynthAudioSource::referenceFrequency, (float)sampleRate);
+        constexpr int chunkSize = 32;
+
+        for (auto numVoices : { 1, 3, 7, 16 })
+        {
+            UnisonOscillator stack;
+            stack.setWavetable(table);
+            stack.setNumVoices(numVoices);
+            stack.setDetuneAndSpread(15.0f, 0.5f);
+            stack.setFrequency(220.0f, (float)sampleRate);
+
+            std::vector<WavetableOscillator> oscillators((size_t)numVoices, WavetableOscillator(table));
+            std::vector<float> leftGains((size_t)numVoices), rightGains((size_t)numVoices);
+
+            for (int i = 0; i < numVoices; ++i)
+            {
+                const auto position = numVoices > 1 ? 2.0f * (float)i / (float)(numVoices - 1) - 1.0f : 0.0f;
+                oscillators[(size_t)i].setFrequency(220.0f * std::pow(2.0f, position * 15.0f / 1200.0f), (float)sampleRate);
+                leftGains[(size_t)i] = juce::jmin(1.0f, 1.0f - position * 0.5f) / std::sqrt((float)numVoices);
+                rightGains[(size_t)i] = juce::jmin(1.0f, 1.0f + position * 0.5f) / std::sqrt((float)numVoices);
+            }
+
+            std::array<float, chunkSize> left {}, right {};
+            auto sink = 0.0f;
+
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += chunkSize)
+            {
+                stack.render(left.data(), right.data(), chunkSize);
+                sink += left[0];
+            }
+
+            const auto stackSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            start = juce::Time::getHighResolutionTicks();
+
+            for (int rendered = 0; rendered < numSamplesToRender; rendered += chunkSize)
+            {
+                left.fill(0.0f);
+                right.fill(0.0f);
+
+                for (int i = 0; i < numVoices; ++i)
+                {
+                    for (int n = 0; n < chunkSize; ++n)
+                    {
+                        const auto sample = oscillators[(size_t)i].getNextSample();
+                        left[(size_t)n] += sample * leftGains[(size_t)i];
+                        right[(size_t)n] += sample * rightGains[(size_t)i];
+                    }
+                }
+
+                sink += left[0];
+            }
+
+            const auto separateSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            expect(std::isfinite(sink));
+
+            logMessage(juce::String(numVoices).paddedLeft(' ', 2) + " voices: stack "
+                       + juce::String(stackSeconds * 1.0e9 / numSamplesToRender, 1) + " ns/sample, separate "
+                       + juce::String(separateSeconds * 1.0e9 / numSamplesToRender, 1) + " ns/sample");
+        }
+    }
+};
+
+static RenderBenchmark renderBenchmark;
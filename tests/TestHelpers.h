@@ -0,0 +1,84 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+//==============================================================================
+namespace TestHelpers
+{
+    // Magnitude of one harmonic over exactly one period of a table (plain DFT in double)
+    inline double harmonicMagnitude(const float* samples, int periodLength, int harmonic)
+    {
+        double re = 0.0, im = 0.0;
+
+        for (int i = 0; i < periodLength; ++i)
+        {
+            auto angle = juce::MathConstants<double>::twoPi * harmonic * i / periodLength;
+            re += samples[i] * std::cos(angle);
+            im -= samples[i] * std::sin(angle);
+        }
+
+        return std::sqrt(re * re + im * im) * 2.0 / periodLength;
+    }
+
+    // Share of the energy, in dB, that is not within guardBins of a multiple of the
+    // fundamental. Band-limited, alias-free renders stay far below -70 dB.
+    inline double measureInharmonicEnergyDb(const float* samples, int fftOrder,
+                                            double fundamental, double sampleRate,
+                                            int guardBins = 6)
+    {
+        const auto fftSize = 1 << fftOrder;
+
+        std::vector<float> data((size_t)fftSize * 2, 0.0f);
+        std::copy(samples, samples + fftSize, data.begin());
+
+        juce::dsp::WindowingFunction<float> window((size_t)fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris, false);
+        window.multiplyWithWindowingTable(data.data(), (size_t)fftSize);
+
+        juce::dsp::FFT fft(fftOrder);
+        fft.performFrequencyOnlyForwardTransform(data.data());
+
+        const auto binWidth = sampleRate / fftSize;
+        double total = 0.0, inharmonic = 0.0;
+
+        for (int bin = 1; bin < fftSize / 2; ++bin)
+        {
+            auto power = (double)data[(size_t)bin] * data[(size_t)bin];
+            total += power;
+
+            auto freq = bin * binWidth;
+            auto nearestHarmonic = std::round(freq / fundamental);
+
+            if (nearestHarmonic < 1.0 || std::abs(freq - nearestHarmonic * fundamental) > guardBins * binWidth)
+                inharmonic += power;
+        }
+
+        return 10.0 * std::log10(inharmonic / total + 1.0e-30);
+    }
+
+    // Hann-windowed DFT magnitude at a single frequency, which need not fall on a bin
+    inline double magnitudeAt(const float* samples, int numSamples, double frequency, double sampleRate)
+    {
+        double re = 0.0, im = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * i / numSamples);
+            const auto angle = juce::MathConstants<double>::twoPi * frequency * i / sampleRate;
+            re += samples[i] * window * std::cos(angle);
+            im -= samples[i] * window * std::sin(angle);
+        }
+
+        return std::sqrt(re * re + im * im) * 4.0 / numSamples;
+    }
+
+    inline double rms(const float* samples, int numSamples)
+    {
+        double sum = 0.0;
+
+        for (int i = 0; i < numSamples; ++i)
+            sum += (double)samples[i] * samples[i];
+
+        return std::sqrt(sum / numSamples);
+    }
+}
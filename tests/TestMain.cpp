@@ -0,0 +1,32 @@
+#include <juce_audio_utils/juce_audio_utils.h>
+
+//==============================================================================
+// Runs every UnitTest in the "Armonio" category and fails if any expectation failed.
+// Pass --bench to also run the (slower, informational) "Benchmarks" category.
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args(argv + 1, argc - 1);
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    int numFailures = 0;
+
+    // Each run replaces the runner's results, so count failures as we go
+    auto runCategory = [&](const juce::String& category)
+    {
+        runner.runTestsInCategory(category);
+
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            numFailures += runner.getResult(i)->failures;
+    };
+
+    runCategory("Armonio");
+
+    if (args.contains("--bench"))
+        runCategory("Benchmarks");
+
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,253 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+class VoiceFilterBankTests final : public juce::UnitTest
+{
+public:
+    VoiceFilterBankTests() : juce::UnitTest("VoiceFilterBank", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        beginTest("Low-pass response matches the analogue prototype");
+        {
+            // A resonance of 0.3 gives damping k = 1.412, so the gain at cutoff is 1/k
+            const auto k = 2.0 - 1.96 * 0.3;
+
+            expectWithinAbsoluteError(measureGain(VoiceFilterBank::lowPass, 100.0, 1000.0f, sampleRate), 1.0, 0.01);
+            expectWithinAbsoluteError(measureGain(VoiceFilterBank::lowPass, 1000.0, 1000.0f, sampleRate), 1.0 / k, 0.01);
+            expectLessThan(measureGain(VoiceFilterBank::lowPass, 10000.0, 1000.0f, sampleRate), 0.015);
+        }
+
+        beginTest("High-pass and band-pass responses");
+        {
+            expectLessThan(measureGain(VoiceFilterBank::highPass, 100.0, 1000.0f, sampleRate), 0.015);
+            expectWithinAbsoluteError(measureGain(VoiceFilterBank::highPass, 10000.0, 1000.0f, sampleRate), 1.0, 0.02);
+
+            // Scaled for unity gain at the centre frequency
+            expectWithinAbsoluteError(measureGain(VoiceFilterBank::bandPass, 1000.0, 1000.0f, sampleRate), 1.0, 0.01);
+        }
+
+        beginTest("Lanes are filtered independently");
+        {
+            VoiceFilterBank bank;
+            bank.prepare(sampleRate);
+            bank.setLaneActive(3, true);
+            bank.setLaneActive(9, true);
+            bank.setCutoff(3, 200.0f);
+            bank.setCutoff(9, 15000.0f);
+
+            bank.clearLanes(VoiceFilterBank::maxBlockSize);
+            bank.getLaneWritePointer(0, 3)[0] = 1.0f;
+            bank.getLaneWritePointer(0, 9)[0] = 1.0f;
+            bank.process(0, VoiceFilterBank::maxBlockSize);
+
+            // The wide-open lane passes most of the impulse at once, the narrow one smears it out
+            expectGreaterThan(bank.getLaneWritePointer(0, 9)[0], 0.5f);
+            expectLessThan(bank.getLaneWritePointer(0, 3)[0], 0.01f);
+
+            for (int voice = 0; voice < VoiceFilterBank::maxVoices; ++voice)
+                if (voice != 3 && voice != 9)
+                    for (int ch = 0; ch < 2; ++ch)
+                        for (int n = 0; n < VoiceFilterBank::maxBlockSize; ++n)
+                            expectEquals(bank.getLaneWritePointer(ch, voice)[n * VoiceFilterBank::laneStride], 0.0f);
+        }
+
+        beginTest("Mode and resonance changes apply without a new cutoff");
+        {
+            VoiceFilterBank bank;
+            bank.prepare(sampleRate);
+            bank.setLaneActive(5, true);
+            bank.setCutoff(5, 1000.0f);
+
+            // A low-pass passes 1 / damping at its cutoff
+            bank.setResonance(0.3f);
+            expectWithinAbsoluteError(measureGain(bank, 1000.0, sampleRate), 1.0 / 1.412, 0.01);
+
+            bank.setResonance(0.9f);
+            expectWithinAbsoluteError(measureGain(bank, 1000.0, sampleRate), 1.0 / 0.236, 0.05);
+
+            bank.setMode(VoiceFilterBank::bandPass);
+            expectWithinAbsoluteError(measureGain(bank, 1000.0, sampleRate), 1.0, 0.01);
+        }
+
+        beginTest("Key tracking and the filter envelope move the cutoff");
+        {
+            juce::Synthesiser synth;
+            auto* voicePtr = new WavetableVoice();
+            synth.addVoice(voicePtr);
+            synth.addSound(new WavetableSound(WaveformGenerator::createSineWave(2048, 1)));
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+            voicePtr->setFilterParameters(1000.0f, 0.0f, 1.0f);
+            synth.noteOn(1, 72, 1.0f);
+
+            // The voice records a cutoff for each control block it renders
+            juce::AudioBuffer<float> buffer(2, 64);
+            juce::MidiBuffer noMidi;
+            synth.renderNextBlock(buffer, noMidi, 0, 64);
+
+            // An octave above middle C doubles the cutoff at full key tracking
+            expectWithinAbsoluteError(voicePtr->getFilterCutoff(0), 2000.0f, 0.01f);
+
+            juce::ADSR::Parameters instant { 0.0f, 0.0f, 1.0f, 0.1f };
+            voicePtr->setFilterEnvelopeParameters(instant);
+            voicePtr->setFilterParameters(1000.0f, 12.0f, 0.0f);
+            synth.noteOn(1, 60, 1.0f);
+            synth.renderNextBlock(buffer, noMidi, 0, 64);
+
+            // A fully open envelope adds the whole amount
+            expectWithinAbsoluteError(voicePtr->getFilterCutoff(1), 2000.0f, 0.5f);
+        }
+
+        beginTest("Filter settings changed mid-note reach it at the next control block");
+        {
+            juce::Synthesiser synth;
+            auto* voicePtr = new WavetableVoice();
+            synth.addVoice(voicePtr);
+            synth.addSound(new WavetableSound(WaveformGenerator::createSineWave(2048, 1)));
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+            voicePtr->setFilterParameters(1000.0f, 0.0f, 0.0f);
+            synth.noteOn(1, 60, 1.0f);
+
+            juce::AudioBuffer<float> buffer(2, 2 * VoiceFilterBank::controlBlockSize);
+            juce::MidiBuffer noMidi;
+            synth.renderNextBlock(buffer, noMidi, 0, VoiceFilterBank::controlBlockSize);
+            expectWithinAbsoluteError(voicePtr->getFilterCutoff(0), 1000.0f, 0.01f);
+
+            // Set while the note plays, as the audio thread does between blocks
+            voicePtr->setFilterParameters(3000.0f, 0.0f, 0.0f);
+            synth.renderNextBlock(buffer, noMidi, 0, 2 * VoiceFilterBank::controlBlockSize);
+            expectWithinAbsoluteError(voicePtr->getFilterCutoff(0), 3000.0f, 0.01f);
+            expectWithinAbsoluteError(voicePtr->getFilterCutoff(1), 3000.0f, 0.01f);
+        }
+
+        beginTest("A wide-open filter leaves the voice as it was");
+        {
+            auto render = [&](juce::Synthesiser& synth)
+            {
+                auto* voice = new WavetableVoice();
+                voice->setRandomSeed(1, 0, true);
+                synth.addVoice(voice);
+                synth.addSound(new WavetableSound(WaveformGenerator::createSineWave(2048, 1)));
+                synth.setCurrentPlaybackSampleRate(sampleRate);
+                synth.noteOn(1, 60, 1.0f);
+
+                juce::AudioBuffer<float> buffer(2, 24000);
+                juce::MidiBuffer noMidi;
+                buffer.clear();
+                synth.renderNextBlock(buffer, noMidi, 0, buffer.getNumSamples());
+                return TestHelpers::rms(buffer.getReadPointer(0, 16000), 8000);
+            };
+
+            juce::Synthesiser plain;
+            ArmonioSynthesiser filtered;
+            filtered.setFilterResonance(0.3f);
+
+            expectWithinAbsoluteError(render(filtered) / render(plain), 1.0, 0.01);
+        }
+    }
+
+private:
+    // Steady-state gain of lane 5 for a sine at frequency
+    static double measureGain(int mode, double frequency, float cutoff, double sampleRate)
+    {
+        VoiceFilterBank bank;
+        bank.prepare(sampleRate);
+        bank.setMode(mode);
+        bank.setResonance(0.3f);
+        bank.setLaneActive(5, true);
+        bank.setCutoff(5, cutoff);
+
+        return measureGain(bank, frequency, sampleRate);
+    }
+
+    // The same, with whatever settings the bank already has
+    static double measureGain(VoiceFilterBank& bank, double frequency, double sampleRate)
+    {
+        constexpr int numBlocks = 200;
+        double sumSquares = 0.0;
+        int numMeasured = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            bank.clearLanes(VoiceFilterBank::maxBlockSize);
+            auto* lane = bank.getLaneWritePointer(0, 5);
+
+            for (int n = 0; n < VoiceFilterBank::maxBlockSize; ++n)
+            {
+                auto t = (block * VoiceFilterBank::maxBlockSize + n) / sampleRate;
+                lane[n * VoiceFilterBank::laneStride] = (float)std::sin(juce::MathConstants<double>::twoPi * frequency * t);
+            }
+
+            bank.process(0, VoiceFilterBank::maxBlockSize);
+
+            // Skip the transient
+            if (block >= numBlocks / 2)
+            {
+                for (int n = 0; n < VoiceFilterBank::maxBlockSize; ++n)
+                {
+                    auto y = (double)lane[n * VoiceFilterBank::laneStride];
+                    sumSquares += y * y;
+                    ++numMeasured;
+                }
+            }
+        }
+
+        return std::sqrt(sumSquares / numMeasured) * juce::MathConstants<double>::sqrt2;
+    }
+};
+
+static VoiceFilterBankTests voiceFilterBankTests;
+
+//==============================================================================
+// A full sixteen-voice patch through the filter bank must stay inside a fixed share
+// of one core.
+class VoiceFilterBankBenchmark final : public juce::UnitTest
+{
+public:
+    VoiceFilterBankBenchmark() : juce::UnitTest("Voice filter bank", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+        constexpr double secondsToRender = 10.0;
+        constexpr double cpuBudget = 0.25;
+
+        beginTest("Sixteen filtered voices");
+
+        juce::MidiKeyboardState keyboardState;
+        SynthAudioSource source(keyboardState);
+        source.setNumHarmonics(8);
+        source.setUnison(3, 15.0f, 0.5f);
+        source.setFilterParameters(VoiceFilterBank::lowPass, 800.0f, 0.6f, 24.0f, 0.5f);
+        source.setFilterEnvelopeParameters(0.01f, 0.5f, 0.3f, 0.3f);
+        source.prepareToPlay(blockSize, sampleRate);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::AudioSourceChannelInfo info(buffer);
+
+        juce::MidiBuffer notes;
+        for (int i = 0; i < 16; ++i)
+            notes.addEvent(juce::MidiMessage::noteOn(1, 36 + i * 2, (juce::uint8)100), 0);
+
+        source.getNextAudioBlock(info, notes);
+
+        juce::MidiBuffer noMidi;
+        const auto numBlocks = (int)(secondsToRender * sampleRate / blockSize);
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; ++block)
+            source.getNextAudioBlock(info, noMidi);
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        auto cpuShare = seconds / (numBlocks * blockSize / sampleRate);
+
+        logMessage("16 voices x 3 unison with filter: " + juce::String(cpuShare * 100.0, 2) + "% of one core");
+        expectLessThan(cpuShare, cpuBudget);
+    }
+};
+
+static VoiceFilterBankBenchmark voiceFilterBankBenchmark;
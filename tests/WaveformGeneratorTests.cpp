@@ -0,0 +1,110 @@
+#include "TestHelpers.h"
+#include "BaseWavetables.h"
+#include "WaveformGenerator.h"
+
+//==============================================================================
+class WaveformGeneratorTests final : public juce::UnitTest
+{
+public:
+    WaveformGeneratorTests() : juce::UnitTest("WaveformGenerator", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr unsigned int tableSize = 2048;
+        constexpr float referenceFreq = 261.63f;
+        constexpr float sampleRate = 48000.0f;
+
+        beginTest("Every table is normalised and its guard sample wraps to the first");
+        {
+            for (int waveform = 0; waveform < 4; ++waveform)
+            {
+                for (int harmonics = 1; harmonics <= 16; ++harmonics)
+                {
+                    auto table = WaveformGenerator::createWaveform(waveform, tableSize, harmonics, referenceFreq, sampleRate);
+                    auto* samples = table.getReadPointer(0);
+
+                    expectEquals(table.getNumSamples(), (int)tableSize + 1);
+                    expectEquals(samples[tableSize], samples[0]);
+
+                    auto range = juce::FloatVectorOperations::findMinAndMax(samples, (int)tableSize);
+                    expectWithinAbsoluteError(juce::jmax(-range.getStart(), range.getEnd()), 1.0f, 1.0e-6f);
+                }
+            }
+        }
+
+        beginTest("One period spans exactly tableSize samples");
+        {
+            // A period of tableSize - 1 steps repeated the first sample at the wrap,
+            // which left harmonic distortion around -61 dB in a plain sine
+            auto table = WaveformGenerator::createSineWave(tableSize, 1, referenceFreq, sampleRate);
+            const auto* samples = table.getReadPointer(0);
+
+            for (unsigned int i = 0; i < tableSize; ++i)
+                expectWithinAbsoluteError(samples[i], (float)std::sin(juce::MathConstants<double>::twoPi * i / tableSize), 1.0e-6f);
+
+            const auto fundamental = TestHelpers::harmonicMagnitude(samples, (int)tableSize, 1);
+
+            for (int n = 2; n <= 64; ++n)
+                expectLessThan(TestHelpers::harmonicMagnitude(samples, (int)tableSize, n) / fundamental, 1.0e-6,
+                               "harmonic " + juce::String(n));
+        }
+
+        beginTest("Sine harmonics fall off as 1/n and nothing else is present");
+        {
+            checkSpectrum(WaveformGenerator::createSineWave(tableSize, 16, referenceFreq, sampleRate),
+                          [](int n) { return n <= 16 ? 1.0 / n : 0.0; });
+        }
+
+        beginTest("Square uses odd harmonics at 1/n");
+        {
+            checkSpectrum(WaveformGenerator::createSquareWave(tableSize, 16, referenceFreq, sampleRate),
+                          [](int n) { return (n % 2 == 1 && n <= 31) ? 1.0 / n : 0.0; });
+        }
+
+        beginTest("Triangle uses odd harmonics at 1/n^2");
+        {
+            checkSpectrum(WaveformGenerator::createTriangleWave(tableSize, 16, referenceFreq, sampleRate),
+                          [](int n) { return (n % 2 == 1 && n <= 31) ? 1.0 / (n * n) : 0.0; });
+        }
+
+        beginTest("Harmonics at or above Nyquist are dropped");
+        {
+            // 1 kHz at 8 kHz: only harmonics 1-3 lie below the 4 kHz Nyquist limit
+            auto table = WaveformGenerator::createSineWave(tableSize, 16, 1000.0f, 8000.0f);
+
+            checkSpectrum(table, [](int n) { return n <= 3 ? 1.0 / n : 0.0; });
+        }
+
+        beginTest("Compile-time base tables match the generator");
+        {
+            for (int waveform = 0; waveform < 4; ++waveform)
+            {
+                auto generated = WaveformGenerator::createWaveform(waveform, tableSize, 1, referenceFreq, sampleRate);
+                const auto& base = BaseWavetables::get(waveform);
+
+                for (unsigned int i = 0; i <= tableSize; ++i)
+                    expectWithinAbsoluteError(base[i], generated.getSample(0, (int)i), 1.0e-6f);
+            }
+        }
+    }
+
+private:
+    template <typename ExpectedAmplitude>
+    void checkSpectrum(const juce::AudioSampleBuffer& table, ExpectedAmplitude expectedRelativeAmplitude)
+    {
+        const auto period = table.getNumSamples() - 1;
+        const auto* samples = table.getReadPointer(0);
+        const auto fundamental = TestHelpers::harmonicMagnitude(samples, period, 1);
+
+        expectGreaterThan(fundamental, 0.1);
+
+        for (int n = 1; n <= 64; ++n)
+        {
+            auto relative = TestHelpers::harmonicMagnitude(samples, period, n) / fundamental;
+            expectWithinAbsoluteError(relative, expectedRelativeAmplitude(n), 1.0e-4,
+                                      "harmonic " + juce::String(n));
+        }
+    }
+};
+
+static WaveformGeneratorTests waveformGeneratorTests;
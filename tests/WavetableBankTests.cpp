@@ -0,0 +1,208 @@
+#include "SynthAudioSource.h"
+
+//==============================================================================
+class WavetableBankTests final : public juce::UnitTest
+{
+public:
+    WavetableBankTests() : juce::UnitTest("WavetableBank", "Armonio") {}
+
+    void runTest() override
+    {
+        juce::SharedResourcePointer<WavetableBank> bank;
+
+        beginTest("Identical settings share one table");
+        {
+            auto a = bank->getTable(2, 9, 2048, 48000.0);
+            auto b = bank->getTable(2, 9, 2048, 48000.0);
+            expect(a == b);
+
+            expect(bank->getTable(2, 9, 2048, 44100.0) != a);
+            expect(bank->getTable(3, 9, 2048, 48000.0) != a);
+            expect(bank->getTable(2, 10, 2048, 48000.0) != a);
+            expect(bank->getTable(2, 9, 1024, 48000.0) != a);
+        }
+
+        beginTest("Single-harmonic tables are shared across sample rates");
+        {
+            expect(bank->getTable(1, 1, 2048, 44100.0) == bank->getTable(1, 1, 2048, 96000.0));
+        }
+
+        beginTest("Bank tables match the generator");
+        {
+            auto table = bank->getTable(1, 12, 2048, 48000.0);
+            auto generated = WaveformGenerator::createSawWave(2048, 12, WavetableBank::referenceFrequency, 48000.0f);
+
+            expectEquals(table->getNumSamples(), generated.getNumSamples());
+
+            for (int i = 0; i < generated.getNumSamples(); ++i)
+                expectWithinAbsoluteError(table->getSample(0, i), generated.getSample(0, i), 1.0e-6f);
+        }
+
+        beginTest("A harmonic sweep builds the same tables as from scratch");
+        {
+            // Up and back down, so partials are both added and taken away again
+            for (int waveform = 0; waveform < 4; ++waveform)
+            {
+                for (int step = 0; step < 31; ++step)
+                {
+                    const auto numHarmonics = step < 16 ? step + 1 : 31 - step;
+                    auto table = bank->getTable(waveform, numHarmonics, 1024, 44100.0);
+                    auto generated = WaveformGenerator::createWaveform(waveform, 1024, numHarmonics,
+                                                                       WavetableBank::referenceFrequency, 44100.0f);
+
+                    for (int i = 0; i < generated.getNumSamples(); ++i)
+                        expectWithinAbsoluteError(table->getSample(0, i), generated.getSample(0, i), 1.0e-6f);
+                }
+            }
+        }
+
+        beginTest("Tables are freed once nobody uses them");
+        {
+            const auto before = bank->getStats();
+
+            auto table = bank->getTable(0, 7, 512, 12345.0);
+            expectEquals(bank->getStats().numTables, before.numTables + 1);
+
+            table.reset();
+            expectEquals(bank->getStats().numTables, before.numTables);
+        }
+
+        beginTest("Instances with the same settings share their tables");
+        {
+            const auto before = bank->getStats();
+
+            juce::MidiKeyboardState keyboardState;
+            std::vector<std::unique_ptr<SynthAudioSource>> sources;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                sources.push_back(std::make_unique<SynthAudioSource>(keyboardState));
+                sources.back()->prepareToPlay(256, 47000.0);
+                sources.back()->setNumHarmonics(5);
+            }
+
+            // One table for the harmonic-rich sine at this rate and one for the bare
+            // fundamental it morphs towards, however many instances use them
+            expectEquals(bank->getStats().numTables, before.numTables + 2);
+        }
+    }
+};
+
+static WavetableBankTests wavetableBankTests;
+
+//==============================================================================
+// Memory held by 200 instances at assorted settings, and the cost of rendering them
+// with shared tables versus a private copy each.
+class WavetableBankBenchmark final : public juce::UnitTest
+{
+public:
+    WavetableBankBenchmark() : juce::UnitTest("Shared wavetable bank", "Benchmarks") {}
+
+    void runTest() override
+    {
+        constexpr int numInstances = 200;
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 256;
+
+        juce::SharedResourcePointer<WavetableBank> bank;
+
+        beginTest("Memory held by 200 instances");
+        {
+            const auto before = bank->getStats();
+
+            juce::MidiKeyboardState keyboardState;
+            std::vector<std::unique_ptr<SynthAudioSource>> sources;
+
+            for (int i = 0; i < numInstances; ++i)
+            {
+                auto source = std::make_unique<SynthAudioSource>(keyboardState);
+                source->prepareToPlay(blockSize, sampleRate);
+                source->setWaveform(i % 4);
+                source->setNumHarmonics(1 + (i / 4) % 16);
+                sources.push_back(std::move(source));
+            }
+
+            const auto after = bank->getStats();
+            const auto tableBytes = sizeof(float) * (SynthAudioSource::wavetableSize + 1);
+
+            // Each instance used to hold its own table plus the sound's copy of it
+            logMessage("Shared: " + juce::String(after.numTables - before.numTables) + " tables, "
+                       + juce::String((juce::int64)(after.numBytes - before.numBytes) / 1024) + " KiB; unshared: "
+                       + juce::String((juce::int64)(tableBytes * 2 * numInstances) / 1024) + " KiB");
+        }
+
+        beginTest("Render cost with shared and private tables");
+        {
+            auto renderAll = [&](bool shareTables)
+            {
+                std::vector<std::unique_ptr<juce::Synthesiser>> synths;
+
+                for (int i = 0; i < numInstances; ++i)
+                {
+                    auto synth = std::make_unique<juce::Synthesiser>();
+                    auto* voice = new WavetableVoice();
+                    voice->setRandomSeed(1, i, true);
+                    synth->addVoice(voice);
+
+                    auto table = bank->getTable(i % 4, 8, SynthAudioSource::wavetableSize, sampleRate);
+                    synth->addSound(shareTables ? new WavetableSound(table) : new WavetableSound(*table));
+                    synth->setCurrentPlaybackSampleRate(sampleRate);
+                    synth->noteOn(1, 40 + i % 32, 0.8f);
+                    synths.push_back(std::move(synth));
+                }
+
+                juce::AudioBuffer<float> buffer(2, blockSize);
+                juce::MidiBuffer noMidi;
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int block = 0; block < 200; ++block)
+                    for (auto& synth : synths)
+                        synth->renderNextBlock(buffer, noMidi, 0, blockSize);
+
+                return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            };
+
+            auto privateSeconds = renderAll(false);
+            auto sharedSeconds = renderAll(true);
+
+            logMessage("Private tables: " + juce::String(privateSeconds * 1000.0, 1) + " ms, shared: "
+                       + juce::String(sharedSeconds * 1000.0, 1) + " ms");
+        }
+
+        beginTest("Harmonic sweep cost per step");
+        {
+            // A live sweep of the harmonics knob, each step a table nobody holds yet
+            constexpr int numSweeps = 20;
+            const auto numSteps = numSweeps * 30;
+
+            auto sweep = [&](bool fromScratch)
+            {
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int step = 0; step < numSteps; ++step)
+                {
+                    const auto position = step % 30;
+                    const auto numHarmonics = position < 15 ? position + 2 : 31 - position;
+
+                    if (fromScratch)
+                        WaveformGenerator::createWaveform(1, SynthAudioSource::wavetableSize, numHarmonics,
+                                                          WavetableBank::referenceFrequency, (float)sampleRate);
+                    else
+                        bank->getTable(1, numHarmonics, SynthAudioSource::wavetableSize, sampleRate);
+                }
+
+                return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start)
+                     * 1.0e6 / numSteps;
+            };
+
+            auto scratchMicroseconds = sweep(true);
+            auto incrementalMicroseconds = sweep(false);
+
+            logMessage("From scratch: " + juce::String(scratchMicroseconds, 1) + " us per step, incremental: "
+                       + juce::String(incrementalMicroseconds, 1) + " us per step");
+        }
+    }
+};
+
+static WavetableBankBenchmark wavetableBankBenchmark;
@@ -0,0 +1,89 @@
+#include "TestHelpers.h"
+#include "BaseWavetables.h"
+#include "WavetableOscillator.h"
+
+//==============================================================================
+class WavetableOscillatorTests final : public juce::UnitTest
+{
+public:
+    WavetableOscillatorTests() : juce::UnitTest("WavetableOscillator", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+
+        juce::AudioSampleBuffer sineTable(1, (int)BaseWavetables::tableSize + 1);
+        const auto& base = BaseWavetables::get(0);
+        juce::FloatVectorOperations::copy(sineTable.getWritePointer(0), base.data(), (int)base.size());
+
+        beginTest("Frequency holds over a ten second run");
+        {
+            for (auto frequency : { 27.5, 261.63, 440.0, 1000.0, 4186.0 })
+            {
+                WavetableOscillator oscillator(sineTable);
+                oscillator.setFrequency((float)frequency, (float)sampleRate);
+
+                // Time the rising zero crossings, interpolated to sub-sample accuracy
+                auto previous = oscillator.getNextSample();
+                double firstCrossing = -1.0, lastCrossing = 0.0;
+                int numCrossings = 0;
+
+                for (int i = 1; i < (int)sampleRate * 10; ++i)
+                {
+                    auto current = oscillator.getNextSample();
+
+                    if (previous <= 0.0f && current > 0.0f)
+                    {
+                        auto crossing = (i - 1) + (double)-previous / (double)(current - previous);
+
+                        if (firstCrossing < 0.0)
+                            firstCrossing = crossing;
+
+                        lastCrossing = crossing;
+                        ++numCrossings;
+                    }
+
+                    previous = current;
+                }
+
+                auto measured = (numCrossings - 1) * sampleRate / (lastCrossing - firstCrossing);
+                expectWithinAbsoluteError(measured / frequency, 1.0, 1.0e-4,
+                                          juce::String(frequency) + " Hz measured as " + juce::String(measured));
+            }
+        }
+
+        beginTest("Output matches an analytic sine");
+        {
+            WavetableOscillator oscillator(sineTable);
+            oscillator.reset();
+            oscillator.setFrequency(440.0f, (float)sampleRate);
+
+            double maxError = 0.0;
+
+            for (int i = 0; i < 1024; ++i)
+            {
+                auto expected = std::sin(juce::MathConstants<double>::twoPi * 440.0 * i / sampleRate);
+                maxError = juce::jmax(maxError, std::abs(oscillator.getNextSample() - expected));
+            }
+
+            expectLessThan(maxError, 1.0e-4);
+        }
+
+        beginTest("Stopping holds the output still");
+        {
+            WavetableOscillator oscillator(sineTable);
+            oscillator.setFrequency(440.0f, (float)sampleRate);
+
+            for (int i = 0; i < 100; ++i)
+                oscillator.getNextSample();
+
+            oscillator.stop();
+            auto held = oscillator.getNextSample();
+
+            for (int i = 0; i < 100; ++i)
+                expectEquals(oscillator.getNextSample(), held);
+        }
+    }
+};
+
+static WavetableOscillatorTests wavetableOscillatorTests;
@@ -0,0 +1,179 @@
+#include "TestHelpers.h"
+#include "SynthAudioSource.h"
+
+//==============================================================================
+class WavetableVoiceTests final : public juce::UnitTest
+{
+public:
+    WavetableVoiceTests() : juce::UnitTest("WavetableVoice", "Armonio") {}
+
+    void runTest() override
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int fftOrder = 14;
+        constexpr int fftSize = 1 << fftOrder;
+
+        beginTest("Single-harmonic patch stays alias-free across the keyboard");
+        {
+            auto table = WaveformGenerator::createSineWave(SynthAudioSource::wavetableSize, 1,
+                                                           SynthAudioSource::referenceFrequency, (float)sampleRate);
+
+            for (int note = 21; note <= 108; ++note)
+                expectAliasFree(table, note, sampleRate, fftSize, fftOrder);
+        }
+
+        beginTest("Harmonic-rich patches stay alias-free where the table is band-limited");
+        {
+            // Tables are band-limited for middle C, so with 16 odd harmonics the 31st
+            // partial only stays below Nyquist up to about note 77 at 48 kHz
+            for (int waveform : { 0, 2, 3 })
+            {
+                auto table = WaveformGenerator::createWaveform(waveform, SynthAudioSource::wavetableSize, 16,
+                                                               SynthAudioSource::referenceFrequency, (float)sampleRate);
+
+                for (int note = 21; note <= 77; note += 4)
+                    expectAliasFree(table, note, sampleRate, fftSize, fftOrder);
+            }
+        }
+
+        beginTest("Sustained level matches velocity x sustain");
+        {
+            auto table = WaveformGenerator::createSineWave(SynthAudioSource::wavetableSize, 1,
+                                                           SynthAudioSource::referenceFrequency, (float)sampleRate);
+            SingleVoiceSynth synth(table, sampleRate);
+            synth.synth.noteOn(1, 60, 1.0f);
+
+            // Past the default 10 ms attack and 100 ms decay, into the 0.8 sustain
+            juce::AudioBuffer<float> buffer(2, (int)sampleRate / 2);
+            synth.render(buffer);
+
+            const auto tail = 8192;
+            const auto expectedRms = 0.15 * 0.8 / juce::MathConstants<double>::sqrt2;
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto measured = TestHelpers::rms(buffer.getReadPointer(ch, buffer.getNumSamples() - tail), tail);
+                expectWithinAbsoluteError(measured / expectedRms, 1.0, 0.01);
+            }
+
+            // A single unison voice is centred
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                expectEquals(buffer.getSample(0, i), buffer.getSample(1, i));
+        }
+
+        beginTest("Deterministic mode renders bit-identical output");
+        {
+            auto table = WaveformGenerator::createSawWave(SynthAudioSource::wavetableSize, 8,
+                                                          SynthAudioSource::referenceFrequency, (float)sampleRate);
+
+            auto renderWithSeed = [&](juce::uint64 seed)
+            {
+                SingleVoiceSynth synth(table, sampleRate);
+                synth.voice->setRandomSeed(seed, 0, true);
+                synth.voice->setUnison(7, 20.0f, 1.0f);
+                synth.voice->setNumSubharmonics(3);
+                synth.synth.noteOn(1, 57, 0.9f);
+
+                juce::AudioBuffer<float> buffer(2, 4096);
+                synth.render(buffer);
+                return buffer;
+            };
+
+            auto first = renderWithSeed(42);
+            auto second = renderWithSeed(42);
+            auto other = renderWithSeed(43);
+
+            auto isIdentical = [](const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+            {
+                for (int ch = 0; ch < a.getNumChannels(); ++ch)
+                    if (std::memcmp(a.getReadPointer(ch), b.getReadPointer(ch), sizeof(float) * (size_t)a.getNumSamples()) != 0)
+                        return false;
+
+                return true;
+            };
+
+            expect(isIdentical(first, second), "Same seed rendered differently");
+            expect(! isIdentical(first, other), "Different seeds rendered identically");
+        }
+
+        beginTest("A double bus gets the same output as a float one");
+        {
+            auto render = [&](auto& buffer)
+            {
+                juce::MidiKeyboardState keyboardState;
+                SynthAudioSource source(keyboardState);
+                source.setNumHarmonics(8);
+                source.setUnison(5, 15.0f, 0.7f);
+                source.setRandomSeed(7, true);
+                source.prepareToPlay(buffer.getNumSamples(), sampleRate);
+
+                juce::MidiBuffer midi;
+                midi.addEvent(juce::MidiMessage::noteOn(1, 52, (juce::uint8)100), 0);
+                midi.addEvent(juce::MidiMessage::noteOn(1, 59, (juce::uint8)90), 300);
+
+                if constexpr (std::is_same_v<std::decay_t<decltype(buffer)>, juce::AudioBuffer<float>>)
+                {
+                    juce::AudioSourceChannelInfo info(buffer);
+                    source.getNextAudioBlock(info, midi);
+                }
+                else
+                {
+                    source.getNextAudioBlock(buffer, midi);
+                }
+            };
+
+            juce::AudioBuffer<float> floatBuffer(2, 4096);
+            juce::AudioBuffer<double> doubleBuffer(2, 4096);
+            render(floatBuffer);
+            render(doubleBuffer);
+
+            expectGreaterThan(floatBuffer.getMagnitude(0, 4096), 0.01f);
+
+            // The voices run in float either way and the double bus only widens their sum
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < 4096; ++i)
+                    expectEquals((float)doubleBuffer.getSample(ch, i), floatBuffer.getSample(ch, i));
+        }
+    }
+
+private:
+    struct SingleVoiceSynth
+    {
+        SingleVoiceSynth(const juce::AudioSampleBuffer& table, double sampleRate)
+        {
+            voice = new WavetableVoice();
+            synth.addVoice(voice);
+            synth.addSound(new WavetableSound(table));
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+            voice->setRandomSeed(1, 0, true);
+        }
+
+        void render(juce::AudioBuffer<float>& buffer)
+        {
+            juce::MidiBuffer noMidi;
+            buffer.clear();
+            synth.renderNextBlock(buffer, noMidi, 0, buffer.getNumSamples());
+        }
+
+        juce::Synthesiser synth;
+        WavetableVoice* voice = nullptr;
+    };
+
+    void expectAliasFree(const juce::AudioSampleBuffer& table, int note, double sampleRate, int fftSize, int fftOrder)
+    {
+        SingleVoiceSynth synth(table, sampleRate);
+        synth.synth.noteOn(1, note, 1.0f);
+
+        // Skip the attack and decay so that only the steady sustain is analysed
+        juce::AudioBuffer<float> buffer(2, (int)(0.2 * sampleRate) + fftSize);
+        synth.render(buffer);
+
+        auto fundamental = juce::MidiMessage::getMidiNoteInHertz(note);
+        auto inharmonicDb = TestHelpers::measureInharmonicEnergyDb(buffer.getReadPointer(0, buffer.getNumSamples() - fftSize),
+                                                                   fftOrder, fundamental, sampleRate);
+
+        expectLessThan(inharmonicDb, -70.0, "note " + juce::String(note));
+    }
+};
+
+static WavetableVoiceTests wavetableVoiceTests;
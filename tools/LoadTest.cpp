@@ -0,0 +1,537 @@
+#include <juce_audio_utils/juce_audio_utils.h>
+#include "PluginProcessor.h"
+#include "WavetableBank.h"
+#include <iostream>
+
+#if JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+//==============================================================================
+// Headless multi-instance load test.
+//
+// Creates N processors and drives them the way a host's audio engine does: every
+// host callback, M worker threads pick instances off a shared counter until each
+// has processed one block, then meet at a barrier before the next callback. The
+// main thread keeps dispatching messages all the while, as a host's message thread
+// would. Reports throughput, callback and whole-cycle times as percentiles against
+// the block's deadline, and resident memory per instance.
+//
+// Exits with 1 if --max-p99 is given and the p99 callback time exceeds it, so it
+// can run as a regression job.
+namespace
+{
+    struct Options
+    {
+        int numInstances = 16;
+        int numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        int blockSize = 256;
+        double sampleRate = 48000.0;
+        double seconds = 10.0;
+        juce::String workload = "chords";
+        juce::String patch = "heavy";
+        bool sharedReverb = false;
+        bool adaptiveQuality = false;
+        bool sweepThreads = false;
+        double maxP99Ms = 0.0;
+    };
+
+    const juce::StringArray workloads { "idle", "chords", "arpeggio", "dense" };
+    const juce::StringArray patches { "default", "heavy" };
+
+    void print(const juce::String& line)
+    {
+        std::cout << line << std::endl;
+    }
+
+    void printUsage()
+    {
+        print("Usage: ArmonioLoadTest [options]");
+        print("  --instances N      processors to run (16)");
+        print("  --threads M        audio worker threads (cores - 1)");
+        print("  --block-size N     samples per callback (256)");
+        print("  --sample-rate R    (48000)");
+        print("  --seconds S        audio rendered per instance (10)");
+        print("  --workload W       " + workloads.joinIntoString(", ") + " (chords)");
+        print("  --patch P          " + patches.joinIntoString(", ") + " (heavy)");
+        print("  --shared-reverb    send every instance into the one shared reverb");
+        print("  --adaptive         leave the quality governor on, which hides overload");
+        print("  --sweep            repeat with 1, 2, 4... threads up to M and report scaling");
+        print("  --max-p99 MS       exit with 1 if the p99 callback time exceeds MS");
+    }
+
+    bool parseOptions(const juce::StringArray& args, Options& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+
+            if (arg == "--shared-reverb")   { options.sharedReverb = true;    continue; }
+            if (arg == "--adaptive")        { options.adaptiveQuality = true; continue; }
+            if (arg == "--sweep")           { options.sweepThreads = true;    continue; }
+
+            // Everything else takes a value
+            if (i + 1 >= args.size())
+                return false;
+
+            const auto& value = args[++i];
+
+            if (arg == "--instances")          options.numInstances = value.getIntValue();
+            else if (arg == "--threads")       options.numThreads = value.getIntValue();
+            else if (arg == "--block-size")    options.blockSize = value.getIntValue();
+            else if (arg == "--sample-rate")   options.sampleRate = value.getDoubleValue();
+            else if (arg == "--seconds")       options.seconds = value.getDoubleValue();
+            else if (arg == "--workload")      options.workload = value;
+            else if (arg == "--patch")         options.patch = value;
+            else if (arg == "--max-p99")       options.maxP99Ms = value.getDoubleValue();
+            else                               return false;
+        }
+
+        return options.numInstances > 0 && options.numThreads > 0 && options.blockSize > 0
+            && options.sampleRate > 0.0 && options.seconds > 0.0
+            && workloads.contains(options.workload) && patches.contains(options.patch);
+    }
+
+    // Resident set size of the whole process, or 0 where it is not available
+    size_t getResidentBytes()
+    {
+       #if JUCE_LINUX
+        juce::StringArray fields;
+        fields.addTokens(juce::File("/proc/self/statm").loadFileAsString(), true);
+        return (size_t)fields[1].getLargeIntValue() * (size_t)sysconf(_SC_PAGESIZE);
+       #elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+            return (size_t)info.resident_size;
+
+        return 0;
+       #else
+        return 0;
+       #endif
+    }
+
+    juce::String formatBytes(double bytes)
+    {
+        return bytes >= 1024.0 * 1024.0 ? juce::String(bytes / (1024.0 * 1024.0), 2) + " MB"
+                                        : juce::String(bytes / 1024.0, 1) + " KB";
+    }
+
+    juce::String formatMicroseconds(double microseconds)
+    {
+        return microseconds >= 1000.0 ? juce::String(microseconds / 1000.0, 2) + " ms"
+                                      : juce::String(microseconds, 1) + " us";
+    }
+
+    // Sorts values in place
+    double percentile(std::vector<double>& values, double fraction)
+    {
+        if (values.empty())
+            return 0.0;
+
+        std::sort(values.begin(), values.end());
+        const auto index = juce::jlimit((size_t)0, values.size() - 1, (size_t)(fraction * (double)values.size()));
+        return values[index];
+    }
+
+    //==============================================================================
+    // Every instance plays the same pattern, shifted by its index so that instances
+    // neither start nor stop notes in lockstep. Events are generated on the audio
+    // thread into a MidiBuffer with room reserved up front, as a host's would be.
+    class MidiWorkload
+    {
+    public:
+        MidiWorkload(const juce::String& name, int instanceIndex, double sampleRate)
+            : type(workloads.indexOf(name)),
+              instance(instanceIndex)
+        {
+            switch (type)
+            {
+                case 1:  notePeriod = (juce::int64)(sampleRate * 0.5);   break;    // a chord every half second
+                case 2:  notePeriod = (juce::int64)(sampleRate * 0.125); break;    // sixteenths at 120 bpm
+                case 3:  notePeriod = 16;                                break;
+                default: notePeriod = 0;                                 break;
+            }
+
+            wheelPeriod = type == 3 ? 32 : type == 2 ? 64 : 0;
+            offset = notePeriod > 0 ? (juce::int64)instance * 997 % notePeriod : 0;
+        }
+
+        void fill(juce::MidiBuffer& midi, juce::int64 blockStart, int numSamples) const
+        {
+            midi.clear();
+
+            if (notePeriod > 0)
+            {
+                auto step = (blockStart - offset + notePeriod - 1) / notePeriod;
+
+                for (auto time = offset + juce::jmax((juce::int64)0, step) * notePeriod; time < blockStart + numSamples;
+                     time += notePeriod)
+                {
+                    addStep(midi, time / notePeriod, (int)(time - blockStart));
+                }
+            }
+
+            if (wheelPeriod > 0)
+            {
+                for (auto time = (blockStart + wheelPeriod - 1) / wheelPeriod * wheelPeriod; time < blockStart + numSamples;
+                     time += wheelPeriod)
+                {
+                    midi.addEvent(juce::MidiMessage::controllerEvent(1, 1, (int)((time / wheelPeriod + instance) % 128)),
+                                  (int)(time - blockStart));
+                }
+            }
+        }
+
+    private:
+        int type = 0;
+        int instance = 0;
+        juce::int64 notePeriod = 0;
+        juce::int64 wheelPeriod = 0;
+        juce::int64 offset = 0;
+
+        int getRoot(juce::int64 step) const
+        {
+            return 48 + (int)((step * 5 + instance) % 12);
+        }
+
+        // Releases the previous step's notes, then starts this one's
+        void addStep(juce::MidiBuffer& midi, juce::int64 step, int position) const
+        {
+            if (type == 1)
+            {
+                constexpr int intervals[] { 0, 4, 7, 11 };
+
+                if (step > 0)
+                    for (auto interval : intervals)
+                        midi.addEvent(juce::MidiMessage::noteOff(1, getRoot(step - 1) + interval), position);
+
+                for (auto interval : intervals)
+                    midi.addEvent(juce::MidiMessage::noteOn(1, getRoot(step) + interval, (juce::uint8)90), position);
+            }
+            else
+            {
+                auto note = [this](juce::int64 s) { return 36 + (int)((s * 7 + instance * 3) % 60); };
+
+                if (step > 0)
+                    midi.addEvent(juce::MidiMessage::noteOff(1, note(step - 1)), position);
+
+                midi.addEvent(juce::MidiMessage::noteOn(1, note(step), (juce::uint8)(40 + step % 80)), position);
+            }
+        }
+    };
+
+    //==============================================================================
+    // Lets the last thread to arrive run a step, e.g. starting the next cycle, before
+    // releasing the others. Waits by spinning and yielding, as host engines do
+    // between callbacks.
+    class SpinBarrier
+    {
+    public:
+        explicit SpinBarrier(int numThreadsToWaitFor) : numThreads(numThreadsToWaitFor) {}
+
+        template <typename Function>
+        void arriveAndWait(Function&& onLastArrival)
+        {
+            const auto currentGeneration = generation.load(std::memory_order_acquire);
+
+            if (numArrived.fetch_add(1, std::memory_order_acq_rel) + 1 == numThreads)
+            {
+                onLastArrival();
+                numArrived.store(0, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_release);
+                return;
+            }
+
+            while (generation.load(std::memory_order_acquire) == currentGeneration)
+                juce::Thread::yield();
+        }
+
+    private:
+        const int numThreads;
+        std::atomic<int> numArrived { 0 };
+        std::atomic<int> generation { 0 };
+    };
+
+    //==============================================================================
+    struct Instance
+    {
+        std::unique_ptr<AudioPluginAudioProcessor> processor;
+        std::unique_ptr<MidiWorkload> workload;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        std::vector<double> callbackMicroseconds;
+    };
+
+    void setParameter(AudioPluginAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.getValueTreeState().getParameter(parameterID))
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    std::unique_ptr<AudioPluginAudioProcessor> createProcessor(const Options& options)
+    {
+        auto processor = std::make_unique<AudioPluginAudioProcessor>();
+
+        if (options.patch == "heavy")
+        {
+            setParameter(*processor, "waveform", 1.0f);
+            setParameter(*processor, "harmonics", 16.0f);
+            setParameter(*processor, "subharmonics", 4.0f);
+            setParameter(*processor, "unison", 5.0f);
+            setParameter(*processor, "reverbSend", 0.3f);
+        }
+
+        setParameter(*processor, "reverbShared", options.sharedReverb ? 1.0f : 0.0f);
+        setParameter(*processor, "adaptiveQuality", options.adaptiveQuality ? 1.0f : 0.0f);
+
+        processor->setPlayConfigDetails(0, 2, options.sampleRate, options.blockSize);
+        return processor;
+    }
+
+    //==============================================================================
+    struct RunResult
+    {
+        double wallSeconds = 0.0;
+        std::vector<double> callbackMicroseconds;
+        std::vector<double> cycleMicroseconds;
+        double worstInstanceP99 = 0.0;
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(int index, std::function<void()> workToDo)
+            : juce::Thread("Load test worker " + juce::String(index)),
+              work(std::move(workToDo))
+        {
+        }
+
+        void run() override
+        {
+            const juce::ScopedNoDenormals noDenormals;
+            work();
+        }
+
+    private:
+        std::function<void()> work;
+    };
+
+    RunResult runLoad(std::vector<Instance>& instances, const Options& options, int numThreads)
+    {
+        const auto numInstances = (int)instances.size();
+        const auto numCycles = juce::jmax(1, (int)(options.seconds * options.sampleRate / options.blockSize));
+
+        // Every run starts from silence and with its results already allocated
+        for (auto& instance : instances)
+        {
+            instance.processor->prepareToPlay(options.sampleRate, options.blockSize);
+            instance.callbackMicroseconds.assign((size_t)numCycles, 0.0);
+        }
+
+        RunResult result;
+        result.cycleMicroseconds.assign((size_t)numCycles, 0.0);
+
+        std::atomic<int> nextInstance { 0 };
+        std::atomic<bool> finished { false };
+        SpinBarrier barrier(numThreads);
+        int cycle = 0;
+        auto cycleStart = juce::Time::getHighResolutionTicks();
+
+        auto work = [&]
+        {
+            while (cycle < numCycles)
+            {
+                const auto blockStart = (juce::int64)cycle * options.blockSize;
+
+                for (auto index = nextInstance.fetch_add(1); index < numInstances; index = nextInstance.fetch_add(1))
+                {
+                    auto& instance = instances[(size_t)index];
+                    instance.workload->fill(instance.midi, blockStart, options.blockSize);
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    instance.processor->processBlock(instance.buffer, instance.midi);
+                    const auto elapsed = juce::Time::getHighResolutionTicks() - start;
+
+                    instance.callbackMicroseconds[(size_t)cycle] = juce::Time::highResolutionTicksToSeconds(elapsed) * 1.0e6;
+                }
+
+                barrier.arriveAndWait([&]
+                {
+                    const auto now = juce::Time::getHighResolutionTicks();
+                    result.cycleMicroseconds[(size_t)cycle] = juce::Time::highResolutionTicksToSeconds(now - cycleStart) * 1.0e6;
+                    cycleStart = now;
+
+                    nextInstance.store(0);
+                    ++cycle;
+                });
+            }
+
+            finished.store(true);
+        };
+
+        juce::OwnedArray<Worker> workers;
+        const auto start = juce::Time::getHighResolutionTicks();
+        cycleStart = start;
+
+        for (int i = 0; i < numThreads; ++i)
+            workers.add(new Worker(i, work))->startThread();
+
+        // The message thread carries on as it would in a host
+        while (! finished.load())
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+
+        for (auto* worker : workers)
+            worker->stopThread(-1);
+
+        result.wallSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        for (auto& instance : instances)
+        {
+            result.callbackMicroseconds.insert(result.callbackMicroseconds.end(),
+                                               instance.callbackMicroseconds.begin(),
+                                               instance.callbackMicroseconds.end());
+
+            result.worstInstanceP99 = juce::jmax(result.worstInstanceP99, percentile(instance.callbackMicroseconds, 0.99));
+        }
+
+        return result;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::StringArray args(argv + 1, argc - 1);
+    Options options;
+
+    if (args.contains("--help"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (! parseOptions(args, options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    const auto deadlineMicroseconds = options.blockSize / options.sampleRate * 1.0e6;
+
+    print("Armonio load test: " + juce::String(options.numInstances) + " instances, "
+          + juce::String(options.blockSize) + "-sample blocks at " + juce::String(options.sampleRate, 0) + " Hz, "
+          + juce::String(options.seconds, 1) + " s of \"" + options.workload + "\" on the " + options.patch + " patch"
+          + (options.sharedReverb ? ", shared reverb" : "")
+          + (options.adaptiveQuality ? ", adaptive quality" : ""));
+
+    //==============================================================================
+    const auto residentBefore = getResidentBytes();
+
+    std::vector<Instance> instances((size_t)options.numInstances);
+
+    for (int i = 0; i < options.numInstances; ++i)
+    {
+        auto& instance = instances[(size_t)i];
+        instance.processor = createProcessor(options);
+        instance.workload = std::make_unique<MidiWorkload>(options.workload, i, options.sampleRate);
+        instance.buffer.setSize(2, options.blockSize);
+        instance.midi.ensureSize(4096);
+    }
+
+    // Lets the reverbs finish preparing in the background before anything is timed
+    for (auto& instance : instances)
+        instance.processor->prepareToPlay(options.sampleRate, options.blockSize);
+
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(500);
+
+    const auto residentPrepared = getResidentBytes();
+
+    //==============================================================================
+    juce::Array<int> threadCounts;
+
+    if (options.sweepThreads)
+        for (int threads = 1; threads < options.numThreads; threads *= 2)
+            threadCounts.add(threads);
+
+    threadCounts.add(options.numThreads);
+
+    RunResult result;
+    double singleThreadSpeed = 0.0;
+
+    for (auto numThreads : threadCounts)
+    {
+        result = runLoad(instances, options, numThreads);
+
+        const auto audioSeconds = (double)result.cycleMicroseconds.size() * options.blockSize / options.sampleRate;
+        const auto speed = audioSeconds * options.numInstances / result.wallSeconds;
+
+        if (numThreads == 1)
+            singleThreadSpeed = speed;
+
+        print("");
+        print(juce::String(numThreads) + (numThreads == 1 ? " thread" : " threads"));
+        print("  Throughput:     " + juce::String(speed, 1) + "x realtime in total, "
+              + juce::String(speed / options.numInstances, 1) + "x per instance"
+              + (singleThreadSpeed > 0.0 && numThreads > 1
+                     ? ", " + juce::String(speed / singleThreadSpeed / numThreads * 100.0, 0) + "% scaling efficiency"
+                     : juce::String()));
+
+        const auto callbackP50 = percentile(result.callbackMicroseconds, 0.5);
+        const auto callbackP99 = percentile(result.callbackMicroseconds, 0.99);
+        const auto callbackP999 = percentile(result.callbackMicroseconds, 0.999);
+        const auto callbackMax = percentile(result.callbackMicroseconds, 1.0);
+
+        print("  Callback time:  p50 " + formatMicroseconds(callbackP50) + ", p99 " + formatMicroseconds(callbackP99)
+              + ", p99.9 " + formatMicroseconds(callbackP999) + ", max " + formatMicroseconds(callbackMax)
+              + " (worst instance p99 " + formatMicroseconds(result.worstInstanceP99)
+              + ", deadline " + formatMicroseconds(deadlineMicroseconds) + ")");
+
+        // A host callback only finishes once every instance has, so this is what has
+        // to fit in the deadline
+        const auto& cycles = result.cycleMicroseconds;
+        const auto numLateCycles = std::count_if(cycles.begin(), cycles.end(),
+                                                 [&](double time) { return time > deadlineMicroseconds; });
+
+        const auto cycleP50 = percentile(result.cycleMicroseconds, 0.5);
+        const auto cycleP99 = percentile(result.cycleMicroseconds, 0.99);
+        const auto cycleP999 = percentile(result.cycleMicroseconds, 0.999);
+
+        print("  Cycle time:     p50 " + formatMicroseconds(cycleP50) + ", p99 " + formatMicroseconds(cycleP99)
+              + ", p99.9 " + formatMicroseconds(cycleP999) + ", " + juce::String((int)numLateCycles)
+              + " of " + juce::String((int)cycles.size()) + " would have missed the deadline");
+    }
+
+    //==============================================================================
+    // After playing, the harness's own timing buffers are included too
+    const auto residentPlayed = getResidentBytes();
+    const auto tableBytes = (double)juce::SharedResourcePointer<WavetableBank>()->getStats().numBytes;
+
+    print("");
+
+    if (residentBefore > 0 && residentPrepared >= residentBefore && residentPlayed >= residentBefore)
+        print("Memory:           " + formatBytes((double)(residentPrepared - residentBefore) / options.numInstances)
+              + " resident per instance once prepared, "
+              + formatBytes((double)(residentPlayed - residentBefore) / options.numInstances)
+              + " after playing; " + formatBytes(tableBytes) + " of wavetables shared by all");
+    else
+        print("Memory:           resident size unavailable; " + formatBytes(tableBytes) + " of wavetables shared by all");
+
+    if (options.maxP99Ms > 0.0)
+    {
+        const auto p99Ms = percentile(result.callbackMicroseconds, 0.99) / 1000.0;
+
+        if (p99Ms > options.maxP99Ms)
+        {
+            print("FAILED: p99 callback time " + juce::String(p99Ms, 3) + " ms exceeds " + juce::String(options.maxP99Ms, 3) + " ms");
+            return 1;
+        }
+
+        print("p99 callback time " + juce::String(p99Ms, 3) + " ms is within " + juce::String(options.maxP99Ms, 3) + " ms");
+    }
+
+    return 0;
+}